@@ -0,0 +1,206 @@
+/**
+ * \file Action_Graph.hpp
+ * This file contains the class declaration for the Action_Graph class, which
+ * runs the actions of an autonomous routine as soon as they are able to start,
+ * rather than one after the other.
+ *
+ * Each action is a node with a function that starts it without waiting, and
+ * a function that says whether it has finished:
+ *
+ *     int spin_up = graph.add("spin up", [] { flywheel.set_target_velo(520); },
+ *                             [] { return flywheel.is_at_speed(); });
+ *     int back_up = graph.add("back up", [] { drive.move_straight(-24); },
+ *                             [] { return drive.is_motion_done(); });
+ *     int fire = graph.add("fire", [] { indexer.start_punch(); },
+ *                          [] { return indexer.is_punch_done(); });
+ *     graph.after(fire, back_up);
+ *     graph.after(fire, spin_up);
+ *
+ * An action starts once every action it comes after has finished and its
+ * condition, if it has one (see when), holds. Actions that don't depend on
+ * each other run at the same time, so the routine takes as long as its
+ * longest chain of dependencies rather than the sum of every action.
+ *
+ * Every function is a plain function pointer, so lambdas must not capture
+ * anything, and the graph is a fixed table, so nothing is allocated. Only one
+ * drivetrain motion can run at a time, so drivetrain actions must each come
+ * after the one before.
+ *
+ * run starts and checks the actions from the calling task every period,
+ * until every action has finished. It stops early if it reaches its deadline,
+ * or if nothing is running and every action left is waiting on another that
+ * can never finish.
+ *
+ * An action can be given an estimate of how long it takes and how many points
+ * it scores (see estimate). Every period, the longest chain of estimated time
+ * left is compared with the time left before the deadline. If the chain won't
+ * fit, the waiting action that scores the fewest points for the time it would
+ * take is skipped, together with every action that comes after it, until the
+ * rest fits. A skipped step lets the actions that don't depend on it start
+ * sooner. An action with no estimate takes no time and is never skipped on
+ * its own. When the deadline is reached, every action still running is cut
+ * short by its stop function, if it has one (see on_cutoff), e.g. to bring the
+ * drivetrain to rest rather than leave it mid-motion.
+ */
+
+#ifndef ACTION_GRAPH_HPP
+#define ACTION_GRAPH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// The most actions in a graph. Each action's dependencies are kept as bits.
+#define ACTION_GRAPH_MAX_NODES 32
+
+typedef void (*action_fn_t)();
+typedef bool (*action_check_fn_t)();
+
+typedef enum action_state_e {
+    E_ACTION_WAITING = 0,
+    E_ACTION_RUNNING,
+    E_ACTION_DONE,
+    E_ACTION_SKIPPED, // Dropped to finish before the deadline
+    E_ACTION_CUT      // Still running at the deadline
+} action_state_e_t;
+
+typedef struct action_node_s {
+    const char *name;
+    action_fn_t start;
+
+    // Whether the action has finished, or nullptr if it finishes as soon as
+    // it has started
+    action_check_fn_t done;
+
+    // Must hold for the action to start, or nullptr
+    action_check_fn_t condition;
+
+    // Cuts the action short at the deadline, or nullptr
+    action_fn_t stop;
+
+    // How long the action lasts at least, in ms
+    uint32_t min_time;
+
+    // How long the action is expected to take, in ms, and how many points it
+    // scores
+    uint32_t estimate;
+    int points;
+
+    // A bit for each action that must finish before this one starts
+    uint32_t deps;
+
+    action_state_e_t state;
+
+    // When the action started and finished, in ms since run was called
+    uint32_t start_time;
+    uint32_t end_time;
+} action_node_t;
+
+class Action_Graph {
+  private:
+    action_node_t nodes[ACTION_GRAPH_MAX_NODES];
+    size_t count = 0;
+
+    // A bit for each action that has finished
+    uint32_t done_mask = 0;
+
+    // Whether a node id refers to an action in the graph
+    bool valid(int node);
+
+    // A bit for each action that has finished or been skipped
+    uint32_t finished_mask();
+
+    // How much estimated time is left in the longest chain of actions that
+    // haven't finished, in ms
+    uint32_t longest_chain(uint32_t elapsed);
+
+    // A bit for an action and every action that comes after it, directly or
+    // not, that hasn't finished
+    uint32_t dependents(size_t node);
+
+    // Skips actions until the estimated time left fits before the deadline
+    void plan(uint32_t elapsed, uint32_t deadline);
+
+  public:
+    /**
+     * Function: add
+     * Adds an action to the graph.
+     * \param name The name used in the report. Must be a string literal or
+     *             otherwise outlive the graph.
+     * \param start Starts the action without waiting for it
+     * \param done Returns whether the action has finished, or nullptr if it
+     *             is finished as soon as it has started
+     * \returns The action's id, or -1 if the graph is full
+     */
+    int add(const char *name, action_fn_t start,
+            action_check_fn_t done = nullptr);
+
+    /**
+     * Function: after
+     * Makes an action wait for another to finish before it starts.
+     * \param node The action that waits
+     * \param dependency The action it waits for
+     */
+    void after(int node, int dependency);
+
+    /**
+     * Function: when
+     * Makes an action wait for a condition to hold before it starts, e.g.
+     * "the flywheel is at speed" or "the drivetrain is within 6 in of its
+     * target". The condition is checked every period once the action's
+     * dependencies have finished.
+     */
+    void when(int node, action_check_fn_t condition);
+
+    /**
+     * Function: hold
+     * Makes an action last at least a given time after it starts, e.g. to
+     * leave a mechanism time to settle, or to make an action that only waits.
+     * \param ms How long the action lasts at least, in ms
+     */
+    void hold(int node, uint32_t ms);
+
+    /**
+     * Function: estimate
+     * Says how long an action is expected to take and what it is worth, so
+     * that run can skip the actions worth the least when the routine won't
+     * finish before its deadline. Times measured by Auton_Profiler make good
+     * estimates.
+     * \param ms How long the action takes, in ms
+     * \param points How many points the action scores. An action that scores
+     *               nothing itself is worth the points of the actions after
+     *               it.
+     */
+    void estimate(int node, uint32_t ms, int points = 0);
+
+    /**
+     * Function: on_cutoff
+     * Gives an action a function that cuts it short, which is called if the
+     * action is still running at the deadline.
+     */
+    void on_cutoff(int node, action_fn_t stop);
+
+    /**
+     * Function: run
+     * Runs the graph from the calling task until every action has finished or
+     * been skipped.
+     * \param deadline How long to run for at most, in ms. Actions still
+     *                 running then are cut short.
+     * \param period How often to start and check the actions, in ms
+     * \returns true if every action finished
+     */
+    bool run(uint32_t deadline = 15000, uint32_t period = 10);
+
+    // Returns an action, by its id
+    const action_node_t &get(int node);
+
+    // Returns the number of actions in the graph
+    size_t size();
+
+    // Removes every action
+    void clear();
+
+    // Prints when each action started and finished to the terminal
+    void print();
+};
+
+#endif /* Action_Graph.hpp */
@@ -0,0 +1,145 @@
+/**
+ * \file Auton_Profiler.hpp
+ * This file contains the class declaration for the Auton_Profiler class, which
+ * times each step of an autonomous routine, to show which steps are worth
+ * making faster.
+ *
+ * The routine marks where each step starts:
+ *
+ *     profiler.step("back up to roller");
+ *     drive.move_straight(-24);
+ *     drive.wait_until_settled();
+ *     profiler.step("spin roller");
+ *     roller.counterclockwise(120);
+ *     profiler.end();
+ *
+ * A step lasts until the next one starts or end is called. For each step, the
+ * profiler keeps:
+ *
+ *  - total: from the step starting to it ending, i.e. from its first command
+ *    being issued to its last one completing
+ *  - moving: how much of that the drivetrain spent carrying out commands
+ *  - blocked: the rest of the step, where the routine was waiting on
+ *    something other than the drivetrain, e.g. a delay, the indexer or the
+ *    roller, or on the drivetrain after it had settled
+ *  - gap: the idle time between the end of the previous step and the start
+ *    of this one, which is only more than 0 after end
+ *
+ * Each step's start is also marked in the Trace, with the step's position.
+ *
+ * report prints a table of the steps to the terminal with the running total
+ * after each one, and saves it to the SD card. If a baseline table has been
+ * saved as BASELINE_PATH, e.g. by copying a good run's table there, each step
+ * is compared with the baseline's step in the same position, and one that has
+ * become slower by more than REGRESSION_FRACTION and REGRESSION_TIME is
+ * flagged. Steps are only compared while their labels match, as a routine
+ * that has been changed can't be compared step by step past the change.
+ */
+
+#ifndef AUTON_PROFILER_HPP
+#define AUTON_PROFILER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "Drivetrain.hpp"
+
+// The most steps that are kept. Later steps are timed as part of the last one.
+#define AUTON_PROFILER_MAX_STEPS 64
+
+typedef struct auton_step_s {
+    const char *label;
+
+    // In ms since the routine started
+    uint32_t start;
+
+    // In ms
+    uint32_t total;
+    uint32_t moving;
+    uint32_t blocked;
+    uint32_t gap;
+
+    // The same step's total in the baseline, or -1 if there isn't one
+    int32_t baseline;
+    bool regressed;
+} auton_step_t;
+
+class Auton_Profiler {
+  private:
+    Drivetrain &drive;
+
+    auton_step_t steps[AUTON_PROFILER_MAX_STEPS];
+    size_t count = 0;
+
+    // Whether the last step is still going
+    bool running = false;
+
+    // When the routine started and the current step started, in ms, and the
+    // drivetrain's moving time when the current step started, in us
+    uint32_t routine_start = 0;
+    uint32_t step_start = 0;
+    uint32_t moving_start = 0;
+
+    // When the last step ended, in ms
+    uint32_t last_end = 0;
+
+    // Where the baseline table is kept on the SD card
+    static constexpr const char *BASELINE_PATH = "/usd/steps_baseline.csv";
+
+    // How much slower than the baseline a step must be to be flagged, as a
+    // fraction and in ms. Both must be exceeded, so that short steps don't
+    // get flagged for a few ms of noise.
+    static constexpr double REGRESSION_FRACTION = 0.1;
+    static constexpr uint32_t REGRESSION_TIME = 50;
+
+    // Fills in each step's baseline and regressed from BASELINE_PATH
+    void compare_baseline();
+
+    void write_csv(FILE *file);
+
+  public:
+    /**
+     * Function: Auton_Profiler
+     * \param drive The drivetrain whose moving time is measured
+     */
+    Auton_Profiler(Drivetrain &drive);
+
+    /**
+     * Function: start
+     * Forgets every step and starts timing a new routine. Call at the start
+     * of autonomous.
+     */
+    void start();
+
+    /**
+     * Function: step
+     * Ends the current step, if there is one, and starts a new one.
+     * \param label What the step does, without commas. Must be a string
+     *              literal or otherwise outlive the profiler.
+     */
+    void step(const char *label);
+
+    // Ends the current step, so that time until the next is counted as a gap
+    void end();
+
+    // Forgets every step, e.g. once they have been reported
+    void clear();
+
+    // Returns the number of steps timed
+    size_t size();
+
+    // Returns a step, in the order they were timed
+    const auton_step_t &get(size_t index);
+
+    /**
+     * Function: report
+     * Ends the current step, compares the steps with the baseline if there is
+     * one, prints the table to the terminal and saves it to the first of
+     * /usd/steps_0.csv, /usd/steps_1.csv, ... that doesn't already exist.
+     * \returns The number of steps flagged as slower than the baseline
+     */
+    size_t report();
+};
+
+#endif /* Auton_Profiler.hpp */
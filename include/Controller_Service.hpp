@@ -0,0 +1,134 @@
+/**
+ * \file Controller_Service.hpp
+ * This file contains the class declaration for the Controller_Service class,
+ * which reads a controller in its own task and shares the readings.
+ *
+ * Every period, the task reads every joystick axis and button once and
+ * publishes the readings as a snapshot, along with which buttons were pressed
+ * or released since the previous snapshot. Driver control code takes one
+ * snapshot per loop and passes it to each subsystem's driver function, so
+ * the controller is read 16 times per period no matter how many subsystems
+ * use it, and every subsystem sees the same button presses.
+ *
+ * Each snapshot also counts every press and release of each button so far.
+ * wait_next() works out which buttons were pressed or released since the
+ * snapshot the caller last used from those counts, so a caller that falls
+ * behind by a few snapshots still sees every press, and never sees one twice.
+ */
+
+#ifndef CONTROLLER_SERVICE_HPP
+#define CONTROLLER_SERVICE_HPP
+
+#include <cstdint>
+
+#include "Seqlock.hpp"
+#include "Subsystem.hpp"
+#include "api.h"
+
+// How often the controller is read, in ms
+#define CONTROLLER_SERVICE_PERIOD 5
+
+// The first and last controller buttons, for converting them to bits
+#define CONTROLLER_FIRST_BUTTON pros::E_CONTROLLER_DIGITAL_L1
+#define CONTROLLER_LAST_BUTTON pros::E_CONTROLLER_DIGITAL_A
+#define CONTROLLER_BUTTONS                                                     \
+    (CONTROLLER_LAST_BUTTON - CONTROLLER_FIRST_BUTTON + 1)
+
+// One reading of every axis and button on a controller
+typedef struct controller_snapshot_s {
+    // Increases by 1 with every snapshot, starting at 1. 0 means no snapshot
+    // has been taken yet.
+    uint32_t seq;
+
+    // When the snapshot was taken, in ms
+    uint32_t time;
+
+    bool connected;
+
+    // Indexed by pros::controller_analog_e_t, from -127 to 127
+    int8_t analog[4];
+
+    // One bit per button, starting from CONTROLLER_FIRST_BUTTON: which are
+    // down, which went down since the previous snapshot, and which came up.
+    // From wait_next, pressed and released are since the snapshot passed to
+    // it instead.
+    uint16_t held;
+    uint16_t pressed;
+    uint16_t released;
+
+    // How many times each button has gone down and come up, wrapping around
+    uint8_t presses[CONTROLLER_BUTTONS];
+    uint8_t releases[CONTROLLER_BUTTONS];
+
+    // Returns a joystick axis's reading, from -127 to 127
+    int get_analog(pros::controller_analog_e_t axis) const {
+        return analog[axis];
+    }
+
+    // Returns whether the button is down
+    bool is_held(pros::controller_digital_e_t button) const {
+        return held & bit(button);
+    }
+
+    // Returns whether the button went down since the previous snapshot, or
+    // the one passed to wait_next
+    bool is_pressed(pros::controller_digital_e_t button) const {
+        return pressed & bit(button);
+    }
+
+    // Returns whether the button came up since the previous snapshot, or the
+    // one passed to wait_next
+    bool is_released(pros::controller_digital_e_t button) const {
+        return released & bit(button);
+    }
+
+    static uint16_t bit(pros::controller_digital_e_t button) {
+        return 1 << (button - CONTROLLER_FIRST_BUTTON);
+    }
+} controller_snapshot_t;
+
+class Controller_Service : public Subsystem<Controller_Service> {
+    friend class Subsystem<Controller_Service>;
+
+  private:
+    pros::controller_id_e_t controller;
+
+    // The readings being taken, kept from one tick to the next to find the
+    // buttons' edges
+    controller_snapshot_t reading = {};
+
+    Seqlock<controller_snapshot_t> latest;
+
+    // Reads the controller and publishes the readings
+    uint32_t tick(uint32_t now);
+
+  public:
+    /**
+     * The Constructor for the Controller_Service class. The task runs at a
+     * higher priority than the default, so that readers never hold up a
+     * snapshot.
+     * \param controller The controller to read
+     */
+    Controller_Service(pros::controller_id_e_t controller);
+
+    // Returns the most recent snapshot
+    controller_snapshot_t get();
+
+    /**
+     * Function: wait_next
+     * Waits for a snapshot newer than the given one, and returns the newest,
+     * with pressed and released set to every button that went down or came
+     * up since the given one, even if it went back in between.
+     * \param last The last snapshot used, or a zeroed one for any snapshot
+     */
+    controller_snapshot_t wait_next(const controller_snapshot_t &last);
+
+    // Whether the controller is connected
+    void snapshot(subsystem_snapshot_t &snap);
+
+    // Keeps reading, so that a button held through the disabled period isn't
+    // seen as a new press once the robot is enabled
+    void safe_stop();
+};
+
+#endif /* Controller_Service.hpp */
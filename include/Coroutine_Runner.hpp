@@ -0,0 +1,201 @@
+/**
+ * \file Coroutine_Runner.hpp
+ * This file contains the class declaration for the Coroutine_Runner class,
+ * which runs several behaviours of an autonomous routine at once from a
+ * single task, without a task and stack for each.
+ *
+ * Each behaviour is a stackless coroutine: a function that is called every
+ * period and carries on from where it last waited. The CO_ macros turn the
+ * function into a state machine, so it reads as if it blocked:
+ *
+ *     static bool fire_preloads(co_context_t &co) {
+ *         CO_BEGIN(co);
+ *         flywheel.set_target_velo(520);
+ *         for (co.count = 0; co.count < 2; ++co.count) {
+ *             CO_AWAIT_FOR(co, flywheel.is_at_speed(), 3000);
+ *             indexer.start_punch();
+ *             CO_AWAIT(co, indexer.is_punch_done());
+ *         }
+ *         CO_END(co);
+ *     }
+ *
+ * Every wait returns from the function, so local variables don't keep their
+ * values across a wait. Anything that must be kept goes in the context, which
+ * is all the state a coroutine has, or in a static. The macros are built on a
+ * switch, so a coroutine can't use switch itself around a wait, declare a
+ * local with an initializer that a wait jumps past, or put two waits on the
+ * same line.
+ *
+ * A coroutine can be given a stop function (see on_cutoff), which is called if
+ * it is still running when run times out, e.g. to bring the drivetrain to
+ * rest rather than leave it mid-motion.
+ *
+ * Coroutines are plain function pointers and the runner is a fixed table, so
+ * nothing is allocated. Only one drivetrain motion can run at a time, so only
+ * one coroutine should drive.
+ */
+
+#ifndef COROUTINE_RUNNER_HPP
+#define COROUTINE_RUNNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "api.h"
+
+// The most coroutines a runner holds
+#define COROUTINE_MAX 16
+
+typedef struct co_context_s {
+    // Where to carry on from, 0 before the first call and -1 once finished
+    int line;
+
+    // When the current wait started, in ms
+    uint32_t wait_start;
+
+    // Whether the last CO_AWAIT_FOR gave up rather than its condition holding
+    bool timed_out;
+
+    // Free for the coroutine to use, e.g. as a loop counter
+    int32_t count;
+} co_context_t;
+
+// Returns true once the coroutine has finished
+typedef bool (*coroutine_fn_t)(co_context_t &co);
+
+// Cuts a coroutine short
+typedef void (*coroutine_stop_t)();
+
+// Starts the body of a coroutine
+#define CO_BEGIN(co)                                                           \
+    switch ((co).line) {                                                       \
+    case 0:
+
+// Waits until a condition holds, checking it once every period
+#define CO_AWAIT(co, condition)                                                \
+    do {                                                                       \
+        (co).line = __LINE__;                                                  \
+        [[fallthrough]];                                                       \
+    case __LINE__:                                                             \
+        if (!(condition))                                                      \
+            return false;                                                      \
+    } while (0)
+
+// Waits until a condition holds or ms have passed, setting co.timed_out if
+// the time ran out first
+#define CO_AWAIT_FOR(co, condition, ms)                                        \
+    do {                                                                       \
+        (co).wait_start = pros::millis();                                      \
+        (co).timed_out = false;                                                \
+        (co).line = __LINE__;                                                  \
+        [[fallthrough]];                                                       \
+    case __LINE__:                                                             \
+        if (!(condition)) {                                                    \
+            if (pros::millis() - (co).wait_start < (uint32_t)(ms))             \
+                return false;                                                  \
+            (co).timed_out = true;                                             \
+        }                                                                      \
+    } while (0)
+
+// Waits for a time, in ms
+#define CO_DELAY(co, ms)                                                       \
+    do {                                                                       \
+        (co).wait_start = pros::millis();                                      \
+        (co).line = __LINE__;                                                  \
+        [[fallthrough]];                                                       \
+    case __LINE__:                                                             \
+        if (pros::millis() - (co).wait_start < (uint32_t)(ms))                 \
+            return false;                                                      \
+    } while (0)
+
+// Lets the other coroutines run, carrying on in the next period
+#define CO_YIELD(co)                                                           \
+    do {                                                                       \
+        (co).line = __LINE__;                                                  \
+        return false;                                                          \
+    case __LINE__:;                                                            \
+    } while (0)
+
+// Ends the body of a coroutine
+#define CO_END(co)                                                             \
+    }                                                                          \
+    (co).line = -1;                                                            \
+    return true
+
+typedef struct coroutine_s {
+    const char *name;
+    coroutine_fn_t fn;
+    coroutine_stop_t stop;
+    co_context_t context;
+    bool done;
+    bool cancelled;
+
+    // When the coroutine finished, in ms since run was called
+    uint32_t end_time;
+} coroutine_t;
+
+class Coroutine_Runner {
+  private:
+    coroutine_t coroutines[COROUTINE_MAX];
+    size_t count = 0;
+
+    bool valid(int id);
+
+  public:
+    /**
+     * Function: spawn
+     * Adds a coroutine, which starts when the runner next ticks.
+     * \param name The name used in the report. Must be a string literal or
+     *             otherwise outlive the runner.
+     * \returns The coroutine's id, or -1 if the runner is full
+     */
+    int spawn(const char *name, coroutine_fn_t fn);
+
+    /**
+     * Function: tick
+     * Calls every coroutine that hasn't finished once, in the order they
+     * were spawned.
+     * \param elapsed The time since the coroutines started, in ms, kept as
+     *                the end time of those that finish
+     * \returns true if every coroutine has finished
+     */
+    bool tick(uint32_t elapsed = 0);
+
+    /**
+     * Function: on_cutoff
+     * Gives a coroutine a function that cuts it short, which is called if the
+     * coroutine is still running when run times out.
+     */
+    void on_cutoff(int id, coroutine_stop_t stop);
+
+    /**
+     * Function: run
+     * Ticks the coroutines from the calling task until they have all
+     * finished.
+     * \param timeout How long to run for at most, in ms. Coroutines still
+     *                running then are cut short.
+     * \param period How often to tick, in ms
+     * \returns true if every coroutine finished
+     */
+    bool run(uint32_t timeout = 15000, uint32_t period = 10);
+
+    // Returns whether a coroutine has finished, e.g. for another to wait on
+    bool is_done(int id);
+
+    // Stops a coroutine, so that it counts as finished without running again
+    void cancel(int id);
+
+    // Returns the number of coroutines
+    size_t size();
+
+    // Returns a coroutine, by its id
+    const coroutine_t &get(int id);
+
+    // Removes every coroutine
+    void clear();
+
+    // Prints when each coroutine finished to the terminal
+    void print();
+};
+
+#endif /* Coroutine_Runner.hpp */
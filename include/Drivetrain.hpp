@@ -12,64 +12,176 @@
 #include <atomic>
 #include <initializer_list>
 
+#include "Controller_Service.hpp"
+#include "Input_Curve.hpp"
+#include "Motion_Metrics.hpp"
 #include "Motor_Group.hpp"
+#include "Seqlock.hpp"
+#include "Settle_Detector.hpp"
+#include "Slew_Limiter.hpp"
+#include "Subsystem.hpp"
+#include "Sysid.hpp"
+#include "Trace.hpp"
 #include "pros/adi.h"
 #include "pros/misc.h"
-#include "pros/rtos.h"
 
-class Drivetrain {
+// What the PID task controls
+typedef enum drive_mode_e {
+    E_DRIVE_MODE_POSITION = 0, // move_straight and turn_angle
+    E_DRIVE_MODE_VELOCITY      // set_velocity_targets and velocity_driver
+} drive_mode_e_t;
+
+// The feedforward constants for one side of the drivetrain, in the units of
+// sysid_consts.hpp: mV, mV per RPM and mV per RPM/s
+typedef struct drive_feedforward_s {
+    double kS, kV, kA;
+} drive_feedforward_t;
+
+// Everything the PID task needs to start following a new motion
+typedef struct drive_command_s {
+    drive_mode_e_t mode;
+
+    // Position commands: how far each side should move from where it is when
+    // the command is picked up, in sensor degrees
+    double left_targ, right_targ;
+
+    // Position commands: the PID constants and exit conditions to use
+    double kP, kI, kD;
+    settle_params_t settle;
+
+    // Position commands: the name and amount of the motion, to label its
+    // metrics
+    const char *type;
+    double amount;
+
+    // Velocity commands: the velocity for each side to hold, in RPM
+    double left_vel, right_vel;
+} drive_command_t;
+
+// The velocity controller's state for one side. Only used by the PID task.
+typedef struct drive_velocity_state_s {
+    // The target after limiting its acceleration, and how quickly it is
+    // changing, in RPM and RPM/s
+    double setpoint;
+    double accel;
+
+    double integral;
+    double prev_error;
+} drive_velocity_state_t;
+
+class Drivetrain : public Subsystem<Drivetrain> {
+    friend class Subsystem<Drivetrain>;
+
   private:
     // The motor groups containing each group of motors that power each side of
     // the base
     Motor_Group left_motors, right_motors;
 
-    // The Drivetrain's PID constants, both for moving straight and for turning
+    // The Drivetrain's PID constants, both for moving straight and for
+    // turning. Copied into each command, so changes apply from the next one.
     double kP, kI, kD = 0;
 
-    // The threshold for when to set is_settled to true, in degrees.
-    double settled_threshold = 10;
+    // The exit conditions used by motions that don't specify their own
+    settle_params_t default_settle = Settle_Detector::DEFAULT_PARAMS;
 
-    // Variables tracking important information about the drivetrain
-    double track_distance, tracking_wheel_radius, tracking_wheel_gear_ratio;
+    /**
+     * The most recent command. move_straight, turn_angle and
+     * set_velocity_targets publish a whole command at once, and the PID task
+     * picks it up at the start of its next iteration, so a new command takes
+     * effect within one iteration and the task never sees half of one.
+     * Commands can be sent from any task, e.g. autonomous and driver control
+     * or the callbacks of an action graph, and send_lock lets one write at a
+     * time.
+     */
+    Seqlock<drive_command_t> commands;
+    std::atomic_flag send_lock = ATOMIC_FLAG_INIT;
+
+    // The command the PID task is following, and the seq it was published
+    // with. Only used by the PID task.
+    drive_command_t command = {};
+    uint32_t command_seq = 0;
+
+    // Where each side was when the current position command was picked up.
+    // Targets are relative to these, so the encoders are never reset while
+    // the PID task might be reading them. Only used by the PID task.
+    double left_start = 0, right_start = 0;
+
+    // The position controller's running sum of errors and last error for each
+    // side. Only used by the PID task.
+    double left_integral = 0, right_integral = 0;
+    double left_prev_error = 0, right_prev_error = 0;
+
+    // The seq of the last command the PID task finished. Every command up to
+    // it has finished, including those replaced before they settled.
+    std::atomic<uint32_t> settled_seq = 0;
+
+    // The last command sent, so that unchanged velocity targets aren't sent
+    // again. Written under send_lock.
+    drive_command_t sent = {};
+
+    // Whether pause_pid_task has suspended the PID task
+    std::atomic<bool> paused = false;
+
+    // The total time spent following a command, in us, and when the PID task
+    // last added to it. Only the PID task writes them.
+    std::atomic<uint32_t> moving_time = 0;
+    uint32_t last_tick = 0;
 
-    // Atomic variables storing the PID controllers targets
-    std::atomic<double> left_targ, right_targ = 0;
+    // How far the side furthest from its target still has to go in the
+    // current position command, in degrees, and the seq of that command
+    std::atomic<float> remaining = 0;
+    std::atomic<uint32_t> started_seq = 0;
 
-    // The PROS task type that contains the PID task for the drivetrain
-    pros::task_t pid_task;
+    // Decides when the current motion has finished. Only used by the PID task.
+    Settle_Detector settle_detector;
+
+    // Variables tracking important information about the drivetrain
+    double track_distance, tracking_wheel_radius, tracking_wheel_gear_ratio;
 
     // The ADI shaft encoders on each side of the drive train. These are used to
     // accurately track the rotation of the robot's wheels, allowing us to move
     // the robot with high precision.
     pros::c::adi_encoder_t left_encdr, right_encdr;
 
-    // Boolean tracking whether the drivetrain PID has stopped. Used to
-    // determine if the drivetrain has completed it's action during the
-    // autonomous period.
-    std::atomic<bool> is_settled = false;
+    // Boolean tracking whether the drivetrain PID has stopped. Only used by
+    // the PID task; other tasks use settled_seq.
+    bool is_settled = false;
+
+    // Why the most recent motion ended, or E_SETTLE_NONE if it hasn't yet
+    std::atomic<settle_exit_e_t> exit_reason = E_SETTLE_NONE;
 
     // Boolean tracking whether the drivetrain includes encoders
     bool using_encdrs = false;
 
+    // Limit how quickly the output to each side may change. Used by both the
+    // PID task and the driver control functions.
+    Slew_Limiter left_slew, right_slew;
+
+    // The input curve for each joystick axis, indexed by
+    // pros::controller_analog_e_t
+    Input_Curve axis_curves[4];
+
+    // The curve used by tank_driver_poly, rebuilt when its power changes
+    Input_Curve poly_curve;
+    double poly_curve_power = 1;
+
     // Boolean tracking whether the tank control is set to reversed
     bool rev_control = false;
 
-    bool reset_pid_vars = false;
+    // The velocity controller's constants. See set_velocity_consts.
+    double vel_kP = 0, vel_kI = 0, vel_kD = 0;
+    drive_feedforward_t left_ff = {0, 0, 0}, right_ff = {0, 0, 0};
+    double max_velocity = 600;
+    double max_accel = 0;
 
-    /**
-     * The PID task function. This function contains a loop that executes the
-     * code for PID controllers for each motor group of the drivetrain
-     */
-    void pid_task_fn();
+    drive_velocity_state_t left_vel_state, right_vel_state;
+    uint32_t vel_last_time = 0;
 
     /**
-     * A static function used to call pid_task_fn. The PROS task system requires
-     * that member functions that are passed as task functions must be static. I
-     * can't make pid_task_fn static, because it includes references to the
-     * Flywheel object. So, I created this function, based on information from:
-     * https://www.vexforum.com/t/pros-task-on-member-functions/105000/9
+     * One iteration of the PID controllers for each motor group of the
+     * drivetrain, called by the PID task
      */
-    static void trampoline(void *param);
+    uint32_t tick(uint32_t now);
 
     /**
      * A function used to handle the conversion from inches for the drivetrain
@@ -88,7 +200,67 @@ class Drivetrain {
      */
     inline double arc_len(double angle, double radius);
 
-    void reset_pid_state(double new_left_targ, double new_right_targ);
+    // The quality of every motion since the table was last cleared
+    Motion_Metrics metrics;
+
+    // Publishes a command for the PID task, resuming the task if it was
+    // paused
+    void send_command(const drive_command_t &new_command);
+
+    // Returns whether the command sent with seq has finished
+    bool is_finished(uint32_t seq);
+
+    // Sends a position command to move each side by the given amount
+    void send_position(const char *type, double amount, double left_targ,
+                       double right_targ, const settle_params_t &params);
+
+    /**
+     * The output stage of the drivetrain. Limits each side's voltage to what
+     * the motors can give, passes it through its slew limiter and sends it to
+     * the motors.
+     * \param left_voltage, right_voltage The voltages wanted, in mV. Set to
+     *                                    the voltages actually sent.
+     * \param now The current time, in ms, which the slew limiters step by
+     */
+    void output_voltage(int &left_voltage, int &right_voltage, uint32_t now);
+
+    /**
+     * Runs one iteration of the velocity controller for one side: the target
+     * is limited to max_accel, then feedforward plus PID on the velocity error
+     * gives the output.
+     * \param dt The time since the last iteration, in seconds
+     * \returns The output, in mV, which output_voltage limits
+     */
+    int velocity_step(drive_velocity_state_t &state, double target,
+                      double measured, const drive_feedforward_t &ff,
+                      double dt);
+
+    // Reads a joystick axis and shapes it with the axis's input curve,
+    // returning the output in mV
+    int read_axis(const controller_snapshot_t &snapshot,
+                  pros::controller_analog_e_t axis);
+
+    // Brakes both sides immediately, bypassing the slew limiters
+    void output_brake();
+
+    /**
+     * When compiled with D_RECORD defined, prints one PID loop iteration in
+     * the replay log format (see sim/README.md): the sensor readings used and
+     * the outputs sent to the motors. Does nothing otherwise.
+     */
+    void record_sample(double left_pos, double right_pos, double left_vel,
+                       double right_vel, int left_voltage, int right_voltage,
+                       bool braking);
+
+    // Like record_sample, but prints the start of a motion
+    void record_motion(const char *type, double amount,
+                       const settle_params_t &params);
+
+    // Like record_sample, but prints new velocity targets
+    void record_velocity(double left_rpm, double right_rpm);
+
+    // Prints the fields of params in the replay log format
+    static void print_settle_params(const settle_params_t &params);
 
   public:
     /**
@@ -131,10 +303,9 @@ class Drivetrain {
      * is controlled its respective joystick Y axis (i.e. the left
      * joystick Y axis reading controls the left motors)
      *
-     * @param controller The Controller ID whose joystick to read the value
-     * of
+     * @param snapshot The controller readings to use
      */
-    void tank_driver(pros::controller_id_e_t controller,
+    void tank_driver(const controller_snapshot_t &snapshot,
                      pros::controller_digital_e_t rev_btn);
 
     /**
@@ -145,12 +316,16 @@ class Drivetrain {
      * joystick Y axis reading controls the left motors). This differs from
      * tank_driver in that the input value is taken to the power input (and then
      * readjusting them to the range of pros::motor::move: -127 to 127),
-     * creating a curve out of the input values
+     * creating a curve out of the input values. The axis input curves are
+     * not used.
+     *
+     * Equivalent to tank_driver with Input_Curve::poly(pow) set on both Y
+     * axes, which should be preferred, since this rebuilds its curve whenever
+     * pow changes.
      *
-     * @param controller The Controller ID whose joystick to read the value
-     * of
+     * @param snapshot The controller readings to use
      */
-    void tank_driver_poly(pros::controller_id_e_t controller, double pow,
+    void tank_driver_poly(const controller_snapshot_t &snapshot, double pow,
                           pros::controller_digital_e_t rev_btn);
 
     /**
@@ -164,14 +339,74 @@ class Drivetrain {
      * The Y axis controls forward/backward
      * The X axis controls turning
      *
-     * @param controller The Controller ID whose joystick to read the value of
+     * @param snapshot The controller readings to use
      * @param use_right indicates whether or not to use the right joystick.
      * Defaults to false
      */
-    void arcade_driver(pros::controller_id_e_t controller,
+    void arcade_driver(const controller_snapshot_t &snapshot,
                        pros::controller_digital_e_t rev_btn,
                        bool use_right = false);
 
+    /**
+     * Function: velocity_driver
+     *
+     * A tank driver control function in which each joystick Y axis sets a
+     * target velocity for its side, which the PID task holds using
+     * feedforward and velocity PID (see set_velocity_consts). Unlike the
+     * other driver functions, the robot's speed for a given stick position
+     * doesn't change with the battery or with load, e.g. when pushing.
+     *
+     * Each axis is shaped by its input curve, so full stick (after the curve)
+     * is max_velocity. Resumes the PID task if it was paused; call
+     * pause_pid_task before switching back to the other driver functions.
+     *
+     * @param snapshot The controller readings to use
+     * @param rev_btn The button that reverses the controls
+     */
+    void velocity_driver(const controller_snapshot_t &snapshot,
+                         pros::controller_digital_e_t rev_btn);
+
+    /**
+     * Function: set_velocity_targets
+     * Switches the PID task to velocity control, if it isn't already, and
+     * sets the velocity for each side to hold. A following move_straight or
+     * turn_angle switches it back to position control. Resumes the PID task
+     * if it was paused. Velocity control never settles, so
+     * wait_until_settled returns straight away after it.
+     * \param left_rpm, right_rpm The target velocities, in motor RPM
+     */
+    void set_velocity_targets(double left_rpm, double right_rpm);
+
+    /**
+     * Function: set_velocity_consts
+     * Sets the velocity controller's constants. The output for each side is
+     *
+     *   kS * sgn(v) + kV * v + kA * a + kP * e + kI * sum(e) + kD * de
+     *
+     * where v and a are the target velocity and acceleration and e is the
+     * velocity error in RPM.
+     * \param left_ff, right_ff Each side's feedforward constants, usually
+     *                         from sysid_consts.hpp
+     * \param kP, kI, kD The velocity PID constants, shared by both sides
+     * \param max_velocity The target velocity at full stick, in RPM
+     * \param max_accel The fastest the target may change, in RPM per
+     *                  second, or 0 for no limit
+     */
+    void set_velocity_consts(const drive_feedforward_t &left_ff,
+                             const drive_feedforward_t &right_ff, double kP,
+                             double kI, double kD, double max_velocity,
+                             double max_accel);
+
+    /**
+     * Function: set_input_curve
+     * Sets the curve used to shape a joystick axis in tank_driver and
+     * arcade_driver. Every axis is linear with no deadband by default.
+     * \param axis The joystick axis
+     * \param curve The curve, which is copied
+     */
+    void set_input_curve(pros::controller_analog_e_t axis,
+                         const Input_Curve &curve);
+
     /**
      * Functions to set the PID controller constants. Each controller uses the
      * same constants, based on the assumption that any possible difference in
@@ -193,6 +428,14 @@ class Drivetrain {
      */
     void move_straight(double inches);
 
+    /**
+     * Function: move_straight
+     * Like move_straight(double), but with exit conditions for this motion
+     * only, e.g. a short timeout for a move that ends against a wall.
+     * @param params The exit conditions, in degrees of wheel rotation and RPM
+     */
+    void move_straight(double inches, const settle_params_t &params);
+
     /**
      * Function: turn_angle
      * This function updates the values of the left and right PID targets to
@@ -203,8 +446,15 @@ class Drivetrain {
      */
     void turn_angle(double angle);
 
-    // Initializes pid_task, starting the Drivetrain PID task
-    void init_pid_task();
+    /**
+     * Function: turn_angle
+     * Like turn_angle(double), but with exit conditions for this motion only
+     * @param params The exit conditions, in degrees of wheel rotation and RPM
+     */
+    void turn_angle(double angle, const settle_params_t &params);
+
+    // Initializes task, starting the Drivetrain PID task
+    void init_task();
 
     void pause_pid_task();
 
@@ -214,14 +464,68 @@ class Drivetrain {
     // end of autonomous().
     void end_pid_task();
 
-    // Runs in a while loop until the PID task indicates it has reached its
-    // target.
+    // Waits until the PID task has finished the most recent motion, or
+    // another command has replaced it, then 200 ms more for the robot to come
+    // to rest. Returns straight away if the last command was a velocity
+    // command.
     void wait_until_settled();
 
+    // Returns whether the PID task has finished the most recent motion,
+    // without waiting
+    bool is_motion_done();
+
+    /**
+     * Function: stop_motion
+     * Cuts the current motion short by holding the robot where it is, so that
+     * it is brought to rest by the PID loop rather than left coasting.
+     * Returns straight away, and does nothing if the motion has finished.
+     */
+    void stop_motion();
+
+    /**
+     * Function: get_distance_remaining
+     * Returns how far the current motion still has to go, in inches of wheel
+     * travel, e.g. to start something when the robot is close to its target.
+     * For turns this is the distance along the arc, not the angle. Returns 0
+     * once the motion has settled.
+     */
+    double get_distance_remaining();
+
     // Sets the threshold for declaring whether the drivetrain has settled, i.e.
-    // has reached its target position.
+    // has reached its target position. This is the small error band of the
+    // default exit conditions.
     void set_settled_threshold(double threshold);
 
+    /**
+     * Function: set_settle_params
+     * Sets the exit conditions used by motions that don't specify their own.
+     * See Settle_Detector.hpp. The errors are in degrees of wheel rotation
+     * and the velocities in RPM. Whichever side of the drivetrain is furthest
+     * from its target decides when a motion ends.
+     */
+    void set_settle_params(const settle_params_t &params);
+
+    // Returns why the most recent motion ended, or E_SETTLE_NONE if it is
+    // still running
+    settle_exit_e_t get_exit_reason();
+
+    /**
+     * Function: get_moving_time
+     * Returns how long the drivetrain has spent carrying out motions and
+     * velocity commands, in us, up to the PID task's last iteration. It wraps
+     * after 71 minutes, so only the difference between two readings means
+     * anything.
+     */
+    uint32_t get_moving_time();
+
+    /**
+     * Function: get_metrics
+     * Returns the rise time, overshoot, settle time, steady-state error, peak
+     * current and exit reason of every motion since the table was last
+     * cleared. Errors are in degrees of tracking wheel rotation.
+     */
+    Motion_Metrics &get_metrics();
+
     void set_velo(int left_velo, int right_velo);
 
     /**
@@ -244,6 +548,54 @@ class Drivetrain {
 
     void set_voltage_limit(int limit);
 
+    /**
+     * Function: set_slew_rates
+     * Sets how quickly the output to each side may change, both during
+     * motions and under driver control. Braking is never limited. See
+     * Slew_Limiter.hpp.
+     * \param accel The largest change per second when speeding up, in mV. 0
+     *              means unlimited.
+     * \param decel The largest change per second when slowing down, in mV.
+     *              0 means unlimited.
+     */
+    void set_slew_rates(double accel, double decel);
+
+    /**
+     * Function: characterize
+     * Runs the quasistatic and dynamic system identification tests in both
+     * directions, logging each side of the drivetrain separately, and appends
+     * the results to a CSV file on the SD card. The PID task is paused while
+     * the tests run, and left as it was found afterwards. The robot drives
+     * forward and then back during each pair of tests. Uncapped, the
+     * quasistatic ramp autonomous uses, 500 mV/s up to 6 V, would take the
+     * robot about 14 ft with the nominal drive model, so each test is ended
+     * once the robot has covered max_inches, and the robot needs that much
+     * clear space in front of it.
+     * \param sysid The Sysid object used to run the tests
+     * \param path The CSV file to append the results to
+     * \param max_inches How far each test may drive the robot, in inches
+     * \returns false if the results could not be saved
+     */
+    bool characterize(Sysid &sysid, const char *path,
+                      double max_inches = 96);
+
+    // Return each side's motors, e.g. for the power manager to limit their
+    // current
+    Motor_Group &get_left_motors();
+    Motor_Group &get_right_motors();
+
+    // Why the last motion ended, or E_SETTLE_NONE while it runs, the distance
+    // left in it, in degrees, and both sides' mean velocity and total current
+    void snapshot(subsystem_snapshot_t &snap);
+
+    // Pauses the PID task and stops the motors
+    void safe_stop();
+
+    // Resumes the PID task for autonomous. Driver control leaves it paused,
+    // as the driver functions other than velocity_driver set the motors
+    // themselves.
+    void enable(subsystem_mode_e_t mode);
+
     /**
      * Function: print_telemetry
      *
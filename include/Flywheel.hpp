@@ -8,26 +8,41 @@
  * This class represents the physical flywheel used to launch the
  * disks
  */
+#include "Controller_Service.hpp"
 #include "Motor_Group.hpp"
-#include "pros/rtos.h"
+#include "Subsystem.hpp"
+#include "Sysid.hpp"
 #include <atomic>
 #include <initializer_list>
 
 #define FLYWHEEL_FAST_TARG 600
 #define FLYWHEEL_SLOW_TARG 400
+// How close to its target the flywheel must be to shoot, in RPM
+#define FLYWHEEL_SPEED_TOLERANCE 15
+
+class Flywheel : public Subsystem<Flywheel> {
+    friend class Subsystem<Flywheel>;
 
-class Flywheel {
   private:
     // The motor group containing all of the motors on the flywheel
     Motor_Group motors;
 
     std::atomic<int> velocity;
 
+    // The velocity measured by the task in its last iteration
+    std::atomic<float> measured_velo{0};
+
+    // The error in the last iteration of the controller, in RPM
+    double prev_error = 0;
+
+    // Whether pause_task has suspended the task
+    std::atomic<bool> paused{false};
+
     /**
-     * The task function. This function contains a loop that executes the
-     * code to run the flywheel's controller in its own task
+     * One iteration of the flywheel's controller, called by the flywheel's
+     * task
      */
-    void task_fn();
+    uint32_t tick(uint32_t now);
 
     /**
      * Flywheel controller constants
@@ -50,17 +65,9 @@ class Flywheel {
      */
     double kS, kV, kD, kP;
 
-    // The PROS task type that contains the task for the flywheel
-    pros::task_t task;
-
-    /**
-     * A static function used to call task_fn. The PROS task system requires
-     * that member functions that are passed as task functions must be static. I
-     * can't make pid_task_fn static, because it includes references to the
-     * Flywheel object. So, I created this function, based on information from:
-     * https://www.vexforum.com/t/pros-task-on-member-functions/105000/9
-     */
-    static void trampoline(void *param);
+    // The flywheel's state under driver control, toggled by driver()
+    bool driver_running = false;
+    bool driver_slow = false;
 
   public:
     /**
@@ -93,13 +100,24 @@ class Flywheel {
     // Sets the flywheel's target velocity
     void set_target_velo(int velo);
 
+    /**
+     * Function: is_at_speed
+     * Returns whether the flywheel is within tolerance of its target
+     * velocity, e.g. to wait until it is ready to shoot
+     * \param tolerance How far off the target still counts, in RPM
+     */
+    bool is_at_speed(double tolerance = FLYWHEEL_SPEED_TOLERANCE);
+
+    // Returns the velocity measured by the task in its last iteration, in RPM
+    double get_measured_velo();
+
     /**
      * Function: driver
      *
      * This function allows for starting and stopping of the flywheel in driver
      * control, as well as changing the direction
      */
-    void driver(pros::controller_id_e_t controller,
+    void driver(const controller_snapshot_t &snapshot,
                 pros::controller_digital_e_t pwr_button,
                 pros::controller_digital_e_t rev_button);
 
@@ -126,6 +144,34 @@ class Flywheel {
      */
     void stop();
 
+    /**
+     * Function: characterize
+     *
+     * This function runs the forward quasistatic and dynamic system
+     * identification tests on the flywheel, and appends the results to a CSV
+     * file on the SD card. The flywheel task is paused while the tests run,
+     * and left as it was found afterwards.
+     * The reverse tests are skipped, since the flywheel never runs backwards.
+     *
+     * \param sysid The Sysid object used to run the tests
+     * \param path The CSV file to append the results to
+     * \returns false if the results could not be saved
+     */
+    bool characterize(Sysid &sysid, const char *path);
+
+    // Returns the motors, e.g. for the power manager to limit their current
+    Motor_Group &get_motors();
+
+    // Whether the task is running (1) or paused (0), the target velocity and
+    // the measured velocity and current
+    void snapshot(subsystem_snapshot_t &snap);
+
+    // Pauses the task, letting the flywheel spin down
+    void safe_stop();
+
+    // Resumes the task, in either mode
+    void enable(subsystem_mode_e_t mode);
+
     /**
      * Function: print_telemetry
      *
@@ -0,0 +1,168 @@
+/**
+ * \file Health_Monitor.hpp
+ * This file contains the class declaration for the Health_Monitor class, which
+ * watches the motors in a set of motor groups during a match and works around
+ * the ones that are failing.
+ *
+ * Every period, each motor's temperature, voltage, velocity and connection
+ * are checked for these conditions:
+ *
+ *  - Warm or hot: the motor is nearing the temperature at which it cuts its
+ *    own power. It is derated by WARM_DERATE or HOT_DERATE percent, so that it
+ *    cools down gradually rather than being cut off by its firmware.
+ *  - Stalled: the motor has been given voltage but hasn't turned for
+ *    STALL_TIME. It is derated by STALL_DERATE percent until it turns again or
+ *    is no longer driven.
+ *  - Outlier: the motor's velocity has been far from the rest of its group's
+ *    for OUTLIER_TIME, e.g. from a slipping gear or a bad encoder. It is left
+ *    out of the group's averages, but still driven. Telling which motor is the
+ *    odd one out takes at least three, so in a group of two a disagreement is
+ *    only reported.
+ *  - Disconnected: the motor's readings are PROS_ERR. It isn't driven and is
+ *    left out of the averages until it comes back.
+ *
+ * The rest of the group carries on, so the mechanism gets weaker rather than
+ * stopping. A condition being raised or cleared is printed to the terminal:
+ *
+ *     M,<time ms>,raise|clear,<group>,<port>,<condition>
+ *
+ * and a newly raised condition rumbles the master controller.
+ */
+
+#ifndef HEALTH_MONITOR_HPP
+#define HEALTH_MONITOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Motor_Group.hpp"
+#include "Subsystem.hpp"
+#include "pros/rtos.h"
+
+// The most groups that can be monitored
+#define HEALTH_MONITOR_MAX_GROUPS 8
+
+// How often the motors are checked, in ms
+#define HEALTH_MONITOR_PERIOD 100
+
+// The conditions a motor can be in, as bits
+typedef enum motor_health_e {
+    E_MOTOR_HEALTH_OK = 0x00,
+    E_MOTOR_HEALTH_WARM = 0x01,
+    E_MOTOR_HEALTH_HOT = 0x02,
+    E_MOTOR_HEALTH_STALLED = 0x04,
+    E_MOTOR_HEALTH_OUTLIER = 0x08,
+    E_MOTOR_HEALTH_DISCONNECTED = 0x10,
+    // Reported for both motors of a two-motor group
+    E_MOTOR_HEALTH_DISAGREE = 0x20
+} motor_health_e_t;
+
+typedef struct motor_health_s {
+    // A combination of motor_health_e_t bits
+    uint8_t conditions;
+
+    // When the motor started looking stalled or like an outlier, or 0 if it
+    // doesn't
+    uint32_t stall_start;
+    uint32_t outlier_start;
+} motor_health_t;
+
+typedef struct health_group_s {
+    const char *name;
+    Motor_Group *motors;
+    motor_health_t health[MOTOR_GROUP_MAX_MOTORS];
+} health_group_t;
+
+class Health_Monitor : public Subsystem<Health_Monitor> {
+    friend class Subsystem<Health_Monitor>;
+
+  private:
+    health_group_t groups[HEALTH_MONITOR_MAX_GROUPS];
+    size_t group_count = 0;
+
+    // Whether a newly raised condition rumbles the controller
+    bool rumble = true;
+
+    // Temperatures at which a motor counts as warm or hot, in degrees C. The
+    // motors report temperature in steps of 5, and start limiting their own
+    // power at 55. A condition clears once the motor is TEMP_HYSTERESIS below
+    // it.
+    static constexpr double WARM_TEMP = 50;
+    static constexpr double HOT_TEMP = 55;
+    static constexpr double TEMP_HYSTERESIS = 5;
+
+    // How much is taken off a motor's output in each condition, in percent.
+    // When a motor is in more than one, the largest applies.
+    static constexpr int WARM_DERATE = 25;
+    static constexpr int HOT_DERATE = 50;
+    static constexpr int STALL_DERATE = 50;
+
+    // A motor given at least STALL_VOLTAGE mV that turns slower than
+    // STALL_VELOCITY RPM for STALL_TIME ms is stalled
+    static constexpr int STALL_VOLTAGE = 3000;
+    static constexpr double STALL_VELOCITY = 5;
+    static constexpr uint32_t STALL_TIME = 500;
+
+    // A motor whose velocity is more than OUTLIER_VELOCITY RPM, or
+    // OUTLIER_FRACTION of the group's velocity if that is more, from the rest
+    // of its group for OUTLIER_TIME ms is an outlier
+    static constexpr double OUTLIER_VELOCITY = 30;
+    static constexpr double OUTLIER_FRACTION = 0.25;
+    static constexpr uint32_t OUTLIER_TIME = 500;
+
+    // Checks every motor
+    uint32_t tick(uint32_t now);
+
+    // Checks every motor in a group and updates its conditions
+    void check(health_group_t &group, uint32_t now);
+
+    // Sets or clears a condition, logging and rumbling if it changed
+    void set_condition(health_group_t &group, size_t index,
+                       motor_health_e_t condition, bool active, uint32_t now);
+
+    // Derates and ignores a motor according to its conditions
+    void apply(health_group_t &group, size_t index);
+
+  public:
+    /**
+     * The Constructor for the Health_Monitor class. The task runs at a lower
+     * priority than the default, so that it never delays the control loops.
+     */
+    Health_Monitor();
+
+    /**
+     * Function: add_group
+     * Starts monitoring a motor group. Must be called before the task is
+     * started. Only
+     * the group's first MOTOR_GROUP_MAX_MOTORS motors are monitored.
+     * \param name The name used in the log. Must be a string literal or
+     *             otherwise outlive the monitor.
+     * \param motors The group
+     * \returns false if HEALTH_MONITOR_MAX_GROUPS groups have already been
+     *          added
+     */
+    bool add_group(const char *name, Motor_Group *motors);
+
+    // Sets whether a newly raised condition rumbles the master controller
+    void set_rumble(bool rumble);
+
+    /**
+     * Function: get_conditions
+     * \param group The group's position in the order they were added
+     * \param index The motor's position in its group
+     * \returns The motor's conditions, as motor_health_e_t bits
+     */
+    uint8_t get_conditions(size_t group, size_t index);
+
+    // Prints every motor's conditions, derate and temperature to the terminal
+    void print_status();
+
+    // Every condition any motor is in, as motor_health_e_t bits
+    void snapshot(subsystem_snapshot_t &snap);
+
+    // Keeps the conditions, as a hot motor is still hot once the robot is
+    // enabled again
+    void safe_stop();
+};
+
+#endif /* Health_Monitor.hpp */
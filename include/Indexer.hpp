@@ -13,17 +13,105 @@
  * normal gear that is missing teeth reaches the rack gear, the object is free
  * to move. This object also has rubber bands connected to it that cause it to
  * move toward the disk when nothing is holding it back.
+ *
+ * Shots are fired by the indexer's own task, so asking for them doesn't block.
+ * fire(n) queues n shots, and the task works through them as a state machine:
+ *
+ *  - idle: nothing to fire
+ *  - ready: a shot is queued, and waits for the gate (see indexer_gate_t)
+ *  - firing: the gear is turning through one shot
+ *  - returning: the gear has reached the end of its turn and is coming to
+ *    rest, with the puncher back in place for the next shot
+ *
+ * A shot is finished once the encoder shows the gear has turned the whole way
+ * and stopped, rather than after a fixed time, so a burst runs as fast as the
+ * mechanism allows. The time from the start of each shot to the start of the
+ * next is measured, and each burst's intervals are printed when it ends.
  */
 
+#include "Controller_Service.hpp"
 #include "Motor_Group.hpp"
+#include "Subsystem.hpp"
 #include "api.h"
+#include <atomic>
 #include <initializer_list>
 
-class Indexer {
+// The speed the gear turns at, in RPM, and how far it turns for each shot, in
+// degrees
+#define INDEXER_VELO 200
+#define INDEXER_ROTATION 720
+
+// How long a shot takes when nothing holds it up, in ms
+#define INDEXER_SHOT_TIME (INDEXER_ROTATION * 1000 / (INDEXER_VELO * 6))
+
+// The longest a shot may take before it is given up on, e.g. if the gear is
+// jammed, in ms. A shot that times out is marked in its Trace punch end.
+#define INDEXER_PUNCH_TIMEOUT 2250
+
+typedef enum indexer_state_e {
+    E_INDEXER_IDLE = 0,
+    E_INDEXER_FIRING,
+    E_INDEXER_RETURNING,
+    E_INDEXER_READY
+} indexer_state_e_t;
+
+// Decides when the next queued shot may fire
+typedef struct indexer_gate_s {
+    // Must hold for the shot to fire, e.g. the flywheel being at speed, or
+    // nullptr
+    bool (*ready)();
+
+    // The shortest time from the start of one shot to the start of the next,
+    // in ms
+    uint32_t min_interval;
+
+    // How long to wait for ready before firing anyway, in ms, or 0 to wait as
+    // long as it takes
+    uint32_t max_wait;
+} indexer_gate_t;
+
+class Indexer : public Subsystem<Indexer> {
+    friend class Subsystem<Indexer>;
+
   private:
     Motor_Group motors;
 
-    int degrees_to_rotate;
+    int degrees_to_rotate = INDEXER_ROTATION;
+
+    // Shots asked for that haven't finished, including the one firing
+    std::atomic<int> shots_left{0};
+    std::atomic<indexer_state_e_t> state{E_INDEXER_IDLE};
+
+    // Set by cancel, and handled by the task, which is the only one that
+    // knows whether a shot is firing
+    std::atomic<bool> cancelled{false};
+
+    indexer_gate_t gate = {nullptr, 0, 0};
+
+    // When the shot firing started, when the indexer started waiting for the
+    // gate and when the last shot started, in ms. Only used by the task.
+    uint32_t shot_start = 0;
+    uint32_t wait_start = 0;
+    uint32_t last_start = 0;
+
+    // The shots fired in the current burst, and the fire-to-fire intervals
+    // between them, in ms. Only written by the task.
+    int burst_shots = 0;
+    uint32_t burst_start = 0;
+    std::atomic<uint32_t> last_interval{0};
+    uint32_t min_interval = 0, max_interval = 0;
+
+    // Runs the state machine, called by the indexer's task
+    uint32_t tick(uint32_t now);
+
+    // Whether the gate lets the next shot fire
+    bool gate_open(uint32_t now);
+
+    // Starts turning the gear for the next shot
+    void start_shot(uint32_t now);
+
+    // Moves on to the next shot, or to idle once the burst is done
+    void end_shot(uint32_t now, bool timed_out = false);
 
   public:
     // Constructor for the Indexer class
@@ -32,13 +120,61 @@ class Indexer {
     // Sets the degrees the gear needs to rotate for each time the puncher fires
     void set_rotation(int degrees_to_rotate);
 
-    // Function that controls the indexer in opcontrol
-    void driver(pros::controller_id_e_t controller,
+    /**
+     * Function: set_gate
+     * Sets when each queued shot may fire. Should only be changed while no
+     * shots are queued.
+     */
+    void set_gate(const indexer_gate_t &gate);
+
+    // Function that controls the indexer in opcontrol. Does nothing while
+    // queued shots are firing.
+    void driver(const controller_snapshot_t &snapshot,
                 pros::controller_digital_e_t fire_btn,
                 pros::controller_digital_e_t pullback_btn);
 
-    // Moves the gear enough to send one disk into the flywheel
+    /**
+     * Function: fire
+     * Queues shots without waiting for them. Shots asked for while a burst is
+     * firing are added to it.
+     * \param shots How many disks to fire
+     */
+    void fire(int shots = 1);
+
+    // Drops the queued shots. A shot already firing finishes.
+    void cancel();
+
+    // Returns whether every shot asked for has finished
+    bool is_done();
+
+    // Waits until every shot asked for has finished
+    void wait_until_done();
+
+    // Fires one disk and waits for it
     void punch_disk();
+
+    // Starts a punch without waiting for it, for running alongside other
+    // actions
+    void start_punch();
+
+    // Returns whether the last punch started has finished
+    bool is_punch_done();
+
+    // Returns what the indexer is doing
+    indexer_state_e_t get_state();
+
+    // Returns the time from the start of the shot before last to the start of
+    // the last one, in ms, or 0 if no burst has fired a second shot
+    uint32_t get_last_interval();
+
+    // Returns the motors, e.g. for the power manager to limit their current
+    Motor_Group &get_motors();
+
+    // The state, the shots left and the gear's velocity and current
+    void snapshot(subsystem_snapshot_t &snap);
+
+    // Drops the queued shots and stops the gear
+    void safe_stop();
 };
 
-#endif /* Indexer.hpp */
\ No newline at end of file
+#endif /* Indexer.hpp */
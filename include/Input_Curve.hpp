@@ -0,0 +1,220 @@
+/**
+ * \file Input_Curve.hpp
+ * This file contains the declaration of the Input_Curve class, which shapes
+ * joystick inputs for driver control.
+ *
+ * A joystick axis only ever reads one of 255 values (-127 to 127), so rather
+ * than evaluating a curve every loop, each curve is a 256-entry table of
+ * motor outputs in mV, indexed by the reading. The tables are built by
+ * constexpr functions, so a curve whose parameters are known ahead of time is
+ * built entirely by the compiler:
+ *
+ *     static constexpr Input_Curve drive_curve = Input_Curve::poly(1.3, 5);
+ *
+ * The same functions can be called at runtime to build a curve from tuned
+ * parameters. That evaluates the curve 128 times, so it should be done
+ * during initialization rather than in the driver control loop.
+ *
+ * Every curve is odd (f(-x) = -f(x)), maps 0 to 0 and full stick to full
+ * power, and ignores readings inside its deadband. The rest of the stick's
+ * travel is stretched to cover the whole output range, so a deadband doesn't
+ * cost any top speed.
+ */
+
+#ifndef INPUT_CURVE_HPP
+#define INPUT_CURVE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// The largest joystick reading, and the output it maps to, in mV
+#define INPUT_CURVE_MAX_INPUT 127
+#define INPUT_CURVE_MAX_OUTPUT 12000
+
+// A point on a piecewise curve, in joystick units (0 to 127)
+typedef struct input_curve_point_s {
+    double input;
+    double output;
+} input_curve_point_t;
+
+// Math functions usable in constant expressions, accurate to well under
+// 1 mV over the range the curves use
+namespace input_curve_math {
+
+constexpr double LN2 = 0.693147180559945309417;
+
+constexpr double exp(double x) {
+    // e^x = 2^k * e^r, where |r| <= ln(2) / 2 keeps the series short
+    int k = (int)(x / LN2 + (x < 0 ? -0.5 : 0.5));
+    double r = x - k * LN2;
+
+    double sum = 1, term = 1;
+    for (int n = 1; n < 20; ++n) {
+        term *= r / n;
+        sum += term;
+    }
+
+    for (; k > 0; --k)
+        sum *= 2;
+    for (; k < 0; ++k)
+        sum /= 2;
+    return sum;
+}
+
+constexpr double log(double x) {
+    // x = m * 2^e with m in [1, 2), then ln(m) = 2 * atanh((m - 1) / (m + 1))
+    int e = 0;
+    for (; x >= 2; x /= 2)
+        ++e;
+    for (; x < 1; x *= 2)
+        --e;
+
+    double z = (x - 1) / (x + 1);
+    double z2 = z * z;
+    double sum = 0, power = z;
+    for (int n = 1; n < 40; n += 2) {
+        sum += power / n;
+        power *= z2;
+    }
+    return 2 * sum + e * LN2;
+}
+
+// x^p for x >= 0
+constexpr double pow(double x, double p) {
+    return x <= 0 ? 0 : exp(p * log(x));
+}
+
+} // namespace input_curve_math
+
+class Input_Curve {
+  private:
+    // The output in mV for each reading, offset by 128 so that -128 (which the
+    // joystick never reads) is at index 0
+    int16_t table[256] = {};
+
+    typedef enum shape_e {
+        E_SHAPE_LINEAR,
+        E_SHAPE_POLY,
+        E_SHAPE_EXP,
+        E_SHAPE_PIECEWISE
+    } shape_e_t;
+
+    /**
+     * Fills the table. Each reading outside the deadband is scaled to the
+     * range 0 to 1, passed through the shape, and scaled to mV.
+     */
+    constexpr Input_Curve(shape_e_t shape, double param,
+                          const input_curve_point_t *points, size_t count,
+                          int deadband) {
+        for (int reading = 0; reading <= INPUT_CURVE_MAX_INPUT; ++reading) {
+            double fraction = 0;
+            if (reading > deadband)
+                fraction = (double)(reading - deadband) /
+                           (INPUT_CURVE_MAX_INPUT - deadband);
+
+            double shaped = fraction;
+            if (shape == E_SHAPE_POLY)
+                shaped = input_curve_math::pow(fraction, param);
+            else if (shape == E_SHAPE_EXP && param != 0)
+                shaped = (input_curve_math::exp(param * fraction) - 1) /
+                         (input_curve_math::exp(param) - 1);
+            else if (shape == E_SHAPE_PIECEWISE)
+                shaped = interpolate(points, count,
+                                     fraction * INPUT_CURVE_MAX_INPUT) /
+                         INPUT_CURVE_MAX_INPUT;
+
+            if (shaped > 1)
+                shaped = 1;
+            else if (shaped < 0)
+                shaped = 0;
+
+            int16_t output = (int16_t)(shaped * INPUT_CURVE_MAX_OUTPUT + 0.5);
+            table[128 + reading] = output;
+            table[128 - reading] = -output;
+        }
+        table[0] = table[1];
+    }
+
+    // Linearly interpolates between points, which must be sorted by input.
+    // Before the first point the curve starts from (0, 0), and after the last
+    // it stays level.
+    static constexpr double interpolate(const input_curve_point_t *points,
+                                        size_t count, double input) {
+        double prev_in = 0, prev_out = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (input <= points[i].input) {
+                double span = points[i].input - prev_in;
+                if (span <= 0)
+                    return points[i].output;
+                return prev_out +
+                       (points[i].output - prev_out) * (input - prev_in) / span;
+            }
+            prev_in = points[i].input;
+            prev_out = points[i].output;
+        }
+        return prev_out;
+    }
+
+  public:
+    // A linear curve with no deadband, i.e. the stick reading as is
+    constexpr Input_Curve() : Input_Curve(E_SHAPE_LINEAR, 0, nullptr, 0, 0) {}
+
+    /**
+     * Function: linear
+     * \param deadband Readings at or below this magnitude output 0
+     */
+    static constexpr Input_Curve linear(int deadband = 0) {
+        return Input_Curve(E_SHAPE_LINEAR, 0, nullptr, 0, deadband);
+    }
+
+    /**
+     * Function: poly
+     * output = input^power. Powers above 1 give finer control at low speeds.
+     * \param power The exponent. Must be positive.
+     * \param deadband Readings at or below this magnitude output 0
+     */
+    static constexpr Input_Curve poly(double power, int deadband = 0) {
+        return Input_Curve(E_SHAPE_POLY, power, nullptr, 0, deadband);
+    }
+
+    /**
+     * Function: exponential
+     * output = (e^(k * input) - 1) / (e^k - 1). Larger k gives finer control
+     * at low speeds, and k = 0 is linear.
+     * \param k How sharply the curve bends
+     * \param deadband Readings at or below this magnitude output 0
+     */
+    static constexpr Input_Curve exponential(double k, int deadband = 0) {
+        return Input_Curve(E_SHAPE_EXP, k, nullptr, 0, deadband);
+    }
+
+    /**
+     * Function: piecewise
+     * Straight lines between the given points, e.g. {{64, 32}, {127, 127}}
+     * for a quarter of full power at half stick.
+     * \param points The points, in joystick units and sorted by input. Only
+     *               read while the curve is built.
+     * \param count The number of points
+     * \param deadband Readings at or below this magnitude output 0. The
+     *                 points apply to the stretched range outside it.
+     */
+    static constexpr Input_Curve piecewise(const input_curve_point_t *points,
+                                           size_t count, int deadband = 0) {
+        return Input_Curve(E_SHAPE_PIECEWISE, 0, points, count, deadband);
+    }
+
+    /**
+     * Function: apply
+     * \param reading A joystick reading, from -127 to 127
+     * \returns The shaped output, in mV
+     */
+    constexpr int apply(int32_t reading) const {
+        if (reading > INPUT_CURVE_MAX_INPUT)
+            reading = INPUT_CURVE_MAX_INPUT;
+        else if (reading < -INPUT_CURVE_MAX_INPUT)
+            reading = -INPUT_CURVE_MAX_INPUT;
+        return table[128 + reading];
+    }
+};
+
+#endif /* Input_Curve.hpp */
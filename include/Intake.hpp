@@ -2,20 +2,96 @@
  * \file Intake.hpp
  * This file contains the class declaration for the Intake class.
  * This class represents the subsystem used to collect disks.
+ *
+ * in, out and stop only say which way the intake should run. The intake's own
+ * task drives the motors, and while running in, watches for a jam: the
+ * motors turning slower than JAM_VELOCITY while drawing more than JAM_CURRENT
+ * for JAM_TIME. On a jam, the intake runs out for the reverse time to free
+ * the disk, then in again. After the set number of attempts in a row it gives
+ * up and stops, until it is next told to stop or run out, so that a jammed
+ * disk can't burn out the motors or hold up autonomous. Each jam is printed
+ * and recorded in the Trace.
  */
 
 #ifndef INTAKE_HPP
 #define INTAKE_HPP
 
+#include <atomic>
+#include <cstdint>
 #include <initializer_list>
 
+#include "Controller_Service.hpp"
 #include "Motor_Group.hpp"
+#include "Subsystem.hpp"
 #include "pros/misc.h"
 
-class Intake {
+// How long turn_degree waits for the intake to reach its target, in ms
+#define INTAKE_MOVE_TIMEOUT 1000
+
+typedef enum intake_state_e {
+    E_INTAKE_STOPPED = 0,
+    E_INTAKE_IN,
+    E_INTAKE_OUT,
+    E_INTAKE_CLEARING, // Running out to free a jam
+    E_INTAKE_JAMMED,   // Gave up on a jam, and stopped
+    E_INTAKE_MOVING,   // Turning to a position in turn_degree
+    E_INTAKE_HOLDING   // Holding the position turn_degree reached
+} intake_state_e_t;
+
+class Intake : public Subsystem<Intake> {
+    friend class Subsystem<Intake>;
+
   private:
     Motor_Group motors;
 
+    // The direction asked for (1 in, -1 out, 0 stopped, 2 while turn_degree
+    // is moving, or 3 once it has got there), and the state the task has put
+    // the motors in
+    std::atomic<int> direction{0};
+    std::atomic<intake_state_e_t> state{E_INTAKE_STOPPED};
+
+    // How long to run out to free a jam, in ms, and how many times in a row
+    // to try before giving up
+    uint32_t reverse_time = 250;
+    int max_attempts = 3;
+
+    // The direction the task last acted on, when the intake last started
+    // running in, when it started looking jammed, or 0, when it started
+    // running out to free a jam, and the attempts so far. Only used by the
+    // task.
+    int applied = 0;
+    uint32_t run_start = 0;
+    uint32_t stall_start = 0;
+    uint32_t clear_start = 0;
+    int attempts = 0;
+
+    // The number of jams seen since the program started
+    std::atomic<uint32_t> jams{0};
+
+    // Running in slower than JAM_VELOCITY RPM while drawing more than
+    // JAM_CURRENT mA for JAM_TIME ms is a jam. Spinning up is left out for
+    // JAM_SETTLE ms, and attempts start again from 0 after running freely
+    // for JAM_RESET ms.
+    static constexpr double JAM_VELOCITY = 20;
+    static constexpr int JAM_CURRENT = 1500;
+    static constexpr uint32_t JAM_TIME = 200;
+    static constexpr uint32_t JAM_SETTLE = 300;
+    static constexpr uint32_t JAM_RESET = 1000;
+
+    // How far above JAM_CURRENT the motors' limits must stay between them for
+    // a stalled intake to count as jammed, in mA
+    static constexpr int JAM_CURRENT_MARGIN = 500;
+
+    // Puts the motors in the direction asked for or watches for a jam,
+    // called by the intake's task
+    uint32_t tick(uint32_t now);
+
+    // Puts the motors in the direction asked for
+    void apply(int dir, uint32_t now);
+
+    // Watches for a jam while running in, and runs out to free one
+    void watch_jam(uint32_t now);
+
   public:
     /**
      * The Constructor for the Intake Class
@@ -34,16 +110,24 @@ class Intake {
      * Function: driver
      *
      * The function used to control the intake in driver control
-     * \param controller The controller ID whose buttons to read
+     * \param snapshot The controller readings to use
      * \param in_button The digital button ID to press to run the motors to
      *                  collect disks
      * \param out_button The digital button ID to press to run the motors to
      *                   expel disks
      */
-    void driver(pros::controller_id_e_t controller,
+    void driver(const controller_snapshot_t &snapshot,
                 pros::controller_digital_e_t in_button,
                 pros::controller_digital_e_t out_button);
 
+    /**
+     * Function: set_jam_handling
+     * \param reverse_time How long to run out to free a jam, in ms
+     * \param attempts How many times in a row to try freeing a jam before
+     *                 giving up
+     */
+    void set_jam_handling(uint32_t reverse_time, int attempts);
+
     // Wraps the necessary code to run the motors to collect disks
     void in();
     // Wraps the necessary code to run the motors to expel disks from the intake
@@ -51,9 +135,35 @@ class Intake {
     // Wraps the necessary code to stop the motors
     void stop();
 
-    // Rotates the intake a specific number of degrees. Used for the attached
-    // roller rotation mechanism.
-    void turn_degree(double degrees);
+    /**
+     * Function: turn_degree
+     * Rotates the intake a specific number of degrees. Used for the attached
+     * roller rotation mechanism. Once there, the motors hold the position
+     * until the intake is next told to run or stop.
+     * \param timeout How long to wait for the intake to get there, in ms,
+     *                from when the move starts
+     * \returns false if it didn't get there in time, in which case it is
+     *          stopped
+     */
+    bool turn_degree(double degrees, uint32_t timeout = INTAKE_MOVE_TIMEOUT);
+
+    intake_state_e_t get_state();
+
+    // Returns the number of jams seen since the program started
+    uint32_t get_jams();
+
+    // The state, the direction asked for and the motors' velocity and current
+    void snapshot(subsystem_snapshot_t &snap);
+
+    // Stops the intake
+    void safe_stop();
+
+    // Returns the motors, e.g. for the power manager to limit their current
+    Motor_Group &get_motors();
+
+    // Returns the lowest current limit per motor, in mA, at which a jam can
+    // still be detected, e.g. for the power manager's minimum
+    int get_jam_current_limit();
 
     /**
      * Function: print_telemetry
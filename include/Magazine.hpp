@@ -0,0 +1,191 @@
+/**
+ * \file Magazine.hpp
+ * This file contains the class declaration for the Magazine class, which
+ * keeps track of how many disks the robot is holding.
+ *
+ * The count is worked out by the magazine's own task from what the motors
+ * already report, with sensors used if they are fitted:
+ *
+ *  - Disks coming in: a disk caught by the intake loads its motors, so the
+ *    current rises above its running level for a while. A disk pushed out
+ *    while the intake runs backwards does the same. With an optical sensor
+ *    at the mouth of the intake, a disk passing it is used instead.
+ *  - Disks fired: a disk taking energy from the flywheel makes its velocity
+ *    dip. If the flywheel was at speed and didn't dip during a shot, the shot
+ *    was dry and the magazine must be empty.
+ *  - With a distance sensor looking down the magazine, the count is read
+ *    from the height of the stack instead, and the other signals only raise
+ *    events.
+ *
+ * The count can be unknown, e.g. at the start of driver control if nothing
+ * was tracked before. It becomes known when it is set, read from a distance
+ * sensor or found to be 0 by a dry fire. Each change raises an event, which
+ * autonomous and driver code can read with next_event.
+ *
+ * The thresholds are starting points, and should be checked against the
+ * currents and velocities the health monitor and flywheel log on the robot.
+ */
+
+#ifndef MAGAZINE_HPP
+#define MAGAZINE_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include "Flywheel.hpp"
+#include "Indexer.hpp"
+#include "Intake.hpp"
+#include "Subsystem.hpp"
+#include "api.h"
+
+// The most disks the robot can hold
+#define MAGAZINE_CAPACITY 3
+
+// The count when it isn't known
+#define MAGAZINE_UNKNOWN -1
+
+// The number of events kept for next_event
+#define MAGAZINE_EVENTS 16
+
+typedef enum magazine_event_e {
+    E_MAGAZINE_DISK_IN = 0,
+    E_MAGAZINE_DISK_OUT,
+    E_MAGAZINE_FIRED,
+    E_MAGAZINE_DRY_FIRE,
+    E_MAGAZINE_FULL
+} magazine_event_e_t;
+
+typedef struct magazine_event_s {
+    // In ms since the program started
+    uint32_t time;
+    magazine_event_e_t type;
+
+    // The count after the event, or MAGAZINE_UNKNOWN
+    int count;
+} magazine_event_t;
+
+class Magazine : public Subsystem<Magazine> {
+    friend class Subsystem<Magazine>;
+
+  private:
+    Intake &intake;
+    Indexer &indexer;
+    Flywheel &flywheel;
+
+    std::atomic<int> count{MAGAZINE_UNKNOWN};
+
+    magazine_event_t events[MAGAZINE_EVENTS];
+    std::atomic<uint32_t> event_seq{0};
+
+    // Sensors, with 0 for none fitted. Set before the task starts.
+    uint8_t distance_port = 0;
+    double empty_distance = 0, disk_height = 0;
+    uint8_t optical_port = 0;
+    int32_t proximity_threshold = 0;
+
+    // The intake's direction (1 in, -1 out, 0 stopped), when it started
+    // running that way and its current when not loaded by a disk, in mA.
+    // Only used by the task.
+    int intake_dir = 0;
+    uint32_t run_start = 0;
+    double baseline = 0;
+    bool in_spike = false;
+    uint32_t spike_start = 0;
+
+    // Whether the optical sensor sees a disk. Only used by the task.
+    bool disk_seen = false;
+
+    // The last count read from the distance sensor, and how many reads in a
+    // row have agreed with it. Only used by the task.
+    int distance_count = MAGAZINE_UNKNOWN;
+    int distance_reads = 0;
+
+    // The shot being watched: whether there is one, the flywheel's speed as
+    // it started and the lowest since, in RPM, and when the watch ends, or 0
+    // while the indexer is still firing
+    std::atomic<bool> in_shot{false};
+    double shot_speed = 0, shot_low = 0;
+    bool shot_at_speed = false;
+    uint32_t shot_end = 0;
+
+    // Watches each signal, called by the magazine's task
+    uint32_t tick(uint32_t now);
+
+    // Watch each signal, called once per tick
+    void update_intake(uint32_t now);
+    void update_distance(uint32_t now);
+    void update_shot(uint32_t now);
+
+    // Counts the shot being watched as fired or dry
+    void end_shot(uint32_t now);
+
+    // Changes the count by a disk coming in or going out and raises the event
+    void disk_moved(magazine_event_e_t type, uint32_t now);
+
+    void raise(magazine_event_e_t type, uint32_t now);
+
+  public:
+    /**
+     * Function: Magazine
+     * \param intake Whose current shows disks coming in
+     * \param indexer Whose shots are watched
+     * \param flywheel Whose velocity dips when a disk is fired
+     */
+    Magazine(Intake &intake, Indexer &indexer, Flywheel &flywheel);
+
+    /**
+     * Function: set_distance_sensor
+     * Reads the count from a distance sensor looking down the stack of disks.
+     * \param port The sensor's smart port
+     * \param empty_distance The reading with the magazine empty, in mm
+     * \param disk_height How much each disk shortens the reading, in mm
+     */
+    void set_distance_sensor(uint8_t port, double empty_distance,
+                             double disk_height);
+
+    /**
+     * Function: set_optical_sensor
+     * Counts disks coming in with an optical sensor at the mouth of the
+     * intake instead of the intake's current.
+     * \param port The sensor's smart port
+     * \param threshold The proximity reading (0-255) that means a disk is in
+     *                  front of the sensor
+     */
+    void set_optical_sensor(uint8_t port, int32_t threshold);
+
+    // Returns how many disks are loaded, or MAGAZINE_UNKNOWN
+    int get_count();
+
+    // Sets how many disks are loaded, e.g. the preloads, or MAGAZINE_UNKNOWN
+    void set_count(int disks);
+
+    // Returns whether the magazine is known to be full
+    bool is_full();
+
+    // Returns whether a shot is still being watched, so the count may be
+    // about to drop
+    bool is_counting_shot();
+
+    /**
+     * Function: next_event
+     * Returns the events after the one last read, oldest first. Events that
+     * have been overwritten since are skipped.
+     * \param seq The sequence number of the next event to read, 0 at first.
+     *            Advanced past the event returned.
+     * \returns false if there is no new event
+     */
+    bool next_event(uint32_t &seq, magazine_event_t &event);
+
+    // Returns the name of an event, for printing
+    static const char *event_name(magazine_event_e_t type);
+
+    // The count as the state, and whether a shot is being counted as the
+    // target
+    void snapshot(subsystem_snapshot_t &snap);
+
+    // The magazine only watches, so there is nothing to stop. The count is
+    // kept, as the disks are still loaded.
+    void safe_stop();
+};
+
+#endif /* Magazine.hpp */
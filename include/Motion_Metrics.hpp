@@ -0,0 +1,148 @@
+/**
+ * \file Motion_Metrics.hpp
+ * This file contains the class declaration for the Motion_Metrics class, which
+ * measures how well each closed-loop motion performed and keeps the results
+ * in a fixed-size table.
+ *
+ * For every motion, it records:
+ *  - Rise time: how long it took to first cover 90% of the distance
+ *  - Overshoot: how far past the target the mechanism went
+ *  - Settle time: how long the motion took to end
+ *  - Steady-state error: the distance from the target when the motion ended
+ *  - Peak current: the highest total current drawn during the motion
+ *  - Exit reason: why the motion ended (see Settle_Detector.hpp)
+ *
+ * The table can be printed over serial or saved to the SD card, and the
+ * results from several runs summarized by tools/motion_summary.py.
+ */
+
+#ifndef MOTION_METRICS_HPP
+#define MOTION_METRICS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "Settle_Detector.hpp"
+
+// The number of motions that can be recorded. Further motions are not
+// recorded until the table is cleared.
+#define MOTION_METRICS_CAPACITY 64
+
+// The fraction of the distance that counts as having risen
+#define MOTION_METRICS_RISE_FRACTION 0.9
+
+typedef struct motion_record_s {
+    // What was commanded: the name of the motion, and the distance or angle
+    // passed to it
+    const char *type;
+    double amount;
+
+    // The target, in sensor units (e.g. degrees of wheel rotation)
+    double target;
+
+    // When the motion started, in ms since the program started
+    uint32_t start_time;
+
+    // Times are in ms from the start of the motion. The rise time is 0 if the
+    // motion never covered MOTION_METRICS_RISE_FRACTION of the distance.
+    uint32_t rise_time;
+    uint32_t settle_time;
+
+    // In sensor units
+    double overshoot;
+    double steady_state_error;
+
+    // In mA
+    int peak_current;
+
+    // The largest disagreement between the motors' encoders, in sensor units
+    double peak_slip;
+
+    settle_exit_e_t exit_reason;
+} motion_record_t;
+
+class Motion_Metrics {
+  private:
+    motion_record_t records[MOTION_METRICS_CAPACITY];
+
+    // The number of finished records. Only incremented once a record is
+    // complete, so other tasks can read records[0..count) at any time.
+    std::atomic<size_t> count = 0;
+
+    // The record for the motion in progress, and how far it has got
+    motion_record_t current;
+    double progress = 0;
+    bool active = false;
+    bool risen = false;
+
+    // Prints the table in CSV form, header included
+    void write_csv(FILE *file);
+
+  public:
+    /**
+     * Function: begin
+     * Starts recording a new motion. A motion already in progress is added
+     * to the table as superseded.
+     * \param type The name of the motion, e.g. "straight". Must be a string
+     *             literal or otherwise outlive the table.
+     * \param amount The distance or angle that was commanded
+     * \param target The target, in sensor units
+     * \param now The current time, in ms
+     */
+    void begin(const char *type, double amount, double target, uint32_t now);
+
+    /**
+     * Function: update
+     * Records one control loop iteration of the motion in progress
+     * \param progress How far the mechanism has moved toward the target, in
+     *                 sensor units. Negative if it has moved away.
+     * \param current The total current drawn, in mA
+     * \param slip How far apart the motors' encoders are, in sensor units
+     * \param now The current time, in ms
+     */
+    void update(double progress, int current, double slip, uint32_t now);
+
+    /**
+     * Function: end
+     * Finishes the motion in progress and adds it to the table
+     * \param error The distance from the target, in sensor units
+     * \param reason Why the motion ended
+     * \param now The current time, in ms
+     */
+    void end(double error, settle_exit_e_t reason, uint32_t now);
+
+    /**
+     * Function: cut
+     * Adds the motion in progress, if any, to the table as cut short, e.g.
+     * when the robot is disabled. The task updating the motion must not be
+     * running.
+     * \param now The current time, in ms
+     */
+    void cut(uint32_t now);
+
+    // Returns the number of finished motions in the table
+    size_t size();
+
+    // Returns a finished motion. index must be less than size().
+    const motion_record_t &get(size_t index);
+
+    // Empties the table
+    void clear();
+
+    // Prints the table over serial, in the same CSV format used by save()
+    void print();
+
+    /**
+     * Function: save
+     * Writes the table to a new CSV file on the SD card, so that earlier runs
+     * are kept. The file is named <prefix>_<n>.csv, using the first n that
+     * isn't taken.
+     * \param prefix The start of the file name, e.g. "/usd/motions"
+     * \returns false if there is no SD card or the file could not be written
+     */
+    bool save(const char *prefix);
+};
+
+#endif /* Motion_Metrics.hpp */
@@ -15,16 +15,67 @@
  *
  * All of these functions wrap the PROS C Motor API functions with
  * the same, or nearly the same, name.
+ *
+ * Individual motors can be derated, so that they are sent only part of each
+ * movement command, and left out of the group's averages. A health monitor
+ * uses these to keep a group running on its healthy motors when one of them
+ * overheats, stalls or disconnects.
+ *
+ * The averages skip readings that aren't finite (PROS_ERR_F from a
+ * disconnected motor), and can be made robust to one bad reading with
+ * set_aggregation. Each call to get_avg_position also records how far each
+ * motor is from the result, which shows an encoder that has slipped or been
+ * reset.
+ *
+ * With E_MOTOR_GROUP_AGGREGATE_REJECT_JUMPS, get_avg_position compares how far
+ * each motor moved since the last call. A motor that moved more than
+ * MOTOR_GROUP_JUMP further than the others is taken to have jumped, e.g. from
+ * its encoder being reset, and its movement is replaced by theirs from then
+ * on. With two motors, the one that moved against the direction last
+ * commanded jumped, or otherwise the one that moved further. get_avg_position
+ * must then be called from one task, e.g. the control loop's.
  */
 
 #ifndef MOTOR_GROUP_HPP
 #define MOTOR_GROUP_HPP
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <vector>
 
 #include "api.h"
 
+// The most motors in a group that can be derated or averaged. Motors past this
+// are still commanded, but not read by the averages.
+#define MOTOR_GROUP_MAX_MOTORS 8
+
+// How much further than the others a motor must move between two calls to
+// get_avg_position to count as a jump, in encoder units. A drive motor turns
+// about 20 degrees in a 5 ms iteration at full speed.
+#define MOTOR_GROUP_JUMP 45
+
+/**
+ * Enumerated Type used to choose how get_avg_position, get_avg_velocity and
+ * get_avg_voltage combine the motors' readings
+ */
+typedef enum motor_group_aggregate_e {
+    // The mean of every reading
+    E_MOTOR_GROUP_AGGREGATE_MEAN = 0,
+    // The middle reading, or the mean of the middle two
+    E_MOTOR_GROUP_AGGREGATE_MEDIAN,
+    // The mean without the highest and lowest readings, when there are at
+    // least three
+    E_MOTOR_GROUP_AGGREGATE_TRIMMED_MEAN,
+    // The mean weighted by how much of its output each motor is given, so
+    // that derated motors count for less
+    E_MOTOR_GROUP_AGGREGATE_WEIGHTED,
+    // The mean, with each position corrected for jumps (see above). Works
+    // with two motors.
+    E_MOTOR_GROUP_AGGREGATE_REJECT_JUMPS
+} motor_group_aggregate_e_t;
+
 class Motor_Group {
   private:
     /**
@@ -35,6 +86,76 @@ class Motor_Group {
      */
     std::vector<int> motor_ports;
 
+    /**
+     * How much is taken off each motor's commands, in percent, and one bit
+     * per motor left out of the averages. Indexed like motor_ports. These
+     * are set from a health monitor's task while the control tasks read
+     * them, so they are atomic.
+     */
+    std::atomic<uint8_t> derates[MOTOR_GROUP_MAX_MOTORS]{};
+    std::atomic<uint32_t> ignored{0};
+
+    std::atomic<motor_group_aggregate_e_t> aggregation{
+        E_MOTOR_GROUP_AGGREGATE_MEAN};
+
+    /**
+     * How far each motor's position was from the group's at the last call to
+     * get_avg_position, or NAN if it was left out. Float so that the reads
+     * from other tasks are atomic.
+     */
+    std::atomic<float> deviations[MOTOR_GROUP_MAX_MOTORS]{};
+
+    /**
+     * For E_MOTOR_GROUP_AGGREGATE_REJECT_JUMPS: each motor's reading at the
+     * last call to get_avg_position, or NAN before the first, and what is
+     * added to it to take out its jumps. Only used by get_avg_position.
+     */
+    double last_positions[MOTOR_GROUP_MAX_MOTORS];
+    double jump_offsets[MOTOR_GROUP_MAX_MOTORS];
+
+    // Set when the encoders are reset, so that the readings before aren't
+    // compared with those after
+    std::atomic<bool> positions_reset{true};
+
+    // The sign of the last movement command, or 0 for none or a stop
+    std::atomic<int8_t> command_dir{0};
+
+    /**
+     * Combines readings with the current aggregation mode. Readings that
+     * aren't finite are skipped. Sorts the readings in place.
+     *
+     * @param values One reading per motor
+     * @param weights One weight per motor, used by the weighted mode
+     * @param count The number of readings
+     * @returns The combined reading, or 0 if none are finite
+     */
+    double aggregate(double *values, double *weights, size_t count);
+
+    /**
+     * Reads each averaged motor with the given function and combines them.
+     * Motors left out are NAN in values.
+     */
+    double read_aggregate(double (*read)(uint8_t), double *values);
+
+    /**
+     * Reads each averaged motor's position and combines them, correcting
+     * each for its jumps. Motors left out are NAN in values, which are the
+     * readings before correcting.
+     */
+    double read_positions_rejecting_jumps(double *values);
+
+    // Records the direction of a movement command
+    void set_command_dir(double command);
+
+    // Returns a command scaled down by the motor's derate
+    double derated(size_t index, double command);
+
+    // Returns whether the motor is sent movement commands
+    bool is_commanded(size_t index);
+
+    // Returns whether the motor's readings go into the averages
+    bool is_averaged(size_t index);
+
   public:
     /**
      * @param ports A list of integers representing the ports for each motor.
@@ -211,7 +332,9 @@ class Motor_Group {
      * This function returns the average current position of every motor
      * in the group, using the internal motor encoders. It uses the
      * PROS motor_get_position function and calculates the average of
-     * those values
+     * those values, as set by set_aggregation. Ignored motors and readings
+     * that aren't finite are left out. It doesn't allocate, so it is safe to
+     * call every iteration of a control loop.
      *
      * @returns The average encoder position for all motor encoders
      */
@@ -222,12 +345,71 @@ class Motor_Group {
      * This function returns the average current velocity of every motor
      * in the group, using the internal motor encoders. It uses the
      * PROS motor_get_velocity function and calculates the average of
-     * those values
+     * those values, like get_avg_position.
      *
      * @returns The current average motor velocity
      */
     double get_avg_velocity(void);
 
+    /**
+     * Function: get_avg_voltage
+     * This function returns the average voltage currently applied to every
+     * motor in the group, as reported by the PROS motor_get_voltage function.
+     * The readings are combined like get_avg_position.
+     *
+     * @returns The average motor voltage, in millivolts
+     */
+    double get_avg_voltage(void);
+
+    /**
+     * Function: get_position_deviation
+     * This function returns how far one motor's position was from the
+     * group's at the last call to get_avg_position. It doesn't read the
+     * motors, so it can be called from any task.
+     *
+     * @param index The motor's position in the list of ports
+     * @returns The difference in encoder units, or NAN if the motor was left
+     *          out or its reading wasn't finite
+     */
+    double get_position_deviation(size_t index);
+
+    /**
+     * Function: get_position_disagreement
+     * This function returns the largest difference between any motor's
+     * position and the group's at the last call to get_avg_position. A
+     * disagreement that grows means a motor's encoder has slipped, skipped or
+     * been reset.
+     *
+     * @returns The largest difference in encoder units, or 0 if there were no
+     *          readings
+     */
+    double get_position_disagreement(void);
+
+    /**
+     * Function: get_total_current_draw
+     * This function returns the sum of the current drawn by every motor in
+     * the group. Unlike get_current_draws, it doesn't allocate, so it is safe
+     * to call every iteration of a control loop.
+     *
+     * @returns The total current draw, in mA
+     */
+    int get_total_current_draw(void);
+
+    /**
+     * Function: size
+     *
+     * @returns The number of motors in the group
+     */
+    size_t size(void);
+
+    /**
+     * Function: get_port
+     *
+     * @param index The motor's position in the list of ports
+     * @returns The motor's port, or PROS_ERR if there is no such motor
+     */
+    int get_port(size_t index);
+
     /**
      * Function: get_brake_modes
      * This function gets the current brake modes for each motor
@@ -498,6 +680,57 @@ class Motor_Group {
      */
     void set_zero_position(double zero_pos);
 
+    /**
+     * Function: set_aggregation
+     * This function sets how get_avg_position, get_avg_velocity and
+     * get_avg_voltage combine the readings of the motors. The default is the
+     * mean. The median and trimmed mean ignore one bad reading, but are the
+     * same as the mean for groups of two motors. Rejecting jumps works with
+     * two motors, but only for positions.
+     *
+     * @param mode The new aggregation mode
+     */
+    void set_aggregation(motor_group_aggregate_e_t mode);
+
+    /**
+     * Function: set_motor_derate
+     * This function takes some of the output off one motor. Every movement
+     * command (the voltage, or the velocity for velocity and position
+     * commands) is scaled down for that motor only; brake() is unaffected.
+     * A motor derated by 100 percent is not sent movement commands at all.
+     *
+     * @param index The motor's position in the list of ports
+     * @param percent How much to take off, from 0 (full output) to 100
+     */
+    void set_motor_derate(size_t index, int percent);
+
+    /**
+     * Function: get_motor_derate
+     *
+     * @param index The motor's position in the list of ports
+     * @returns How much is taken off the motor's output, in percent
+     */
+    int get_motor_derate(size_t index);
+
+    /**
+     * Function: set_motor_ignored
+     * This function leaves one motor's readings out of get_avg_position,
+     * get_avg_velocity and get_avg_voltage, e.g. because its encoder can't be
+     * trusted. If every motor is ignored, the averages use them all anyway.
+     *
+     * @param index The motor's position in the list of ports
+     * @param ignored Whether to leave the motor out
+     */
+    void set_motor_ignored(size_t index, bool ignored);
+
+    /**
+     * Function: is_motor_ignored
+     *
+     * @param index The motor's position in the list of ports
+     * @returns Whether the motor is left out of the averages
+     */
+    bool is_motor_ignored(size_t index);
+
     /**
      * Function: reset_positions
      * This function resets the positions of the internal motor encoders.
@@ -0,0 +1,167 @@
+/**
+ * \file Power_Manager.hpp
+ * This file contains the class declaration for the Power_Manager class, which
+ * keeps the total current drawn by the robot's motors under a budget.
+ *
+ * Each motor group is registered with a priority. Every period, the manager
+ * reads how much current each group is drawing and shares the budget out by
+ * priority, setting each group's motor current limits to its share:
+ *
+ *  - While every group could draw its maximum without going over the budget,
+ *    or the total draw is well below the budget, every group is left at its
+ *    maximum. Limiting starts once the total draw reaches ENGAGE_FRACTION of
+ *    the budget, and stops once it falls below RELEASE_FRACTION.
+ *  - While limiting, every group is first given its minimum. The rest of the
+ *    budget goes to the groups in priority order, each getting what it needs:
+ *    its maximum if it is already drawing close to its limit (so it would
+ *    draw more if it could), or what it is drawing plus some headroom if
+ *    not. Anything left after that is handed out in priority order up to
+ *    each group's maximum.
+ *
+ * Groups with the same priority are served together, splitting what's left
+ * in proportion to their needs when there isn't enough for all of them.
+ *
+ * A throttled group that starts drawing close to its limit again counts as
+ * needing its maximum from the next period on.
+ *
+ * When a group's limit changes, a line is printed to the terminal:
+ *
+ *     P,<time ms>,<action>,<group>,<limit per motor mA>,<group draw mA>,
+ *     <total draw mA>
+ *
+ * where the action is throttle if the limit was lowered, raise if it was
+ * raised but is still below the group's maximum, or restore if it is back at
+ * the maximum. Changes smaller than MIN_CHANGE are skipped, other than
+ * restores, so noise in the readings doesn't change the limits every period.
+ * A group's first throttle and its restore are always printed, and the
+ * changes in between at most every LOG_INTERVAL, so that a long stretch of
+ * limiting doesn't flood the terminal.
+ */
+
+#ifndef POWER_MANAGER_HPP
+#define POWER_MANAGER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Motor_Group.hpp"
+#include "Subsystem.hpp"
+#include "pros/rtos.h"
+
+// The most groups that can be managed
+#define POWER_MANAGER_MAX_GROUPS 8
+
+// How often the limits are updated, in ms
+#define POWER_MANAGER_PERIOD 20
+
+// The highest current limit the motors accept, in mA
+#define POWER_MANAGER_MOTOR_MAX_LIMIT 2500
+
+typedef struct power_group_s {
+    const char *name;
+    Motor_Group *motors;
+    int priority;
+
+    // The range the limit is kept in, per motor, in mA
+    int min_limit;
+    int max_limit;
+
+    // The limit currently set, per motor, and the most recent total draw of
+    // the group, in mA
+    int limit;
+    int draw;
+
+    // How many times the group has been throttled from its maximum
+    uint32_t throttle_count;
+
+    // When the group's limit was last printed, in ms
+    uint32_t last_log;
+} power_group_t;
+
+class Power_Manager : public Subsystem<Power_Manager> {
+    friend class Subsystem<Power_Manager>;
+
+  private:
+    power_group_t groups[POWER_MANAGER_MAX_GROUPS];
+    size_t group_count = 0;
+
+    // The total current allowed across every group, in mA
+    int budget = 16000;
+
+    // Whether the total draw has come close enough to the budget for the
+    // limits to be shared out
+    bool limiting = false;
+
+    // The current above a group's draw, per motor, that it is given when it
+    // isn't limit-bound, in mA
+    static constexpr int HEADROOM = 500;
+
+    // A group drawing at least this fraction of its limit is limit-bound
+    static constexpr double LIMIT_BOUND = 0.9;
+
+    // Smaller changes to a limit are not applied, in mA
+    static constexpr int MIN_CHANGE = 100;
+
+    // The fractions of the budget the total draw must reach for limiting to
+    // start, and fall below for it to stop
+    static constexpr double ENGAGE_FRACTION = 0.85;
+    static constexpr double RELEASE_FRACTION = 0.7;
+
+    // How often a group's limit changes are printed at most while it stays
+    // throttled, in ms
+    static constexpr uint32_t LOG_INTERVAL = 500;
+
+    // Updates the limits
+    uint32_t tick(uint32_t now);
+
+    // Reads the draws and works out every group's new limit
+    void update();
+
+    // Hands out up to remaining mA, adding each group's share of its need to
+    // its grant. Takes from remaining what was handed out.
+    void share(const int *needs, int *grants, int &remaining);
+
+    // Sets a group's limit, per motor, and logs the change
+    void apply(power_group_t &group, int limit, int total_draw);
+
+  public:
+    Power_Manager();
+
+    /**
+     * Function: add_group
+     * Puts a motor group under the manager's control. Must be called before
+     * the task is started. The group's current limits are set to max_limit.
+     * \param name The name used in the log. Must be a string literal or
+     *             otherwise outlive the manager.
+     * \param motors The group
+     * \param priority Higher priorities get their share of the budget first
+     * \param min_limit The lowest the limit may go, per motor, in mA
+     * \param max_limit The highest the limit may go, per motor, in mA
+     * \returns false if POWER_MANAGER_MAX_GROUPS groups have already been
+     *          added
+     */
+    bool add_group(const char *name, Motor_Group *motors, int priority,
+                   int min_limit = 500,
+                   int max_limit = POWER_MANAGER_MOTOR_MAX_LIMIT);
+
+    /**
+     * Function: set_budget
+     * \param total_ma The total current allowed across every group, in mA
+     */
+    void set_budget(int total_ma);
+
+    // Returns the state of a group, highest priority first
+    size_t size();
+    const power_group_t &get(size_t index);
+
+    // Prints every group's limit, draw and throttle count to the terminal
+    void print_status();
+
+    // Whether the limits are being shared out, the budget and the total draw
+    void snapshot(subsystem_snapshot_t &snap);
+
+    // Leaves the limits to follow the draw, which falls away at rest
+    void safe_stop();
+};
+
+#endif /* Power_Manager.hpp */
@@ -2,16 +2,53 @@
  * \file Roller.hpp
  * This file contains the class declaration for the Roller class, which
  * represents the subsystem used to rotate the rollers.
+ *
+ * With an optical sensor facing the roller, the roller can be scored by
+ * color rather than by turning a fixed amount, so that it scores whichever
+ * way round it started. start_color_spin turns the roller until the sensor
+ * has seen the color asked for for CONFIRM_TIME, then brakes. The roller's
+ * task reads the sensor every ROLLER_COLOR_PERIOD ms while it spins, and
+ * gives up after the timeout. The time each spin took is printed and kept
+ * for get_color_time.
  */
 
 #ifndef ROLLER_HPP
 #define ROLLER_HPP
 
+#include "Controller_Service.hpp"
 #include "Motor_Group.hpp"
+#include "Subsystem.hpp"
 #include "pros/misc.h"
+#include <atomic>
+#include <cstdint>
 #include <initializer_list>
 
-class Roller {
+// How long clockwise and counterclockwise wait for the roller to turn by the
+// amount asked for, in ms
+#define ROLLER_SPIN_TIMEOUT 1500
+
+// How often the optical sensor is read during a color spin, in ms, and how
+// long a color spin lasts at most by default
+#define ROLLER_COLOR_PERIOD 5
+#define ROLLER_COLOR_TIMEOUT 2000
+
+typedef enum roller_color_e {
+    E_ROLLER_NONE = 0, // Neither color, or nothing in front of the sensor
+    E_ROLLER_RED,
+    E_ROLLER_BLUE
+} roller_color_e_t;
+
+typedef enum roller_color_state_e {
+    E_ROLLER_COLOR_IDLE = 0,
+    E_ROLLER_COLOR_SPINNING,
+    E_ROLLER_COLOR_CONFIRMING, // Seeing the color, waiting to be sure
+    E_ROLLER_COLOR_DONE,
+    E_ROLLER_COLOR_TIMED_OUT
+} roller_color_state_e_t;
+
+class Roller : public Subsystem<Roller> {
+    friend class Subsystem<Roller>;
+
   private:
     // The motors controlling the roller mechanism. There should only be one,
     // but if, for whatever reason, more motors need to be added, adding them
@@ -25,6 +62,43 @@ class Roller {
     // reversing the motors
     double gear_ratio;
 
+    // The target of the last spin started, in motor degrees
+    double spin_targ = 0;
+
+    // The optical sensor's port, or 0 if there isn't one
+    uint8_t optical_port = 0;
+
+    // The color spin: the color to stop on, how long it may last, in ms, and
+    // its state
+    std::atomic<roller_color_e_t> color_target{E_ROLLER_NONE};
+    uint32_t color_timeout = 0;
+    std::atomic<roller_color_state_e_t> color_state{E_ROLLER_COLOR_IDLE};
+
+    // When the color spin started and when the color was first seen, in ms,
+    // and how long the last one took
+    uint32_t color_start = 0;
+    uint32_t seen_start = 0;
+    std::atomic<uint32_t> color_time{0};
+
+    // Hue bands of each color, in degrees, and how close the roller must be
+    // to the sensor for its color to count (0-255)
+    static constexpr double RED_HUE_LOW = 340;
+    static constexpr double RED_HUE_HIGH = 20;
+    static constexpr double BLUE_HUE_LOW = 190;
+    static constexpr double BLUE_HUE_HIGH = 250;
+    static constexpr int32_t MIN_PROXIMITY = 100;
+
+    // How long the color must be seen for before braking, in ms
+    static constexpr uint32_t CONFIRM_TIME = 20;
+
+    // Runs one step of the color spin, called by the roller's task
+    uint32_t tick(uint32_t now);
+
+    // Brakes and reports the end of the color spin, unless it has left the
+    // state it was in
+    void end_color_spin(roller_color_state_e_t from, roller_color_state_e_t to,
+                        uint32_t now);
+
   public:
     /**
      * The constructor for the Roller class
@@ -40,22 +114,111 @@ class Roller {
     // Rotates the roller clockwise. Used for opcontrol
     void clockwise();
 
-    // Rotates the roller clockwise by a given degree amount. Used for
-    // autonomous
-    void clockwise(double degrees);
+    /**
+     * Function: clockwise
+     * Rotates the roller clockwise by a given degree amount. Used for
+     * autonomous
+     * \param timeout How long to wait for the roller to get there, in ms
+     * \returns false if it didn't get there in time, in which case it is
+     *          stopped
+     */
+    bool clockwise(double degrees, uint32_t timeout = ROLLER_SPIN_TIMEOUT);
 
     // Rotates the roller counterclockwise. Used for opcontrol
     void counterclockwise();
 
-    // Rotates the roller counterclockwise by a given degree amount. Used for
-    // autonomous
-    void counterclockwise(double degrees);
+    // Rotates the roller counterclockwise by a given degree amount, as
+    // clockwise. Used for autonomous
+    bool counterclockwise(double degrees,
+                          uint32_t timeout = ROLLER_SPIN_TIMEOUT);
 
     // Sets the mechanism's motors to stop running
     void stop();
 
-    // Allows for roller control in driver
-    void driver(pros::controller_id_e_t controller,
+    /**
+     * Function: start_spin
+     * Starts rotating the roller by a given degree amount without waiting for
+     * it, for running alongside other actions.
+     * \param degrees How far to rotate it, clockwise if positive
+     */
+    void start_spin(double degrees);
+
+    // Returns whether the last spin started has (nearly) reached its target
+    bool is_spin_done();
+
+    /**
+     * Function: wait_until_spin_done
+     * Waits for the last spin started to reach its target, then holds the
+     * roller where it is.
+     * \param timeout How long to wait, in ms
+     * \returns false if it didn't get there in time
+     */
+    bool wait_until_spin_done(uint32_t timeout = ROLLER_SPIN_TIMEOUT);
+
+    /**
+     * Function: set_optical_sensor
+     * Sets the optical sensor facing the roller, for scoring by color
+     * \param port The sensor's smart port
+     */
+    void set_optical_sensor(uint8_t port);
+
+    // Returns whether an optical sensor has been set
+    bool has_color_sensor();
+
+    // Initializes task, starting the roller's task, and turns on the optical
+    // sensor's light
+    void init_task();
+
+    // Returns the color in front of the optical sensor
+    roller_color_e_t get_color();
+
+    /**
+     * Function: start_color_spin
+     * Starts turning the roller until the optical sensor sees a color,
+     * without waiting for it.
+     * \param target The color the sensor sees once the roller is scored,
+     *               which depends on which side of the roller it faces
+     * \param velocity How fast to turn, in RPM, clockwise if positive
+     * \param timeout How long to turn for at most, in ms
+     */
+    void start_color_spin(roller_color_e_t target, int velocity = -100,
+                          uint32_t timeout = ROLLER_COLOR_TIMEOUT);
+
+    // Stops the color spin, if there is one
+    void cancel_color_spin();
+
+    // Returns whether the color spin has finished, by seeing the color or by
+    // timing out
+    bool is_color_done();
+
+    /**
+     * Function: wait_until_color_done
+     * Waits until is_color_done.
+     * \returns true if the color was seen
+     */
+    bool wait_until_color_done();
+
+    roller_color_state_e_t get_color_state();
+
+    // Returns how long the last color spin took, in ms
+    uint32_t get_color_time();
+
+    // Returns the name of a color, for printing
+    static const char *color_name(roller_color_e_t color);
+
+    // Returns the motors, e.g. for the power manager to limit their current
+    Motor_Group &get_motors();
+
+    // The color spin's state, the spin's target and the motors' velocity and
+    // current
+    void snapshot(subsystem_snapshot_t &snap);
+
+    // Stops the roller, cancelling any color spin
+    void safe_stop();
+
+    // Allows for roller control in driver. A color spin is left to finish
+    // unless a button is held.
+    void driver(const controller_snapshot_t &snapshot,
                 pros::controller_digital_e_t cw_btn,
                 pros::controller_digital_e_t ccw_btn);
 };
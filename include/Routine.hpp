@@ -0,0 +1,132 @@
+/**
+ * \file Routine.hpp
+ * This file contains the class declaration for the Routine class, which runs
+ * an autonomous routine loaded from the SD card, so that a routine can be
+ * changed without rebuilding and uploading the program.
+ *
+ * Routines are written as text, one command per line:
+ *
+ *     flywheel 520
+ *     straight -24
+ *     turn 90
+ *     wait_flywheel 3000
+ *     punch 2
+ *
+ * and compiled by tools/routine_compile.py into a list of fixed size
+ * commands, saved as /usd/auton_<n>.rtn where n is the routine's value in
+ * enum auton (see gui.h). The file is a header of ROUTINE_MAGIC, the number
+ * of commands as a uint16 and two reserved bytes, followed by each command as
+ * a routine_cmd_t, all little-endian.
+ *
+ * The commands are read into a fixed table, so loading and running a routine
+ * allocates nothing. What each op does is up to the caller, which passes run
+ * a table of handlers indexed by op. The robot's handlers in autonomous.cpp
+ * drive the subsystems, and sim/routine_check runs the same file through the
+ * same interpreter against the simulator to check it before it goes on the
+ * robot.
+ */
+
+#ifndef ROUTINE_HPP
+#define ROUTINE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "gui.h"
+
+// The most commands in a routine
+#define ROUTINE_MAX_COMMANDS 128
+
+// The first 4 bytes of every routine file, which change with the format
+#define ROUTINE_MAGIC "RTN1"
+
+typedef enum routine_op_e {
+    // arg: inches, waits until settled
+    E_ROUTINE_STRAIGHT = 0,
+    // arg: degrees, waits until settled
+    E_ROUTINE_TURN,
+    // arg: ms
+    E_ROUTINE_DELAY,
+    // arg: target RPM, or 0 to stop the flywheel
+    E_ROUTINE_FLYWHEEL,
+    // arg: how long to wait for the flywheel to reach its target at most, in
+    // ms
+    E_ROUTINE_WAIT_FLYWHEEL,
+    // arg: number of disks to fire
+    E_ROUTINE_PUNCH,
+    // arg: 1 in, -1 out, 0 stop
+    E_ROUTINE_INTAKE,
+    // arg: degrees, positive clockwise, waits until done
+    E_ROUTINE_ROLLER,
+    // port: ADI port 'a'-'h', arg: 1 extend, 0 retract
+    E_ROUTINE_PISTON,
+    E_ROUTINE_NUM_OPS
+} routine_op_e_t;
+
+typedef struct routine_cmd_s {
+    uint8_t op;
+    uint8_t port;
+    uint16_t reserved;
+    float arg;
+} routine_cmd_t;
+
+static_assert(sizeof(routine_cmd_t) == 8, "routine files use 8 byte commands");
+
+typedef void (*routine_handler_t)(const routine_cmd_t &cmd);
+
+// Called as each command starts, with its position
+typedef void (*routine_start_fn_t)(size_t index, const routine_cmd_t &cmd);
+
+class Routine {
+  private:
+    routine_cmd_t commands[ROUTINE_MAX_COMMANDS];
+    size_t count = 0;
+
+  public:
+    /**
+     * Function: load_file
+     * Reads a compiled routine, replacing the one loaded. Nothing is kept if
+     * the file is missing or isn't a valid routine.
+     * \param path Where the routine is
+     * \returns true if the routine was loaded
+     */
+    bool load_file(const char *path);
+
+    /**
+     * Function: load
+     * Reads the routine for an autonomous selection from
+     * /usd/auton_<id>.rtn.
+     * \returns true if the SD card holds a valid routine for it
+     */
+    bool load(enum auton id);
+
+    /**
+     * Function: run
+     * Runs each command in order by calling the handler for its op, which
+     * returns once the command has finished. The start of each command is
+     * marked in the Trace with its position.
+     * \param handlers A handler for every op, indexed by routine_op_e_t
+     * \param timeout How long to run for at most, in ms. The commands not
+     *                started by then are skipped.
+     * \param on_start Called as each command starts, e.g. to time it as a
+     *                 step, or nullptr
+     * \returns true if every command was started before the timeout
+     */
+    bool run(const routine_handler_t handlers[E_ROUTINE_NUM_OPS],
+             uint32_t timeout = UINT32_MAX,
+             routine_start_fn_t on_start = nullptr);
+
+    // Returns the number of commands loaded
+    size_t size();
+
+    // Returns a command, in the order they run
+    const routine_cmd_t &get(size_t index);
+
+    // Forgets the routine loaded
+    void clear();
+
+    // Returns the name an op is written as in the text format
+    static const char *op_name(uint8_t op);
+};
+
+#endif /* Routine.hpp */
@@ -0,0 +1,82 @@
+/**
+ * \file Seqlock.hpp
+ * This file contains the Seqlock class template, which shares a value from one
+ * writing task with any number of reading tasks without a mutex.
+ *
+ * The writer bumps a sequence number to an odd value, writes the value, then
+ * bumps it to the next even value. A reader copies the value and then checks
+ * that the sequence number was even and unchanged across the copy; if not,
+ * the writer got in the way and the reader tries again. Readers never block
+ * the writer, and a reader always gets a complete value, never half of an old
+ * one and half of a new one.
+ *
+ * T must be trivially copyable, and small enough to copy quickly. Only one
+ * task may write.
+ */
+
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+#include "pros/rtos.h"
+
+template <typename T> class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Seqlock values are copied while they may be written");
+
+  private:
+    std::atomic<uint32_t> seq{0};
+    T value{};
+
+  public:
+    /**
+     * Function: write
+     * Publishes a new value. Must only be called from one task.
+     */
+    void write(const T &new_value) {
+        uint32_t start = seq.load(std::memory_order_relaxed);
+        seq.store(start + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        value = new_value;
+        seq.store(start + 2, std::memory_order_release);
+    }
+
+    /**
+     * Function: read
+     * Copies the most recently published value
+     * \param out Set to the value
+     * \returns The value's sequence number, which changes every write
+     */
+    uint32_t read(T &out) const {
+        while (true) {
+            uint32_t before = seq.load(std::memory_order_acquire);
+            if (!(before & 1)) {
+                out = value;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq.load(std::memory_order_relaxed) == before)
+                    return before;
+            }
+            // The writer was preempted part way through. Waiting, rather than
+            // spinning, lets it finish even if it has a lower priority.
+            pros::c::delay(1);
+        }
+    }
+
+    /**
+     * Function: read
+     * Like read(T &), but returns the value instead
+     */
+    T read() const {
+        T out;
+        read(out);
+        return out;
+    }
+
+    // Returns the sequence number of the most recent write
+    uint32_t get_seq() const { return seq.load(std::memory_order_acquire); }
+};
+
+#endif /* Seqlock.hpp */
@@ -0,0 +1,117 @@
+/**
+ * \file Settle_Detector.hpp
+ * This file contains the class declaration for the Settle_Detector class,
+ * which decides when a closed-loop motion has finished, and why.
+ *
+ * A motion can end in one of four ways:
+ *  - Small error: the error has been inside a tight band, and the mechanism
+ *    has been nearly still, for a short time. This is the normal exit.
+ *  - Large error: the error has been inside a looser band, and the mechanism
+ *    has been nearly still, for a longer time. This catches motions that stop
+ *    just short of the target, e.g. because kI is 0.
+ *  - Stalled: the mechanism has not moved for a while, even though the error
+ *    is outside both bands, e.g. because the robot is pushing against a wall.
+ *  - Timeout: the motion has taken too long.
+ *
+ * This is based on okapi's SettledUtil, with the addition of a second error
+ * band, stall detection and a timeout, all of which report a separate exit
+ * reason.
+ */
+
+#ifndef SETTLE_DETECTOR_HPP
+#define SETTLE_DETECTOR_HPP
+
+#include <cstdint>
+
+// Why a motion ended. E_SETTLE_NONE means it has not ended yet.
+typedef enum settle_exit_e {
+    E_SETTLE_NONE = 0,
+    E_SETTLE_SMALL_ERROR,
+    E_SETTLE_LARGE_ERROR,
+    E_SETTLE_STALLED,
+    E_SETTLE_TIMEOUT,
+    // Not returned by Settle_Detector: the motion was replaced by the next
+    // one, or was still running when the robot was disabled
+    E_SETTLE_SUPERSEDED,
+    E_SETTLE_CUT
+} settle_exit_e_t;
+
+/**
+ * The exit conditions for a motion. The error bands use the units of the
+ * error given to Settle_Detector::update, and the velocity bands the units of
+ * the velocity. Setting any of the times to 0 disables that exit.
+ */
+typedef struct settle_params_s {
+    // The tight error band, and how long the error must stay within it
+    double small_error;
+    uint32_t small_time;
+
+    // The loose error band, and how long the error must stay within it
+    double large_error;
+    uint32_t large_time;
+
+    // The speed below which the mechanism counts as still, for both bands
+    double velocity_band;
+
+    // The speed below which the mechanism counts as stalled, and how long it
+    // must stay that slow
+    double stall_velocity;
+    uint32_t stall_time;
+
+    // The longest the motion may take, in ms
+    uint32_t timeout;
+} settle_params_t;
+
+class Settle_Detector {
+  private:
+    settle_params_t params;
+
+    // When the motion started, in ms
+    uint32_t start_time = 0;
+
+    // When the current stretch of time inside each band, or stalled, started.
+    // 0 means the condition does not currently hold.
+    uint32_t small_since = 0, large_since = 0, stall_since = 0;
+
+    settle_exit_e_t exit_reason = E_SETTLE_NONE;
+
+    /**
+     * Tracks how long a condition has held. Returns true once it has held for
+     * at least dwell ms. A dwell of 0 means the condition is never checked.
+     */
+    static bool held_for(bool condition, uint32_t &since, uint32_t now,
+                         uint32_t dwell);
+
+  public:
+    // The default exit conditions, in degrees and RPM
+    static const settle_params_t DEFAULT_PARAMS;
+
+    Settle_Detector(const settle_params_t &params = DEFAULT_PARAMS);
+
+    /**
+     * Function: reset
+     * Starts tracking a new motion
+     * \param params The exit conditions for the motion
+     * \param now The current time, in ms
+     */
+    void reset(const settle_params_t &params, uint32_t now);
+
+    /**
+     * Function: update
+     * Checks the exit conditions against the latest readings. Once the motion
+     * has ended, the exit reason is kept until the next reset.
+     * \param error The distance from the target. Only the magnitude is used.
+     * \param velocity The mechanism's speed. Only the magnitude is used.
+     * \param now The current time, in ms
+     * \returns Why the motion ended, or E_SETTLE_NONE if it has not
+     */
+    settle_exit_e_t update(double error, double velocity, uint32_t now);
+
+    // Returns why the motion ended, or E_SETTLE_NONE if it has not
+    settle_exit_e_t get_exit_reason() const;
+
+    // Returns a short name for an exit reason, for printing
+    static const char *exit_reason_name(settle_exit_e_t reason);
+};
+
+#endif /* Settle_Detector.hpp */
@@ -0,0 +1,140 @@
+/**
+ * \file Shooter.hpp
+ * This file contains the class declaration for the Shooter class, which runs
+ * the intake, indexer and flywheel together to fire the disks that are loaded
+ * as quickly as the flywheel allows.
+ *
+ * shoot(n) fires up to n disks without waiting. For each disk, the shooter:
+ *
+ *  - feeds: runs the intake for the feed time to seat the next disk in front
+ *    of the puncher, while the flywheel spins up or recovers from the last
+ *    shot
+ *  - fires: once the disk is seated and the flywheel is at speed, or has had
+ *    max_wait to get there, punches the disk and waits for the indexer
+ *
+ * Feeding overlaps the flywheel's recovery, so the time between shots is
+ * whichever takes longer rather than the sum of fixed delays.
+ *
+ * The shooter goes by the Magazine's count of the disks loaded. It never fires
+ * with the count at 0, so there are no dry fires, and waits for the magazine
+ * to finish counting each shot before firing the next. The count can also be
+ * unknown, in which case every shot asked for is fired.
+ *
+ * The shooter runs the intake while it is shooting and stops it once it is
+ * done, so the intake's driver control should be left alone until is_done.
+ */
+
+#ifndef SHOOTER_HPP
+#define SHOOTER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include "Controller_Service.hpp"
+#include "Flywheel.hpp"
+#include "Indexer.hpp"
+#include "Intake.hpp"
+#include "Magazine.hpp"
+#include "Subsystem.hpp"
+#include "api.h"
+
+typedef enum shooter_state_e {
+    E_SHOOTER_IDLE = 0,
+    E_SHOOTER_FEEDING,
+    E_SHOOTER_FIRING
+} shooter_state_e_t;
+
+class Shooter : public Subsystem<Shooter> {
+    friend class Subsystem<Shooter>;
+
+  private:
+    Intake &intake;
+    Indexer &indexer;
+    Flywheel &flywheel;
+    Magazine &magazine;
+
+    // How long the intake runs to seat each disk, and how long after a disk
+    // starts feeding to wait for the flywheel before firing anyway, in ms
+    uint32_t feed_time = 300;
+    uint32_t max_wait = 1500;
+
+    // Shots asked for that haven't been fired
+    std::atomic<int> shots_left{0};
+    std::atomic<shooter_state_e_t> state{E_SHOOTER_IDLE};
+
+    // Set by cancel, and handled by the task, which is the only one that
+    // knows whether a disk is firing
+    std::atomic<bool> cancelled{false};
+
+    // When the current disk started feeding and when the volley started, in
+    // ms, and the disks fired in the volley. Only used by the task.
+    uint32_t feed_start = 0;
+    uint32_t volley_start = 0;
+    int volley_shots = 0;
+
+    // Runs the pipeline, called by the shooter's task
+    uint32_t tick(uint32_t now);
+
+    // Whether another disk can be fired, going by the magazine's count
+    bool has_disk();
+
+    // Stops the intake and reports the volley
+    void end_volley(uint32_t now);
+
+  public:
+    /**
+     * Function: Shooter
+     * \param intake Feeds disks to the indexer
+     * \param indexer Punches disks into the flywheel
+     * \param flywheel Must be running at the speed to shoot at
+     * \param magazine Counts the disks loaded
+     */
+    Shooter(Intake &intake, Indexer &indexer, Flywheel &flywheel,
+            Magazine &magazine);
+
+    /**
+     * Function: set_timing
+     * \param feed_time How long the intake runs to seat each disk, in ms
+     * \param max_wait How long after a disk starts feeding to wait for the
+     *                 flywheel to reach its speed before firing anyway, in ms
+     */
+    void set_timing(uint32_t feed_time, uint32_t max_wait);
+
+    /**
+     * Function: shoot
+     * Fires disks without waiting for them. Shots asked for while shooting
+     * are added to the volley.
+     * \param shots How many disks to fire at most. By default, every disk
+     *              loaded, or MAGAZINE_CAPACITY if the count is unknown.
+     */
+    void shoot(int shots = MAGAZINE_CAPACITY);
+
+    // Stops shooting once the disk being fired, if any, has gone
+    void cancel();
+
+    // Returns whether every shot asked for has been fired or dropped
+    bool is_done();
+
+    // Waits until is_done
+    void wait_until_done();
+
+    shooter_state_e_t get_state();
+
+    /**
+     * Function: driver
+     * Shoots while a button is held, one disk after another, and stops once
+     * it is let go. Pressing the button with the magazine counted as empty
+     * makes the count unknown, as the driver can see the disks.
+     */
+    void driver(const controller_snapshot_t &snapshot,
+                pros::controller_digital_e_t shoot_btn);
+
+    // The state, and the shots left as the target
+    void snapshot(subsystem_snapshot_t &snap);
+
+    // Drops every shot asked for, including the disk firing, and stops the
+    // intake
+    void safe_stop();
+};
+
+#endif /* Shooter.hpp */
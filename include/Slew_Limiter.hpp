@@ -0,0 +1,74 @@
+/**
+ * \file Slew_Limiter.hpp
+ * This file contains the class declaration for the Slew_Limiter class, which
+ * limits how quickly a motor output may change.
+ *
+ * Stepping a drivetrain from 0 to 12000 mV in one iteration spins the wheels
+ * and pulls enough current to brown out the brain, particularly while the
+ * flywheel is also running. The limiter ramps the output instead, with
+ * separate limits for speeding up (moving the output away from 0) and slowing
+ * down (moving it toward 0), since slowing down too quickly tips the robot
+ * rather than spinning the wheels.
+ */
+
+#ifndef SLEW_LIMITER_HPP
+#define SLEW_LIMITER_HPP
+
+#include <cstdint>
+
+class Slew_Limiter {
+  private:
+    // The limits, in mV per second. 0 means unlimited.
+    double accel_rate = 0;
+    double decel_rate = 0;
+
+    // The most recent output, and when it was calculated, in ms
+    double output = 0;
+    uint32_t last_time = 0;
+    bool started = false;
+
+    // The longest time between two steps that is allowed to count toward the
+    // change in output. Without this, the first step after the limiter has
+    // sat unused (e.g. while the PID task was paused) could jump straight to
+    // the target.
+    static constexpr uint32_t MAX_STEP_TIME = 20;
+
+  public:
+    /**
+     * Function: set_rates
+     * Sets how quickly the output may change
+     * \param accel The largest change per second when moving the output away
+     *              from 0, in mV. 0 means unlimited.
+     * \param decel The largest change per second when moving the output
+     *              toward 0, in mV. 0 means unlimited.
+     */
+    void set_rates(double accel, double decel);
+
+    /**
+     * Function: step
+     * Moves the output toward the target by no more than the limits allow
+     * for the time since the last step. An output that would cross 0 stops
+     * at 0 for one step, so that the decel limit applies to the whole of a
+     * reversal.
+     * \param target The output wanted, in mV
+     * \param now The current time, in ms
+     * \returns The output to send, in mV
+     */
+    int step(int target, uint32_t now);
+
+    /**
+     * Function: reset
+     * Sets the output without limiting it, e.g. to 0 when the motors are
+     * told to brake
+     */
+    void reset(int value = 0);
+
+    // Returns the most recent output, in mV
+    int get_output() const;
+
+    // Return the limits, in mV per second
+    double get_accel_rate() const;
+    double get_decel_rate() const;
+};
+
+#endif /* Slew_Limiter.hpp */
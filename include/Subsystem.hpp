@@ -0,0 +1,196 @@
+/**
+ * \file Subsystem.hpp
+ * This file contains the declarations of the Subsystem class template, which
+ * every mechanism on the robot derives from, and the Subsystem_Registry class
+ * template, which runs the same step on every subsystem at once.
+ *
+ * A subsystem derives from Subsystem<itself> and provides three functions:
+ *
+ *     // One iteration of the control loop, returning how long to wait before
+ *     // the next one, in ms
+ *     uint32_t tick(uint32_t now);
+ *
+ *     // Fills in what the subsystem is doing, for telemetry
+ *     void snapshot(subsystem_snapshot_t &snap);
+ *
+ *     // Brings the mechanism to rest and drops whatever it was asked to do,
+ *     // e.g. when the robot is disabled
+ *     void safe_stop();
+ *
+ * and may provide a fourth, which does nothing unless it does:
+ *
+ *     // Gets ready for autonomous or driver control, e.g. resuming a task
+ *     // that safe_stop suspended
+ *     void enable(subsystem_mode_e_t mode);
+ *
+ * Subsystem runs tick from the subsystem's own task, timed by a Task_Stats,
+ * so the task, its trampoline and its loop are written once. The functions
+ * are found through the derived type at compile time rather than through a
+ * vtable, so each call can be inlined.
+ *
+ * The registry holds a reference to each subsystem, with their types, and
+ * applies a step to each of them in turn:
+ *
+ *     Subsystem_Registry<Drivetrain, Flywheel> subsystems(drive, flywheel);
+ *     subsystems.init_tasks();
+ *     subsystems.enable(E_SUBSYSTEM_AUTONOMOUS);
+ *     subsystems.safe_stop();
+ *
+ * The list is fixed when the program is compiled, so it takes no memory
+ * beyond the references and each loop over it unrolls into direct calls.
+ *
+ * print_snapshots prints one line per subsystem to the terminal:
+ *
+ *     S,<time ms>,<name>,<state>,<target>,<velocity RPM>,<current mA>
+ *
+ * where the state and the target's units are the subsystem's own.
+ */
+
+#ifndef SUBSYSTEM_HPP
+#define SUBSYSTEM_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <tuple>
+
+#include "Task_Stats.hpp"
+#include "pros/rtos.hpp"
+
+// The enabled modes a subsystem is readied for
+typedef enum subsystem_mode_e {
+    E_SUBSYSTEM_AUTONOMOUS = 0,
+    E_SUBSYSTEM_DRIVER
+} subsystem_mode_e_t;
+
+typedef struct subsystem_snapshot_s {
+    // The subsystem's state, as its own enum, or 0 if it has none
+    int state;
+
+    // What the subsystem is aiming for, in its own units
+    double target;
+
+    // How fast its motors are turning, in RPM, and the current they draw
+    // between them, in mA
+    double velocity;
+    int32_t current;
+} subsystem_snapshot_t;
+
+template <typename Derived> class Subsystem {
+  private:
+    const char *name;
+    const char *task_name;
+    uint32_t priority;
+
+    // The PROS task type that contains the subsystem's task
+    pros::task_t task = nullptr;
+
+    // Runs tick until the task is deleted
+    void task_fn() {
+        uint32_t now = pros::millis();
+        while (true) {
+            Task_Stats::Scope timer(stats);
+            uint32_t wait = static_cast<Derived *>(this)->tick(now);
+            timer.stop();
+            // After a suspension or an overrun, waits the whole time from now
+            // rather than running the missed iterations back to back
+            uint32_t time = pros::millis();
+            if (time - now >= wait)
+                now = time;
+            pros::c::task_delay_until(&now, wait);
+        }
+    }
+
+    // A static function used to call task_fn, as the PROS task system
+    // requires
+    static void trampoline(void *param) {
+        if (param)
+            static_cast<Subsystem *>(param)->task_fn();
+    }
+
+  protected:
+    Task_Stats stats;
+
+    /**
+     * Function: Subsystem
+     * \param name The name used in telemetry and the task stats
+     * \param task_name The name of the subsystem's task
+     * \param period How long an iteration of tick should take at most, in ms
+     * \param priority The PROS priority of the subsystem's task
+     */
+    Subsystem(const char *name, const char *task_name, uint32_t period,
+              uint32_t priority = TASK_PRIORITY_DEFAULT)
+        : name(name), task_name(task_name), priority(priority),
+          stats(name, period) {}
+
+    // Suspends the task, so that tick stops running
+    void suspend_task() {
+        if (task)
+            pros::c::task_suspend(task);
+    }
+
+    // Deletes the task
+    void delete_task() {
+        if (task)
+            pros::c::task_delete(task);
+        task = nullptr;
+    }
+
+  public:
+    // Initializes task, starting the subsystem's task
+    void init_task() {
+        task = pros::c::task_create(trampoline, this, priority,
+                                    TASK_STACK_DEPTH_DEFAULT, task_name);
+    }
+
+    // Nothing needs readying by default
+    void enable(subsystem_mode_e_t mode) {}
+
+    // Resumes the task, assuming it was previously suspended
+    void resume_task() {
+        if (task)
+            pros::c::task_resume(task);
+    }
+
+    const char *get_name() { return name; }
+};
+
+template <typename... Subsystems> class Subsystem_Registry {
+  private:
+    std::tuple<Subsystems &...> subsystems;
+
+  public:
+    Subsystem_Registry(Subsystems &...subsystems) : subsystems(subsystems...) {}
+
+    // Calls fn with each subsystem, in the order they were given
+    template <typename Fn> void for_each(Fn fn) {
+        std::apply([&fn](auto &...each) { (fn(each), ...); }, subsystems);
+    }
+
+    // Starts every subsystem's task
+    void init_tasks() {
+        for_each([](auto &subsystem) { subsystem.init_task(); });
+    }
+
+    // Readies every subsystem for an enabled mode
+    void enable(subsystem_mode_e_t mode) {
+        for_each([mode](auto &subsystem) { subsystem.enable(mode); });
+    }
+
+    // Brings every subsystem to rest
+    void safe_stop() {
+        for_each([](auto &subsystem) { subsystem.safe_stop(); });
+    }
+
+    // Prints each subsystem's snapshot to the terminal
+    void print_snapshots() {
+        unsigned long now = pros::millis();
+        for_each([now](auto &subsystem) {
+            subsystem_snapshot_t snap = {};
+            subsystem.snapshot(snap);
+            printf("S,%lu,%s,%d,%.1f,%.1f,%ld\n", now, subsystem.get_name(),
+                   snap.state, snap.target, snap.velocity, (long)snap.current);
+        });
+    }
+};
+
+#endif /* Subsystem.hpp */
@@ -0,0 +1,145 @@
+/**
+ * \file Sysid.hpp
+ * This file contains the class declaration for the Sysid class, which runs
+ * system identification ("characterization") tests on a mechanism and logs the
+ * results to the SD card.
+ *
+ * Two kinds of tests are run, following the approach used by WPILib's SysId
+ * tool:
+ *  - Quasistatic: the voltage is ramped up slowly, so acceleration stays close
+ *    to zero. This isolates the kS (static friction) and kV (velocity) terms.
+ *  - Dynamic: a constant voltage step is applied from rest, so the mechanism
+ *    accelerates hard. This exposes the kA (acceleration) term.
+ *
+ * Every loop iteration, the voltage, velocity and acceleration of each motor
+ * group under test is stored in a RAM buffer. Writing to the SD card is slow,
+ * so the buffer is only written out when save() is called. The resulting CSV
+ * file is fitted by tools/sysid_fit.py, which emits sysid_consts.hpp.
+ *
+ * See:
+ * https://docs.wpilib.org/en/stable/docs/software/pathplanning/system-identification/introduction.html
+ */
+
+#ifndef SYSID_HPP
+#define SYSID_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Motor_Group.hpp"
+
+// The maximum number of samples that can be held before save() is called.
+// At 2 ms per loop and two motor groups, this is about 16 s of data.
+#define SYSID_LOG_CAPACITY 16384
+
+// The maximum number of motor groups that can be tested at the same time
+#define SYSID_MAX_GROUPS 2
+
+typedef enum sysid_test_e {
+    E_SYSID_QUASISTATIC_FWD = 0,
+    E_SYSID_QUASISTATIC_REV,
+    E_SYSID_DYNAMIC_FWD,
+    E_SYSID_DYNAMIC_REV
+} sysid_test_e_t;
+
+class Sysid {
+  private:
+    // A single logged sample. Floats are used to keep the buffer small.
+    typedef struct sample_s {
+        // ms since the start of the test
+        uint32_t time;
+        // mV, as reported by the motors
+        float voltage;
+        // RPM
+        float velocity;
+        // RPM per second
+        float accel;
+        // The sysid_test_e_t the sample was taken during
+        uint8_t test;
+        // The name of the motor group the sample came from
+        const char *group;
+    } sample_t;
+
+    sample_t samples[SYSID_LOG_CAPACITY];
+    size_t sample_count = 0;
+
+    // Quasistatic ramp rate, in mV per second
+    double ramp_rate = 500;
+
+    // The voltage at which the quasistatic ramp ends, in mV
+    int max_voltage = 6000;
+
+    // The voltage used for dynamic tests, in mV
+    int step_voltage = 7000;
+
+    // The length of each dynamic test, in ms
+    uint32_t step_duration = 1500;
+
+    // How far any group may turn during a test before it is ended early, in
+    // the groups' encoder units, or 0 for no limit
+    double travel_limit = 0;
+
+    // The loop period, in ms
+    static constexpr uint32_t TIME_DELAY = 2;
+
+    // Acceleration is calculated over this many samples. The motors only
+    // update their velocity every 10 ms, so differentiating across a single
+    // 2 ms sample produces mostly zeros and large spikes.
+    static constexpr size_t ACCEL_WINDOW = 5;
+
+  public:
+    /**
+     * Function: set_quasistatic
+     * Configures the quasistatic voltage ramp
+     * \param mv_per_sec The rate at which the voltage increases
+     * \param max_mv The voltage at which the ramp ends
+     */
+    void set_quasistatic(double mv_per_sec, int max_mv);
+
+    /**
+     * Function: set_dynamic
+     * Configures the dynamic step test. Tests on a drivetrain should be short
+     * enough that the robot does not hit anything.
+     * \param mv The voltage to apply to the mechanism
+     * \param ms How long to apply the voltage for
+     */
+    void set_dynamic(int mv, uint32_t ms);
+
+    /**
+     * Function: set_travel_limit
+     * Ends each test early once any group has turned this far from where the
+     * test started, e.g. so that a drivetrain stays inside the space it has.
+     * \param limit The distance, in the groups' encoder units, or 0 for no
+     *              limit
+     */
+    void set_travel_limit(double limit);
+
+    /**
+     * Function: run_test
+     * Runs a single test on the given motor groups, which all receive the same
+     * voltage. Any control task using the motors must be paused beforehand.
+     * The motors are braked once the test finishes.
+     *
+     * \param test The test to run
+     * \param groups The motor groups to drive and log
+     * \param names A name for each group, used in the CSV file
+     * \param count The number of groups, at most SYSID_MAX_GROUPS
+     * \returns false if the log buffer filled up before the test finished
+     */
+    bool run_test(sysid_test_e_t test, Motor_Group *const groups[],
+                  const char *const names[], size_t count);
+
+    /**
+     * Function: save
+     * Appends all logged samples to a CSV file on the SD card, then clears
+     * the buffer.
+     * \param path The file to append to, e.g. "/usd/sysid.csv"
+     * \returns false if there is no SD card or the file could not be opened
+     */
+    bool save(const char *path);
+
+    // Discards all logged samples
+    void clear();
+};
+
+#endif /* Sysid.hpp */
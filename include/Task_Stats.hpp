@@ -0,0 +1,120 @@
+/**
+ * \file Task_Stats.hpp
+ * This file contains the class declaration for the Task_Stats class, which
+ * measures how much of the brain's time a task's loop uses, to show how much
+ * room is left for more control code.
+ *
+ * Each instrumented loop owns a Task_Stats, and times its body with a Scope:
+ *
+ *     while (true) {
+ *         Task_Stats::Scope timer(stats);
+ *         ...
+ *         timer.stop();
+ *         pros::delay(2);
+ *     }
+ *
+ * For every loop, the number of iterations, the time spent in the body, the
+ * longest body and the number of overruns are kept. Bodies are timed with
+ * micros() and the delay isn't counted, but time taken by higher priority
+ * tasks in the middle of a body is. An overrun is a body that took longer
+ * than the loop's period, so the loop couldn't have kept to its rate. Each body
+ * is also recorded as a tick in the Trace.
+ *
+ * PROS doesn't expose FreeRTOS's stack high-water mark or a task's stack
+ * bounds, so stack use isn't measured. Filling the stack with a known word
+ * from inside the task would need to know where the stack ends, and guessing
+ * wrong writes over whatever lies below it.
+ *
+ * Every Task_Stats is kept in a list, so all of them can be sampled and
+ * printed together. sample_all works out each loop's share of the CPU since
+ * the last sample and is called by the brain screen's stats page once a
+ * second. print_all prints one line per loop to the terminal:
+ *
+ *     T,<time ms>,<name>,<iterations>,<cpu %>,<average body us>,
+ *     <longest body us>,<overruns>
+ */
+
+#ifndef TASK_STATS_HPP
+#define TASK_STATS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "pros/rtos.h"
+
+class Task_Stats {
+  private:
+    const char *name;
+
+    // The longest a body should take, in us
+    std::atomic<uint32_t> period;
+
+    // Written by the task, read by whoever samples. The times wrap after 71
+    // minutes, which only matters for the totals.
+    std::atomic<uint32_t> iterations{0};
+    std::atomic<uint32_t> busy{0};
+    std::atomic<uint32_t> max_busy{0};
+    std::atomic<uint32_t> overruns{0};
+
+    // The results of the last sample
+    std::atomic<float> cpu{0};
+    uint32_t sample_busy = 0;
+    uint32_t sample_time = 0;
+
+    Task_Stats *next;
+    static Task_Stats *first;
+
+    // Counts a body that started and ended at the given times, in us
+    void add(uint32_t start, uint32_t end);
+
+    // Updates cpu
+    void sample(uint32_t now);
+
+  public:
+    /**
+     * Times a loop body from its construction until stop is called or it goes
+     * out of scope, whichever comes first.
+     */
+    class Scope {
+      private:
+        Task_Stats &stats;
+        uint32_t start;
+        bool running = true;
+
+      public:
+        Scope(Task_Stats &stats);
+        ~Scope();
+        void stop();
+    };
+
+    /**
+     * Function: Task_Stats
+     * \param name The name shown on the screen and in the terminal. Must be a
+     *             string literal or otherwise outlive the Task_Stats.
+     * \param period The longest the loop's body should take, in ms
+     */
+    Task_Stats(const char *name, uint32_t period);
+    Task_Stats(const Task_Stats &) = delete;
+    Task_Stats &operator=(const Task_Stats &) = delete;
+
+    // Sets the longest the loop's body should take, in ms
+    void set_period(uint32_t period);
+
+    // Samples every Task_Stats
+    static void sample_all();
+
+    // Samples every Task_Stats and prints them to the terminal
+    static void print_all();
+
+    /**
+     * Function: format_all
+     * Writes a table of every Task_Stats, as of the last sample, for the
+     * screen.
+     * \param buffer Where to write it
+     * \param size The size of buffer
+     */
+    static void format_all(char *buffer, size_t size);
+};
+
+#endif /* Task_Stats.hpp */
@@ -0,0 +1,151 @@
+/**
+ * \file Trace.hpp
+ * This file contains the class declaration for the Trace class, which records
+ * a timeline of what the robot's tasks did, to find where the time goes in a
+ * long autonomous routine.
+ *
+ * Each event is a 12 byte record of the time in us, the task it happened in,
+ * what happened and one argument, written into a fixed ring of TRACE_SIZE
+ * records. Recording an event takes one atomic add and a few stores, so it
+ * can be left on in the control loops. Once the ring is full the oldest
+ * records are overwritten.
+ *
+ * These events are recorded:
+ *
+ *  - Every iteration of a loop timed by Task_Stats, with the length of its
+ *    body
+ *  - The start and end of each drivetrain motion, in the PID task
+ *  - wait_until_settled and Trace::delay, in the task that calls them
+ *  - Each indexer shot, in the indexer's task
+ *  - Each intake jam, in the intake's task
+ *  - Marks placed by the autonomous routine with Trace::mark
+ *
+ * print and save write the ring out as text, oldest first:
+ *
+ *     N,<task id>,<task name>
+ *     R,<time us>,<task id>,<event>,<arg>
+ *
+ * with one N line for each task that recorded anything. tools/trace_chrome.py
+ * turns this into the Chrome trace format, which can be viewed in
+ * chrome://tracing or ui.perfetto.dev. The records aren't locked, so the
+ * trace should be written out once the tasks have stopped recording, e.g. at
+ * the end of autonomous.
+ */
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "pros/rtos.h"
+
+// The records made each second in autonomous, mostly ticks: 500 each from the
+// drive and flywheel, 200 each from the controller and roller, 100 each from
+// the indexer, intake, magazine and shooter, 50 from the power manager and 10
+// from the health monitor, with some room for motions, shots and marks
+#define TRACE_RATE 1900
+
+// The number of records kept, 384 KB of them, which covers a 15 second
+// autonomous routine at TRACE_RATE with a couple of seconds to spare. Must be
+// a power of two, so that the ring's index stays in step when it wraps. A
+// skills routine needs the ticks left out (see set_mask).
+#define TRACE_SIZE 32768
+
+static_assert((TRACE_SIZE & (TRACE_SIZE - 1)) == 0,
+              "TRACE_SIZE must be a power of two");
+static_assert(TRACE_SIZE >= TRACE_RATE * 15,
+              "TRACE_SIZE must cover a 15 second autonomous routine");
+
+// The most tasks that can be told apart. Later ones share the last id.
+#define TRACE_MAX_TASKS 16
+
+// What a record is of. The numbers are used by tools/trace_chrome.py.
+typedef enum trace_event_e {
+    E_TRACE_TICK = 0,         // arg is the length of the loop's body in us
+    E_TRACE_MOTION_START = 1, // arg is the command's sequence number
+    E_TRACE_MOTION_END = 2,   // arg is the settle_exit_e_t
+    E_TRACE_WAIT_START = 3,
+    E_TRACE_WAIT_END = 4,
+    E_TRACE_PUNCH_START = 5,
+    E_TRACE_PUNCH_END = 6,   // arg is 1 if the shot timed out
+    E_TRACE_DELAY_START = 7, // arg is the delay in ms
+    E_TRACE_DELAY_END = 8,
+    E_TRACE_MARK = 9, // arg is chosen by the caller
+    E_TRACE_JAM = 10, // arg is the attempt, past the last if it gave up
+    E_TRACE_NUM_EVENTS
+} trace_event_e_t;
+
+typedef struct trace_record_s {
+    uint32_t time;
+    uint8_t task;
+    uint8_t event;
+    int32_t arg;
+} trace_record_t;
+
+class Trace {
+  private:
+    static trace_record_t records[TRACE_SIZE];
+    static std::atomic<uint32_t> next;
+
+    // A bit for each trace_event_e_t that is recorded
+    static std::atomic<uint32_t> mask;
+
+    static pros::task_t tasks[TRACE_MAX_TASKS];
+    static std::atomic<uint8_t> task_count;
+
+    // Returns the calling task's id, giving it one if it doesn't have one
+    static uint8_t task_id();
+
+    // Writes the ring out to an open file
+    static void write(FILE *file);
+
+  public:
+    /**
+     * Function: record
+     * Records an event in the calling task, if events of its kind are being
+     * recorded.
+     * \param event What happened
+     * \param arg The event's argument
+     */
+    static void record(trace_event_e_t event, int32_t arg = 0);
+
+    // Records an event that happened earlier, at the given micros() time
+    static void record_at(trace_event_e_t event, int32_t arg, uint32_t time);
+
+    // Records a mark, e.g. to label a step of a routine
+    static void mark(int32_t arg);
+
+    // pros::delay, recorded as a delay event
+    static void delay(uint32_t ms);
+
+    /**
+     * Function: set_mask
+     * Chooses which kinds of events are recorded, e.g. leaving out ticks so
+     * that the ring lasts for all of a skills routine.
+     * \param mask A bit for each trace_event_e_t to record
+     */
+    static void set_mask(uint32_t mask);
+
+    // Empties the ring
+    static void clear();
+
+    // Returns the number of records in the ring
+    static size_t size();
+
+    // Prints the ring to the terminal
+    static void print();
+
+    /**
+     * Function: save
+     * Writes the ring to the SD card, if there is one, to the first of
+     * <prefix>_0.txt, <prefix>_1.txt, ... that doesn't already exist.
+     * \param prefix The path without the number, e.g. "/usd/trace"
+     * \returns false if it couldn't be written
+     */
+    static bool save(const char *prefix);
+};
+
+#endif /* Trace.hpp */
@@ -1,11 +1,18 @@
 #ifndef EXTERNS_HPP
 #define EXTERNS_HPP
 
+#include "Auton_Profiler.hpp"
+#include "Controller_Service.hpp"
 #include "Drivetrain.hpp"
 #include "Flywheel.hpp"
+#include "Health_Monitor.hpp"
 #include "Indexer.hpp"
 #include "Intake.hpp"
+#include "Magazine.hpp"
+#include "Power_Manager.hpp"
 #include "Roller.hpp"
+#include "Shooter.hpp"
+#include "Subsystem.hpp"
 #include "gui.h"
 
 extern Drivetrain drive;
@@ -13,6 +20,21 @@ extern Intake intake;
 extern Flywheel flywheel;
 extern Indexer indexer;
 extern Roller roller;
+extern Magazine magazine;
+extern roller_color_e_t alliance_color;
+extern Shooter shooter;
+
+extern Controller_Service master;
+extern Power_Manager power;
+extern Health_Monitor health;
+
+typedef Subsystem_Registry<Controller_Service, Drivetrain, Flywheel, Shooter,
+                           Magazine, Intake, Indexer, Roller, Power_Manager,
+                           Health_Monitor>
+    Subsystems;
+extern Subsystems subsystems;
+
+extern Auton_Profiler profiler;
 
 extern enum auton auton_id;
 
@@ -7,10 +7,30 @@
 extern "C" {
 #endif
 
-enum auton { none, skills_best, skills_real, match_best, match_real, test };
+enum auton {
+    none,
+    skills_best,
+    skills_real,
+    match_best,
+    match_real,
+    test,
+    characterize,
+    // The match routine run as an action graph and as coroutines
+    match_graph,
+    match_coroutines
+};
 
 void gui_init();
 
+/**
+ * Function: gui_task_stats_text
+ * Samples the task stats and writes them as a table, for the stats page.
+ * Defined in Task_Stats.cpp.
+ * \param buffer Where to write the table
+ * \param size The size of buffer
+ */
+void gui_task_stats_text(char *buffer, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
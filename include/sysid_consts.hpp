@@ -0,0 +1,31 @@
+/**
+ * \file sysid_consts.hpp
+ * Feedforward constants found through system identification. This file is
+ * generated by tools/sysid_fit.py from the CSV files written by
+ * Drivetrain::characterize and Flywheel::characterize - rerun the tool rather
+ * than editing it by hand.
+ *
+ * Units: kS in mV, kV in mV per RPM, kA in mV per (RPM per second)
+ *
+ * The flywheel values are the hand-tuned constants used before
+ * characterization was available. The old controller never applied kS to
+ * positive targets, so kS is 0 here to keep the flywheel's behaviour the same
+ * until it is characterized. The drivetrain has not been characterized yet.
+ */
+
+#ifndef SYSID_CONSTS_HPP
+#define SYSID_CONSTS_HPP
+
+#define FLYWHEEL_KS 0
+#define FLYWHEEL_KV 20.0128
+#define FLYWHEEL_KA 0
+
+#define DRIVE_LEFT_KS 0
+#define DRIVE_LEFT_KV 0
+#define DRIVE_LEFT_KA 0
+
+#define DRIVE_RIGHT_KS 0
+#define DRIVE_RIGHT_KV 0
+#define DRIVE_RIGHT_KA 0
+
+#endif /* sysid_consts.hpp */
@@ -0,0 +1,85 @@
+/**
+ * \file curve_bench.cpp
+ * Compares the cost of shaping a joystick reading with an Input_Curve table
+ * against the std::pow path tank_driver_poly used before, and checks that
+ * the two give the same outputs.
+ *
+ * Both paths are timed over every joystick reading many times over, and the
+ * output of the pow path is converted to mV the way motor_move does, so the
+ * two can be compared directly. Times are for the computer running the
+ * benchmark, not the brain, so only the ratio between them carries over.
+ *
+ * Usage: curve_bench [power] [iterations]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "Input_Curve.hpp"
+
+// Checked by the compiler, as a curve built at compile time must be
+static constexpr Input_Curve compile_time_curve = Input_Curve::poly(1.3);
+static_assert(compile_time_curve.apply(127) == INPUT_CURVE_MAX_OUTPUT, "");
+static_assert(compile_time_curve.apply(-127) == -INPUT_CURVE_MAX_OUTPUT, "");
+static_assert(compile_time_curve.apply(0) == 0, "");
+
+// The shaping done by tank_driver_poly before input curves, followed by the
+// conversion motor_move makes from its -127 to 127 range to mV
+static int pow_path(int reading, double power) {
+    int move = reading * std::pow((std::abs(reading) / 127.0), power - 1);
+    return move * 12000 / 127;
+}
+
+// Keeps the compiler from optimizing the loops away
+static volatile int sink;
+
+template <typename F> static double time_ns(long iterations, F shape) {
+    auto start = std::chrono::steady_clock::now();
+    int sum = 0;
+    for (long i = 0; i < iterations; ++i)
+        for (int reading = -127; reading <= 127; ++reading)
+            sum += shape(reading);
+    sink = sum;
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+           (iterations * 255.0);
+}
+
+int main(int argc, char **argv) {
+    double power = argc > 1 ? atof(argv[1]) : 1.3;
+    long iterations = argc > 2 ? atol(argv[2]) : 20000;
+
+    // Built at runtime, since the power comes from the command line
+    auto build_start = std::chrono::steady_clock::now();
+    Input_Curve curve = Input_Curve::poly(power);
+    auto build_end = std::chrono::steady_clock::now();
+
+    // The pow path truncates to motor_move's whole steps of 12000 / 127 mV,
+    // so the two can differ by up to one step
+    int max_diff = 0;
+    for (int reading = -127; reading <= 127; ++reading) {
+        int diff = std::abs(curve.apply(reading) - pow_path(reading, power));
+        if (diff > max_diff)
+            max_diff = diff;
+    }
+
+    // volatile, so that the power isn't folded into the loop
+    volatile double p = power;
+    double pow_ns =
+        time_ns(iterations, [&](int reading) { return pow_path(reading, p); });
+    double table_ns = time_ns(
+        iterations, [&](int reading) { return curve.apply(reading); });
+
+    printf("power %g, %ld x 255 readings\n", power, iterations);
+    printf("  pow path:   %7.2f ns per reading\n", pow_ns);
+    printf("  table:      %7.2f ns per reading (%.1fx faster)\n", table_ns,
+           pow_ns / table_ns);
+    printf("  table built in %.1f us at runtime\n",
+           std::chrono::duration<double, std::micro>(build_end - build_start)
+               .count());
+    printf("  largest difference: %d mV (one motor_move step is %.1f mV)\n",
+           max_diff, 12000 / 127.0);
+    return max_diff <= 12000 / 127 + 1 ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+/**
+ * \file drive_model.cpp
+ * Runs a drivetrain motion through the unmodified Drivetrain control code
+ * against a simple model of the drivetrain, with and without slew limiting,
+ * and reports how each setting affects the motion.
+ *
+ * The model is described in drive_plant.hpp. The results are only as good as
+ * the model, so they are for comparing settings against each other rather
+ * than for predicting the robot's exact times.
+ *
+ * Usage: drive_model [--inches n | --turn degrees] [--kp kP]
+ *                    [--slew accel:decel ...]
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Drivetrain.hpp"
+#include "drive_plant.hpp"
+#include "sim.hpp"
+
+#define LEFT_PORT 1
+#define RIGHT_PORT 2
+
+// The longest a motion may run before it is given up on, in ms
+#define MAX_RUN_TIME 10000
+
+typedef struct slew_s {
+    double accel, decel;
+} slew_t;
+
+typedef struct run_result_s {
+    motion_record_t record;
+    bool finished = false;
+    double peak_step = 0;
+    double peak_accel = 0;
+} run_result_t;
+
+static run_result_t run(bool turn, double amount, double kp, const slew_t &slew,
+                        side_model_t left, side_model_t right) {
+    sim::reset();
+    run_result_t result;
+
+    Drivetrain drive({LEFT_PORT}, {RIGHT_PORT}, {false}, {false});
+    drive.set_drivetrain_dimensions(12.5, 1.625, 60.0 / 36.0);
+    drive.set_pid_consts(kp, 0, 0);
+    drive.set_slew_rates(slew.accel, slew.decel);
+    drive.init_task();
+
+    if (turn)
+        drive.turn_angle(amount);
+    else
+        drive.move_straight(amount);
+
+    sim::set_delay_hook([&](uint32_t ms) {
+        for (side_model_t *side : {&left, &right}) {
+            const sim::motor_state_t &m = sim::motor(side->port);
+            double output = m.cmd == sim::E_MOTOR_CMD_VOLTAGE ? m.cmd_value : 0;
+            bool braking = m.cmd == sim::E_MOTOR_CMD_BRAKE;
+            if (!braking &&
+                fabs(output - side->last_output) > result.peak_step)
+                result.peak_step = fabs(output - side->last_output);
+            side->last_output = output;
+        }
+
+        // Integrate in 1 ms steps, whatever the length of the delay
+        for (uint32_t i = 0; i < ms; ++i) {
+            step_side(left, 0.001, result.peak_accel);
+            step_side(right, 0.001, result.peak_accel);
+        }
+
+        Motion_Metrics &metrics = drive.get_metrics();
+        if (metrics.size()) {
+            result.record = metrics.get(0);
+            result.finished = true;
+            throw sim::end_of_run();
+        }
+        if (pros::millis() > MAX_RUN_TIME)
+            throw sim::end_of_run();
+    });
+
+    sim::run_task("Drivetrain PID Task");
+    sim::set_delay_hook(nullptr);
+    return result;
+}
+
+static void report(const char *label, const run_result_t &r) {
+    if (!r.finished) {
+        printf("%-16s did not finish within %d ms\n", label, MAX_RUN_TIME);
+        return;
+    }
+    const motion_record_t &m = r.record;
+    printf("%-16s %9lu %8lu %10.1f %9.1f %9d %10.0f %12.0f  %s\n", label,
+           (unsigned long)m.settle_time, (unsigned long)m.rise_time,
+           m.overshoot, m.steady_state_error, m.peak_current, r.peak_step,
+           r.peak_accel, Settle_Detector::exit_reason_name(m.exit_reason));
+}
+
+int main(int argc, char **argv) {
+    bool turn = false;
+    double amount = 24;
+    double kp = 600;
+    std::vector<slew_t> slews;
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--inches") && i + 1 < argc) {
+            turn = false;
+            amount = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--turn") && i + 1 < argc) {
+            turn = true;
+            amount = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--kp") && i + 1 < argc)
+            kp = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--slew") && i + 1 < argc) {
+            slew_t slew;
+            if (sscanf(argv[++i], "%lf:%lf", &slew.accel, &slew.decel) != 2)
+                usage = true;
+            slews.push_back(slew);
+        } else
+            usage = true;
+    }
+    if (usage) {
+        fprintf(stderr,
+                "usage: %s [--inches n | --turn degrees] [--kp kP] "
+                "[--slew accel:decel ...]\n",
+                argv[0]);
+        return 2;
+    }
+    // The limits used under driver control, set in opcontrol()
+    if (slews.empty())
+        slews.push_back({48000, 96000});
+
+    side_model_t left, right;
+    if (!load_side_models(left, LEFT_PORT, right, RIGHT_PORT))
+        printf("no drivetrain fit in sysid_consts.hpp, using nominal "
+               "constants\n");
+
+    printf("%s %g %s, kP %g\n", turn ? "turn" : "straight", amount,
+           turn ? "degrees" : "inches", kp);
+    printf("%-16s %9s %8s %10s %9s %9s %10s %12s  %s\n", "slew (mV/s)",
+           "settle_ms", "rise_ms", "overshoot", "error", "peak_mA",
+           "peak_step", "peak_rpm/s", "exit");
+
+    report("none", run(turn, amount, kp, {0, 0}, left, right));
+    for (const slew_t &slew : slews) {
+        char label[32];
+        snprintf(label, sizeof(label), "%g:%g", slew.accel, slew.decel);
+        report(label, run(turn, amount, kp, slew, left, right));
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "drive_plant.hpp"
+
+#include <cmath>
+
+#include "sim.hpp"
+#include "sysid_consts.hpp"
+
+static double sign(double x) { return (x > 0) - (x < 0); }
+
+bool load_side_models(side_model_t &left, uint8_t left_port,
+                      side_model_t &right, uint8_t right_port) {
+    left = {DRIVE_LEFT_KS, DRIVE_LEFT_KV, DRIVE_LEFT_KA, left_port};
+    right = {DRIVE_RIGHT_KS, DRIVE_RIGHT_KV, DRIVE_RIGHT_KA, right_port};
+    for (side_model_t *side : {&left, &right}) {
+        if (side->kv <= 0 || side->ka <= 0) {
+            left = {NOMINAL_KS, NOMINAL_KV, NOMINAL_KA, left_port};
+            right = {NOMINAL_KS, NOMINAL_KV, NOMINAL_KA, right_port};
+            return false;
+        }
+    }
+    return true;
+}
+
+void step_side(side_model_t &side, double dt, double &peak_accel) {
+    sim::motor_state_t &m = sim::motor(side.port);
+
+    double voltage = 0;
+    bool braking = m.cmd == sim::E_MOTOR_CMD_BRAKE;
+    if (m.cmd == sim::E_MOTOR_CMD_VOLTAGE)
+        voltage = m.cmd_value;
+    else if (m.cmd == sim::E_MOTOR_CMD_MOVE)
+        voltage = m.cmd_value * 12000 / 127;
+
+    double accel;
+    if (braking)
+        accel = -m.velocity / (BRAKE_TIME_CONSTANT / 1000.0);
+    else if (m.velocity == 0 && fabs(voltage) <= side.ks)
+        accel = 0; // Not enough to overcome static friction
+    else
+        accel = (voltage - side.ks * sign(m.velocity ? m.velocity : voltage) -
+                 side.kv * m.velocity) /
+                side.ka;
+
+    double velocity = m.velocity + accel * dt;
+    // Friction can stop the wheels, but not reverse them
+    if (!braking && m.velocity != 0 && sign(velocity) != sign(m.velocity) &&
+        fabs(voltage) <= side.ks)
+        velocity = 0;
+
+    // RPM to degrees per second is a factor of 6
+    m.position += (m.velocity + velocity) / 2 * 6 * dt;
+    m.velocity = velocity;
+
+    double current = (voltage - side.kv * velocity) / 12000 * 2500;
+    m.current = fmin(fabs(current), 2500);
+    m.voltage = voltage;
+
+    if (fabs(accel) > peak_accel)
+        peak_accel = fabs(accel);
+}
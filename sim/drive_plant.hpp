@@ -0,0 +1,56 @@
+/**
+ * \file drive_plant.hpp
+ * A simple model of the drivetrain, shared by the host tools that run
+ * drivetrain motions.
+ *
+ * Each side is modelled by the feedforward equation fitted by
+ * tools/sysid_fit.py,
+ *
+ *     V = kS * sgn(v) + kV * v + kA * a
+ *
+ * solved for the acceleration a. The constants come from sysid_consts.hpp, or
+ * from nominal values while it has no fit for the drivetrain. The current
+ * drawn by each side is taken as proportional to the voltage left over after
+ * the back EMF, up to the motors' 2.5 A limit.
+ */
+
+#ifndef DRIVE_PLANT_HPP
+#define DRIVE_PLANT_HPP
+
+#include <cstdint>
+
+// Used while sysid_consts.hpp has no fit for the drivetrain, in mV, mV per
+// RPM and mV per RPM/s
+#define NOMINAL_KS 500
+#define NOMINAL_KV 20
+#define NOMINAL_KA 10
+
+// How quickly a braked side stops, in ms
+#define BRAKE_TIME_CONSTANT 50
+
+typedef struct side_model_s {
+    double ks, kv, ka;
+    uint8_t port;
+
+    // The most recent output, for measuring the largest step between two
+    // outputs
+    double last_output = 0;
+} side_model_t;
+
+/**
+ * Sets up the model of each side from sysid_consts.hpp, or from the nominal
+ * constants if it has no fit for the drivetrain.
+ * \returns false if the nominal constants are used
+ */
+bool load_side_models(side_model_t &left, uint8_t left_port,
+                      side_model_t &right, uint8_t right_port);
+
+/**
+ * Advances one side of the model by dt seconds, from the command most
+ * recently sent to its motor.
+ * \param peak_accel Raised to the side's acceleration if it is larger, in
+ *                   RPM/s
+ */
+void step_side(side_model_t &side, double dt, double &peak_accel);
+
+#endif /* drive_plant.hpp */
@@ -0,0 +1,358 @@
+/**
+ * A stand-in for the parts of the PROS C API used by the subsystem classes,
+ * so that they can be compiled and run on a computer. See sim.hpp.
+ *
+ * Readings come from the state in sim.hpp, commands are stored there, and
+ * there is no real multitasking: tasks only run when a tool calls
+ * sim::run_task.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "api.h"
+#include "sim.hpp"
+
+#define NUM_MOTOR_PORTS 21
+#define NUM_ADI_PORTS 8
+
+namespace sim {
+
+static motor_state_t motors[NUM_MOTOR_PORTS + 1];
+static double encoders[NUM_ADI_PORTS + 1];
+static uint64_t now_us = 0;
+static std::function<void(uint32_t)> delay_hook;
+
+int32_t battery_mv = 12800;
+
+typedef struct task_entry_s {
+    pros::task_fn_t function;
+    void *param;
+    std::string name;
+} task_entry_t;
+
+static std::vector<task_entry_t *> tasks;
+
+// The task being run by run_task, or nullptr for the tool itself
+static task_entry_t *current_task = nullptr;
+
+// Accepts both the numbered (1-8) and lettered ('a'-'h') forms of ADI ports
+static uint8_t adi_index(uint8_t port) {
+    if (port >= 'a' && port <= 'h')
+        return port - 'a' + 1;
+    if (port >= 'A' && port <= 'H')
+        return port - 'A' + 1;
+    return port <= NUM_ADI_PORTS ? port : 0;
+}
+
+motor_state_t &motor(uint8_t port) {
+    return motors[port <= NUM_MOTOR_PORTS ? port : 0];
+}
+
+double &adi_encoder(uint8_t top_port) { return encoders[adi_index(top_port)]; }
+
+uint64_t time_us() { return now_us; }
+
+void set_time_ms(uint32_t ms) { now_us = (uint64_t)ms * 1000; }
+
+void set_delay_hook(std::function<void(uint32_t)> hook) { delay_hook = hook; }
+
+bool run_task(const char *name) {
+    // Search from the newest task, in case an older object with a task of the
+    // same name has since been destroyed
+    for (auto it = tasks.rbegin(); it != tasks.rend(); ++it) {
+        task_entry_t *t = *it;
+        if (t->name == name) {
+            task_entry_t *caller = current_task;
+            current_task = t;
+            try {
+                t->function(t->param);
+            } catch (const end_of_run &) {
+            }
+            current_task = caller;
+            return true;
+        }
+    }
+    return false;
+}
+
+void reset() {
+    for (motor_state_t &m : motors)
+        m = motor_state_t();
+    for (double &e : encoders)
+        e = 0;
+    now_us = 0;
+    battery_mv = 12800;
+}
+
+static void advance(uint32_t ms) {
+    now_us += (uint64_t)ms * 1000;
+    if (delay_hook)
+        delay_hook(ms);
+}
+
+// Stores a command sent to a motor
+static int32_t command(uint8_t port, motor_cmd_e_t cmd, double value,
+                       int32_t velocity = 0) {
+    if (port < 1 || port > NUM_MOTOR_PORTS) {
+        errno = ENXIO;
+        return PROS_ERR;
+    }
+    motors[port].cmd = cmd;
+    motors[port].cmd_value = value;
+    motors[port].cmd_velocity = velocity;
+    return 1;
+}
+
+} // namespace sim
+
+namespace pros {
+namespace c {
+
+/* RTOS */
+
+uint32_t millis(void) { return sim::now_us / 1000; }
+
+uint64_t micros(void) { return sim::now_us; }
+
+void task_delay(const uint32_t milliseconds) { sim::advance(milliseconds); }
+
+void delay(const uint32_t milliseconds) { sim::advance(milliseconds); }
+
+void task_delay_until(uint32_t *const prev_time, const uint32_t delta) {
+    *prev_time += delta;
+    uint32_t now = millis();
+    sim::advance(*prev_time > now ? *prev_time - now : 0);
+}
+
+task_t task_create(task_fn_t function, void *const parameters, uint32_t prio,
+                   const uint16_t stack_depth, const char *const name) {
+    sim::task_entry_t *t = new sim::task_entry_t{function, parameters, name};
+    sim::tasks.push_back(t);
+    return t;
+}
+
+void task_delete(task_t task) {
+    for (size_t i = 0; i < sim::tasks.size(); ++i) {
+        if (sim::tasks[i] == task) {
+            delete sim::tasks[i];
+            sim::tasks.erase(sim::tasks.begin() + i);
+            return;
+        }
+    }
+}
+
+void task_suspend(task_t task) {}
+
+task_t task_get_current() { return sim::current_task; }
+
+char *task_get_name(task_t task) {
+    static char tool_name[] = "main";
+    if (!task)
+        task = sim::current_task;
+    if (!task)
+        return tool_name;
+    return &static_cast<sim::task_entry_t *>(task)->name[0];
+}
+
+void task_resume(task_t task) {}
+
+/* Misc */
+
+int32_t battery_get_voltage(void) { return sim::battery_mv; }
+
+int32_t usd_is_installed(void) { return 0; }
+
+int32_t controller_get_analog(controller_id_e_t id,
+                              controller_analog_e_t channel) {
+    return 0;
+}
+
+int32_t controller_get_digital(controller_id_e_t id,
+                               controller_digital_e_t button) {
+    return 0;
+}
+
+int32_t controller_get_digital_new_press(controller_id_e_t id,
+                                         controller_digital_e_t button) {
+    return 0;
+}
+
+/* ADI */
+
+adi_encoder_t adi_encoder_init(uint8_t port_top, uint8_t port_bottom,
+                               bool reverse) {
+    return sim::adi_index(port_top);
+}
+
+int32_t adi_encoder_get(adi_encoder_t enc) {
+    return sim::encoders[enc <= NUM_ADI_PORTS ? enc : 0];
+}
+
+int32_t adi_encoder_reset(adi_encoder_t enc) {
+    sim::encoders[enc <= NUM_ADI_PORTS ? enc : 0] = 0;
+    return 1;
+}
+
+/* Motor movement */
+
+int32_t motor_move(uint8_t port, int32_t voltage) {
+    return sim::command(port, sim::E_MOTOR_CMD_MOVE, voltage);
+}
+
+int32_t motor_brake(uint8_t port) {
+    return sim::command(port, sim::E_MOTOR_CMD_BRAKE, 0);
+}
+
+int32_t motor_move_absolute(uint8_t port, const double position,
+                            const int32_t velocity) {
+    return sim::command(port, sim::E_MOTOR_CMD_POSITION, position, velocity);
+}
+
+int32_t motor_move_relative(uint8_t port, const double position,
+                            const int32_t velocity) {
+    return sim::command(port, sim::E_MOTOR_CMD_POSITION,
+                        sim::motor(port).position + position, velocity);
+}
+
+int32_t motor_move_velocity(uint8_t port, const int32_t velocity) {
+    return sim::command(port, sim::E_MOTOR_CMD_VELOCITY, velocity);
+}
+
+int32_t motor_move_voltage(uint8_t port, const int32_t voltage) {
+    return sim::command(port, sim::E_MOTOR_CMD_VOLTAGE, voltage);
+}
+
+int32_t motor_modify_profiled_velocity(uint8_t port, const int32_t velocity) {
+    sim::motor(port).cmd_velocity = velocity;
+    return 1;
+}
+
+/* Motor telemetry */
+
+double motor_get_target_position(uint8_t port) {
+    return sim::motor(port).cmd_value;
+}
+
+int32_t motor_get_target_velocity(uint8_t port) {
+    return sim::motor(port).cmd_velocity;
+}
+
+double motor_get_actual_velocity(uint8_t port) {
+    return sim::motor(port).velocity;
+}
+
+int32_t motor_get_current_draw(uint8_t port) {
+    return sim::motor(port).current;
+}
+
+int32_t motor_get_direction(uint8_t port) {
+    return sim::motor(port).velocity < 0 ? -1 : 1;
+}
+
+double motor_get_efficiency(uint8_t port) { return 100; }
+
+int32_t motor_is_over_current(uint8_t port) {
+    return sim::motor(port).current > sim::motor(port).current_limit;
+}
+
+int32_t motor_is_over_temp(uint8_t port) {
+    return sim::motor(port).temperature >= 55;
+}
+
+int32_t motor_is_stopped(uint8_t port) {
+    return sim::motor(port).velocity == 0;
+}
+
+int32_t motor_get_zero_position_flag(uint8_t port) {
+    return sim::motor(port).position == 0;
+}
+
+uint32_t motor_get_faults(uint8_t port) { return sim::motor(port).faults; }
+
+uint32_t motor_get_flags(uint8_t port) { return sim::motor(port).flags; }
+
+double motor_get_position(uint8_t port) { return sim::motor(port).position; }
+
+double motor_get_power(uint8_t port) {
+    return sim::motor(port).voltage / 1000.0 * sim::motor(port).current /
+           1000.0;
+}
+
+double motor_get_temperature(uint8_t port) {
+    return sim::motor(port).temperature;
+}
+
+double motor_get_torque(uint8_t port) { return sim::motor(port).torque; }
+
+int32_t motor_get_voltage(uint8_t port) { return sim::motor(port).voltage; }
+
+/* Motor configuration */
+
+int32_t motor_set_zero_position(uint8_t port, const double position) {
+    sim::motor(port).position -= position;
+    return 1;
+}
+
+int32_t motor_tare_position(uint8_t port) {
+    sim::motor(port).position = 0;
+    return 1;
+}
+
+int32_t motor_set_brake_mode(uint8_t port, const motor_brake_mode_e_t mode) {
+    sim::motor(port).brake_mode = mode;
+    return 1;
+}
+
+int32_t motor_set_current_limit(uint8_t port, const int32_t limit) {
+    sim::motor(port).current_limit = limit;
+    return 1;
+}
+
+int32_t motor_set_encoder_units(uint8_t port,
+                                const motor_encoder_units_e_t units) {
+    sim::motor(port).encoder_units = units;
+    return 1;
+}
+
+int32_t motor_set_gearing(uint8_t port, const motor_gearset_e_t gearset) {
+    sim::motor(port).gearing = gearset;
+    return 1;
+}
+
+int32_t motor_set_reversed(uint8_t port, const bool reverse) {
+    sim::motor(port).reversed = reverse;
+    return 1;
+}
+
+int32_t motor_set_voltage_limit(uint8_t port, const int32_t limit) {
+    sim::motor(port).voltage_limit = limit;
+    return 1;
+}
+
+motor_brake_mode_e_t motor_get_brake_mode(uint8_t port) {
+    return (motor_brake_mode_e_t)sim::motor(port).brake_mode;
+}
+
+int32_t motor_get_current_limit(uint8_t port) {
+    return sim::motor(port).current_limit;
+}
+
+motor_encoder_units_e_t motor_get_encoder_units(uint8_t port) {
+    return (motor_encoder_units_e_t)sim::motor(port).encoder_units;
+}
+
+motor_gearset_e_t motor_get_gearing(uint8_t port) {
+    return (motor_gearset_e_t)sim::motor(port).gearing;
+}
+
+int32_t motor_is_reversed(uint8_t port) { return sim::motor(port).reversed; }
+
+int32_t motor_get_voltage_limit(uint8_t port) {
+    return sim::motor(port).voltage_limit;
+}
+
+} // namespace c
+} // namespace pros
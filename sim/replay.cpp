@@ -0,0 +1,331 @@
+/**
+ * \file replay.cpp
+ * Replays a recorded sensor log through the unmodified Drivetrain and Flywheel
+ * control code, and checks that every motor output matches the one in the log
+ * to within a tolerance.
+ *
+ * Logs are recorded on the robot by building with D_RECORD (drivetrain) and/or
+ * F_RECORD (flywheel) defined and saving the terminal output. Since each log
+ * line holds the outputs the robot actually sent, a recorded log is also its
+ * own golden trace. When a change to the control code is meant to change the
+ * outputs, --write saves the new outputs as a log in the same format, which
+ * becomes the golden trace for later runs. See README.md for the format.
+ *
+ * Usage: replay [--tol mV] [--write out.log] in.log
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Drivetrain.hpp"
+#include "Flywheel.hpp"
+#include "sim.hpp"
+
+// Ports used for the simulated motors. One motor per side is enough, since
+// every motor on a side is given the same reading.
+#define LEFT_PORT 1
+#define RIGHT_PORT 2
+#define FLYWHEEL_PORT 3
+
+// ADI ports used when the log was recorded with encoders
+#define LEFT_ENCDR_PORT 1
+#define RIGHT_ENCDR_PORT 3
+
+typedef struct line_s {
+    char type;
+    std::vector<std::string> fields;
+    std::string text;
+} line_t;
+
+typedef struct result_s {
+    size_t compared = 0;
+    size_t mismatches = 0;
+    double max_error = 0;
+} result_t;
+
+static double tolerance = 5;
+static FILE *out = nullptr;
+
+static std::vector<std::string> split(const std::string &s) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        size_t comma = s.find(',', start);
+        fields.push_back(s.substr(start, comma - start));
+        if (comma == std::string::npos)
+            return fields;
+        start = comma + 1;
+    }
+}
+
+static double num(const line_t &l, size_t i) {
+    return i < l.fields.size() ? atof(l.fields[i].c_str()) : 0;
+}
+
+// Reads every replay log line, skipping anything else printed to the terminal
+static bool load(const char *path, std::vector<line_t> &lines) {
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+
+    char buf[512];
+    while (fgets(buf, sizeof(buf), f)) {
+        std::string text(buf);
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+            text.pop_back();
+        if (text.size() < 2 || text[1] != ',' || !strchr("HCVDF", text[0]))
+            continue;
+        lines.push_back({text[0], split(text), text});
+    }
+    fclose(f);
+    return true;
+}
+
+// Compares one output against the log, reporting the first few mismatches
+static void check(result_t &r, const char *what, uint32_t time,
+                  double expected, double actual) {
+    double error = fabs(expected - actual);
+    ++r.compared;
+    if (error > r.max_error)
+        r.max_error = error;
+    if (error > tolerance) {
+        if (r.mismatches < 10)
+            printf("  mismatch at %lu ms: %s expected %.0f, got %.0f\n",
+                   (unsigned long)time, what, expected, actual);
+        ++r.mismatches;
+    }
+}
+
+// Compares a true/false output, such as whether the motors were braking
+static void check_flag(result_t &r, const char *what, uint32_t time,
+                       bool expected, bool actual) {
+    ++r.compared;
+    if (expected != actual) {
+        if (r.mismatches < 10)
+            printf("  mismatch at %lu ms: %s expected %d, got %d\n",
+                   (unsigned long)time, what, expected, actual);
+        ++r.mismatches;
+    }
+}
+
+// The output sent to a motor, in mV, and whether it was told to brake
+static double output(uint8_t port, bool &braking) {
+    const sim::motor_state_t &m = sim::motor(port);
+    braking = m.cmd == sim::E_MOTOR_CMD_BRAKE;
+    if (m.cmd == sim::E_MOTOR_CMD_MOVE)
+        return m.cmd_value * 12000 / 127;
+    return m.cmd == sim::E_MOTOR_CMD_VOLTAGE ? m.cmd_value : 0;
+}
+
+// Reads the exit conditions stored in a line, starting at field i
+static settle_params_t settle_params(const line_t &l, size_t i) {
+    settle_params_t params;
+    params.small_error = num(l, i);
+    params.small_time = num(l, i + 1);
+    params.large_error = num(l, i + 2);
+    params.large_time = num(l, i + 3);
+    params.velocity_band = num(l, i + 4);
+    params.stall_velocity = num(l, i + 5);
+    params.stall_time = num(l, i + 6);
+    params.timeout = num(l, i + 7);
+    return params;
+}
+
+static result_t replay_drive(const std::vector<line_t> &lines) {
+    result_t r;
+    Drivetrain drive({LEFT_PORT}, {RIGHT_PORT}, {false}, {false});
+
+    bool found = false;
+    for (const line_t &l : lines) {
+        if (l.type == 'H' && l.fields[1] == "drive") {
+            drive.set_drivetrain_dimensions(num(l, 2), num(l, 3), num(l, 4));
+            drive.set_pid_consts(num(l, 5), num(l, 6), num(l, 7));
+            drive.set_settle_params(settle_params(l, 9));
+            drive.set_slew_rates(num(l, 17), num(l, 18));
+            drive.set_velocity_consts({num(l, 22), num(l, 23), num(l, 24)},
+                                      {num(l, 25), num(l, 26), num(l, 27)},
+                                      num(l, 19), num(l, 20), num(l, 21),
+                                      num(l, 28), num(l, 29));
+            if (num(l, 8))
+                drive.add_adi_encoders(LEFT_ENCDR_PORT, LEFT_ENCDR_PORT + 1,
+                                       false, RIGHT_ENCDR_PORT,
+                                       RIGHT_ENCDR_PORT + 1, false);
+        }
+        found |= l.type == 'D';
+    }
+    if (!found)
+        return r;
+
+    drive.init_task();
+    size_t i = 0;
+
+    // Applies the commands logged before the D line at index i, then sets up
+    // the readings from that line
+    auto advance = [&]() {
+        for (; i < lines.size() && lines[i].type != 'D'; ++i) {
+            const line_t &l = lines[i];
+            if (l.type == 'C' && l.fields[2] == "straight")
+                drive.move_straight(num(l, 3), settle_params(l, 4));
+            else if (l.type == 'C' && l.fields[2] == "turn")
+                drive.turn_angle(num(l, 3), settle_params(l, 4));
+            else if (l.type == 'V')
+                drive.set_velocity_targets(num(l, 2), num(l, 3));
+            if (out && (l.type == 'C' || l.type == 'V'))
+                fprintf(out, "%s\n", l.text.c_str());
+        }
+        if (i == lines.size())
+            throw sim::end_of_run();
+
+        const line_t &l = lines[i];
+        sim::set_time_ms(num(l, 1));
+        sim::motor(LEFT_PORT).position = num(l, 2);
+        sim::motor(RIGHT_PORT).position = num(l, 3);
+        sim::adi_encoder(LEFT_ENCDR_PORT) = num(l, 2);
+        sim::adi_encoder(RIGHT_ENCDR_PORT) = num(l, 3);
+        sim::motor(LEFT_PORT).velocity = num(l, 4);
+        sim::motor(RIGHT_PORT).velocity = num(l, 5);
+        sim::battery_mv = num(l, 6);
+    };
+
+    sim::set_delay_hook([&](uint32_t ms) {
+        const line_t &l = lines[i];
+        uint32_t time = num(l, 1);
+        bool left_brake, right_brake;
+        double left = output(LEFT_PORT, left_brake);
+        double right = output(RIGHT_PORT, right_brake);
+
+        check(r, "left", time, num(l, 7), left);
+        check(r, "right", time, num(l, 8), right);
+        check_flag(r, "brake", time, num(l, 9), left_brake && right_brake);
+
+        if (out) {
+            // Keep the recorded readings, but replace the outputs
+            fprintf(out, "D,%s,%s,%s,%s,%s,%s,%.0f,%.0f,%d\n",
+                    l.fields[1].c_str(), l.fields[2].c_str(),
+                    l.fields[3].c_str(), l.fields[4].c_str(),
+                    l.fields[5].c_str(), l.fields[6].c_str(), left, right,
+                    left_brake && right_brake);
+        }
+
+        ++i;
+        advance();
+    });
+
+    advance();
+    sim::run_task("Drivetrain PID Task");
+    sim::set_delay_hook(nullptr);
+    return r;
+}
+
+static result_t replay_flywheel(const std::vector<line_t> &lines) {
+    result_t r;
+    Flywheel flywheel({FLYWHEEL_PORT}, {false});
+
+    bool found = false;
+    for (const line_t &l : lines) {
+        if (l.type == 'H' && l.fields[1] == "flywheel")
+            flywheel.set_consts(num(l, 2), num(l, 3), num(l, 4), num(l, 5));
+        found |= l.type == 'F';
+    }
+    if (!found)
+        return r;
+
+    flywheel.init_task();
+    size_t i = 0;
+
+    // Moves to the next F line and sets up its target and readings
+    auto advance = [&]() {
+        for (; i < lines.size() && lines[i].type != 'F'; ++i)
+            ;
+        if (i == lines.size())
+            throw sim::end_of_run();
+
+        const line_t &l = lines[i];
+        sim::set_time_ms(num(l, 1));
+        sim::motor(FLYWHEEL_PORT).velocity = num(l, 2);
+        flywheel.set_target_velo(num(l, 3));
+        sim::battery_mv = num(l, 4);
+    };
+
+    sim::set_delay_hook([&](uint32_t ms) {
+        const line_t &l = lines[i];
+        bool braking;
+        double voltage = output(FLYWHEEL_PORT, braking);
+
+        check(r, "flywheel", num(l, 1), num(l, 5), voltage);
+        if (out)
+            fprintf(out, "F,%s,%s,%s,%s,%.0f\n", l.fields[1].c_str(),
+                    l.fields[2].c_str(), l.fields[3].c_str(),
+                    l.fields[4].c_str(), voltage);
+
+        ++i;
+        advance();
+    });
+
+    advance();
+    sim::run_task("Flywheel PID Task");
+    sim::set_delay_hook(nullptr);
+    return r;
+}
+
+static bool report(const char *name, const result_t &r) {
+    if (!r.compared)
+        return true;
+    printf("%s: %zu outputs compared, %zu outside %.1f mV, max error %.1f "
+           "mV\n",
+           name, r.compared, r.mismatches, tolerance, r.max_error);
+    return r.mismatches == 0;
+}
+
+int main(int argc, char **argv) {
+    const char *in_path = nullptr;
+    const char *out_path = nullptr;
+
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--tol") && i + 1 < argc)
+            tolerance = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--write") && i + 1 < argc)
+            out_path = argv[++i];
+        else if (argv[i][0] != '-' && !in_path)
+            in_path = argv[i];
+        else
+            usage = true;
+    }
+    if (!in_path || usage) {
+        fprintf(stderr, "usage: %s [--tol mV] [--write out.log] in.log\n",
+                argv[0]);
+        return 2;
+    }
+
+    std::vector<line_t> lines;
+    if (!load(in_path, lines)) {
+        perror(in_path);
+        return 2;
+    }
+    if (out_path && !(out = fopen(out_path, "w"))) {
+        perror(out_path);
+        return 2;
+    }
+
+    // Each replay makes its own pass over the log, so the written log has
+    // all of the drivetrain lines before all of the flywheel lines
+    if (out) {
+        for (const line_t &l : lines)
+            if (l.type == 'H')
+                fprintf(out, "%s\n", l.text.c_str());
+    }
+
+    bool passed = report("drivetrain", replay_drive(lines));
+    sim::reset();
+    passed &= report("flywheel", replay_flywheel(lines));
+
+    if (out)
+        fclose(out);
+    return passed ? 0 : 1;
+}
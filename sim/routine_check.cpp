@@ -0,0 +1,188 @@
+/**
+ * \file routine_check.cpp
+ * Runs a compiled autonomous routine (see include/Routine.hpp) through the
+ * same Routine interpreter the robot uses, to check it before it is copied to
+ * the SD card.
+ *
+ * Each drive command is run through the unmodified Drivetrain control code
+ * against the model in drive_plant.hpp, set up as initialize and autonomous
+ * set up the robot's drivetrain, starting from rest. The other commands are
+ * given nominal times: shots take INDEXER_SHOT_TIME, the roller turns at
+ * full speed and the flywheel is taken to already be at speed when waited
+ * for. The timeline of the routine is printed, and the exit status is
+ * non-zero if a motion didn't settle or the routine takes longer than the
+ * autonomous period.
+ *
+ * Usage: routine_check [--limit ms] auton_<n>.rtn
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Drivetrain.hpp"
+#include "Indexer.hpp"
+#include "Routine.hpp"
+#include "drive_plant.hpp"
+#include "sim.hpp"
+
+#define LEFT_PORT 1
+#define RIGHT_PORT 2
+
+// The longest a motion may run before it is given up on, in ms
+#define MAX_RUN_TIME 10000
+
+// The roller's speed in autonomous, in RPM, and its gear ratio, as set in
+// Roller.cpp and initialize.cpp
+#define ROLLER_RPM 200
+#define ROLLER_GEAR_RATIO 1
+
+static side_model_t left_model, right_model;
+
+// The length of the command being run, in ms, and what to say about it
+static double duration;
+static const char *note;
+
+// Whether every motion so far has settled
+static bool all_settled = true;
+
+// Runs one motion from rest, setting duration to its settle time
+static void run_motion(bool turn, double amount) {
+    sim::reset();
+    side_model_t left = left_model, right = right_model;
+    double peak_accel = 0;
+    bool finished = false;
+
+    Drivetrain drive({LEFT_PORT}, {RIGHT_PORT}, {false}, {false});
+    drive.set_drivetrain_dimensions(12.5, 1.625, 60.0 / 36.0);
+    drive.set_pid_consts(600, 0, 0);
+    drive.set_settled_threshold(10);
+    drive.set_voltage_limit(6750);
+    drive.set_slew_rates(0, 0);
+    drive.init_task();
+
+    if (turn)
+        drive.turn_angle(amount);
+    else
+        drive.move_straight(amount);
+
+    sim::set_delay_hook([&](uint32_t ms) {
+        for (uint32_t i = 0; i < ms; ++i) {
+            step_side(left, 0.001, peak_accel);
+            step_side(right, 0.001, peak_accel);
+        }
+
+        Motion_Metrics &metrics = drive.get_metrics();
+        if (metrics.size()) {
+            const motion_record_t &record = metrics.get(0);
+            duration = record.settle_time;
+            note = Settle_Detector::exit_reason_name(record.exit_reason);
+            finished = true;
+            throw sim::end_of_run();
+        }
+        if (pros::millis() > MAX_RUN_TIME)
+            throw sim::end_of_run();
+    });
+
+    sim::run_task("Drivetrain PID Task");
+    sim::set_delay_hook(nullptr);
+
+    if (!finished) {
+        duration = MAX_RUN_TIME;
+        note = "did not settle";
+        all_settled = false;
+    }
+}
+
+static void straight_handler(const routine_cmd_t &cmd) {
+    run_motion(false, cmd.arg);
+}
+
+static void turn_handler(const routine_cmd_t &cmd) { run_motion(true, cmd.arg); }
+
+static void delay_handler(const routine_cmd_t &cmd) { duration = cmd.arg; }
+
+static void wait_flywheel_handler(const routine_cmd_t &cmd) {
+    note = "assumed at speed";
+}
+
+static void punch_handler(const routine_cmd_t &cmd) {
+    duration = cmd.arg * INDEXER_SHOT_TIME;
+}
+
+static void roller_handler(const routine_cmd_t &cmd) {
+    // RPM to degrees per ms is a factor of 6 / 1000
+    duration = fabs(cmd.arg) / ROLLER_GEAR_RATIO / (ROLLER_RPM * 6 / 1000.0);
+}
+
+// Takes no time
+static void instant_handler(const routine_cmd_t &cmd) {}
+
+// The position of the next command and when it starts, in ms
+static size_t position = 0;
+static double total = 0;
+
+// Runs a handler and prints the command's line of the timeline
+template <routine_handler_t handler> void timed(const routine_cmd_t &cmd) {
+    duration = 0;
+    note = "";
+    handler(cmd);
+    printf("%4u  %-14s %9g %9.0f %9.0f%s%s\n", (unsigned)position++,
+           Routine::op_name(cmd.op), cmd.arg, total, duration,
+           *note ? "  " : "", note);
+    total += duration;
+}
+
+// What each command does in the simulator, indexed by routine_op_e_t
+static const routine_handler_t handlers[E_ROUTINE_NUM_OPS] = {
+    timed<straight_handler>,      // E_ROUTINE_STRAIGHT
+    timed<turn_handler>,          // E_ROUTINE_TURN
+    timed<delay_handler>,         // E_ROUTINE_DELAY
+    timed<instant_handler>,       // E_ROUTINE_FLYWHEEL
+    timed<wait_flywheel_handler>, // E_ROUTINE_WAIT_FLYWHEEL
+    timed<punch_handler>,         // E_ROUTINE_PUNCH
+    timed<instant_handler>,       // E_ROUTINE_INTAKE
+    timed<roller_handler>,        // E_ROUTINE_ROLLER
+    timed<instant_handler>        // E_ROUTINE_PISTON
+};
+
+int main(int argc, char **argv) {
+    const char *path = nullptr;
+    double limit = 15000;
+    bool usage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--limit") && i + 1 < argc)
+            limit = atof(argv[++i]);
+        else if (!path && argv[i][0] != '-')
+            path = argv[i];
+        else
+            usage = true;
+    }
+    if (usage || !path) {
+        fprintf(stderr, "usage: %s [--limit ms] auton_<n>.rtn\n", argv[0]);
+        return 2;
+    }
+
+    static Routine routine;
+    if (!routine.load_file(path)) {
+        fprintf(stderr, "could not load %s\n", path);
+        return 2;
+    }
+
+    if (!load_side_models(left_model, LEFT_PORT, right_model, RIGHT_PORT))
+        printf("no drivetrain fit in sysid_consts.hpp, using nominal "
+               "constants\n");
+
+    printf("%4s  %-14s %9s %9s %9s  %s\n", "cmd", "op", "arg", "start_ms",
+           "ms", "note");
+    routine.run(handlers);
+
+    printf("total %.0f ms of %.0f ms\n", total, limit);
+    if (!all_settled)
+        printf("a motion did not settle\n");
+    if (total > limit)
+        printf("the routine is %.0f ms too long\n", total - limit);
+    return all_settled && total <= limit ? 0 : 1;
+}
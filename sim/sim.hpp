@@ -0,0 +1,94 @@
+/**
+ * \file sim.hpp
+ * The interface between the host-side tools in this directory and the stand-in
+ * PROS API implemented in pros_shim.cpp.
+ *
+ * The robot code (Drivetrain.cpp, Flywheel.cpp, ...) is compiled unmodified
+ * for the host and linked against pros_shim.cpp instead of libpros. Motor and
+ * sensor readings come from the state held here, which a tool fills in before
+ * each control loop iteration, and every motor command from the robot code is
+ * stored here so that it can be checked or fed to a model.
+ *
+ * There is no scheduler. A tool runs a task function on its own thread with
+ * run_task(), and every pros::delay() call made by that task advances the
+ * simulated clock and calls the delay hook. The hook is where the tool
+ * inspects the outputs and sets up the next iteration's inputs. Throwing
+ * end_of_run from the hook stops the task.
+ */
+
+#ifndef SIM_HPP
+#define SIM_HPP
+
+#include <cstdint>
+#include <functional>
+
+namespace sim {
+
+// The kind of command most recently sent to a motor
+typedef enum motor_cmd_e {
+    E_MOTOR_CMD_NONE = 0,
+    E_MOTOR_CMD_MOVE,     // motor_move, value is -127 to 127
+    E_MOTOR_CMD_VOLTAGE,  // motor_move_voltage, value is in mV
+    E_MOTOR_CMD_VELOCITY, // motor_move_velocity, value is in RPM
+    E_MOTOR_CMD_POSITION, // motor_move_absolute/relative, value is the target
+    E_MOTOR_CMD_BRAKE     // motor_brake
+} motor_cmd_e_t;
+
+typedef struct motor_state_s {
+    // Readings returned to the robot code
+    double position = 0;
+    double velocity = 0;
+    int32_t voltage = 0;
+    int32_t current = 0;
+    double temperature = 25;
+    double torque = 0;
+    uint32_t faults = 0;
+    uint32_t flags = 0;
+
+    // The most recent command from the robot code
+    motor_cmd_e_t cmd = E_MOTOR_CMD_NONE;
+    double cmd_value = 0;
+    int32_t cmd_velocity = 0; // profile velocity for position commands
+
+    // Configuration set by the robot code
+    int32_t current_limit = 2500;
+    int32_t voltage_limit = 0;
+    bool reversed = false;
+    int brake_mode = 0;
+    int gearing = 0;
+    int encoder_units = 0;
+} motor_state_t;
+
+// Thrown from a delay hook to stop the task being run
+struct end_of_run {};
+
+// The state of the motor in the given port (1-21)
+motor_state_t &motor(uint8_t port);
+
+// The value returned by adi_encoder_get for the encoder whose top port is
+// given ('a'-'h' or 1-8)
+double &adi_encoder(uint8_t top_port);
+
+// The battery voltage, in mV
+extern int32_t battery_mv;
+
+// The simulated clock, in microseconds
+uint64_t time_us();
+void set_time_ms(uint32_t ms);
+
+// Called with the requested time every time the robot code delays, after the
+// clock has been advanced
+void set_delay_hook(std::function<void(uint32_t)> hook);
+
+// Runs the function of the task created with the given name on the calling
+// thread until a delay hook throws end_of_run. Returns false if no task with
+// that name was created.
+bool run_task(const char *name);
+
+// Puts every motor, encoder and the clock back to their defaults. Created
+// tasks are kept.
+void reset();
+
+} // namespace sim
+
+#endif /* sim.hpp */
@@ -0,0 +1,259 @@
+#include "Action_Graph.hpp"
+#include "Trace.hpp"
+#include "api.h"
+
+#include <cstdio>
+
+bool Action_Graph::valid(int node) {
+    return node >= 0 && (size_t)node < count;
+}
+
+int Action_Graph::add(const char *name, action_fn_t start,
+                      action_check_fn_t done) {
+    if (count >= ACTION_GRAPH_MAX_NODES)
+        return -1;
+    nodes[count] = {};
+    nodes[count].name = name;
+    nodes[count].start = start;
+    nodes[count].done = done;
+    return count++;
+}
+
+void Action_Graph::after(int node, int dependency) {
+    if (valid(node) && valid(dependency) && node != dependency)
+        nodes[node].deps |= 1u << dependency;
+}
+
+void Action_Graph::when(int node, action_check_fn_t condition) {
+    if (valid(node))
+        nodes[node].condition = condition;
+}
+
+void Action_Graph::hold(int node, uint32_t ms) {
+    if (valid(node))
+        nodes[node].min_time = ms;
+}
+
+void Action_Graph::estimate(int node, uint32_t ms, int points) {
+    if (valid(node)) {
+        nodes[node].estimate = ms;
+        nodes[node].points = points;
+    }
+}
+
+void Action_Graph::on_cutoff(int node, action_fn_t stop) {
+    if (valid(node))
+        nodes[node].stop = stop;
+}
+
+uint32_t Action_Graph::finished_mask() {
+    uint32_t mask = done_mask;
+    for (size_t i = 0; i < count; ++i)
+        if (nodes[i].state == E_ACTION_SKIPPED)
+            mask |= 1u << i;
+    return mask;
+}
+
+uint32_t Action_Graph::longest_chain(uint32_t elapsed) {
+    // Each action's own time left, then the longest chain ending with it,
+    // found by relaxing every action once per action in the graph, which is
+    // enough for the longest possible chain and stops a cycle from growing
+    // forever
+    uint32_t own[ACTION_GRAPH_MAX_NODES];
+    uint32_t chain[ACTION_GRAPH_MAX_NODES];
+    for (size_t i = 0; i < count; ++i) {
+        const action_node_t &node = nodes[i];
+        own[i] = 0;
+        if (node.state == E_ACTION_WAITING)
+            own[i] = node.estimate;
+        else if (node.state == E_ACTION_RUNNING &&
+                 elapsed - node.start_time < node.estimate)
+            own[i] = node.estimate - (elapsed - node.start_time);
+        chain[i] = own[i];
+    }
+
+    for (size_t pass = 0; pass < count; ++pass) {
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t before = 0;
+            for (size_t j = 0; j < count; ++j)
+                if ((nodes[i].deps & (1u << j)) && chain[j] > before)
+                    before = chain[j];
+            chain[i] = own[i] + before;
+        }
+    }
+
+    uint32_t longest = 0;
+    for (size_t i = 0; i < count; ++i)
+        if ((nodes[i].state == E_ACTION_WAITING ||
+             nodes[i].state == E_ACTION_RUNNING) &&
+            chain[i] > longest)
+            longest = chain[i];
+    return longest;
+}
+
+uint32_t Action_Graph::dependents(size_t node) {
+    uint32_t set = 1u << node;
+    bool grew = true;
+    while (grew) {
+        grew = false;
+        for (size_t i = 0; i < count; ++i) {
+            if (!(set & (1u << i)) && (nodes[i].deps & set) &&
+                nodes[i].state == E_ACTION_WAITING) {
+                set |= 1u << i;
+                grew = true;
+            }
+        }
+    }
+    return set;
+}
+
+void Action_Graph::plan(uint32_t elapsed, uint32_t deadline) {
+    uint32_t left = deadline - elapsed;
+    while (longest_chain(elapsed) > left) {
+        // The waiting action whose skipping gives up the fewest points for
+        // each ms it saves
+        int worst = -1;
+        int worst_points = 0;
+        uint32_t worst_time = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (nodes[i].state != E_ACTION_WAITING)
+                continue;
+            uint32_t set = dependents(i);
+            int points = 0;
+            uint32_t time = 0;
+            for (size_t j = 0; j < count; ++j) {
+                if (set & (1u << j)) {
+                    points += nodes[j].points;
+                    time += nodes[j].estimate;
+                }
+            }
+            if (time == 0)
+                continue;
+            if (worst < 0 ||
+                (int64_t)points * worst_time < (int64_t)worst_points * time) {
+                worst = i;
+                worst_points = points;
+                worst_time = time;
+            }
+        }
+        if (worst < 0)
+            return; // Nothing left that would save any time
+
+        uint32_t set = dependents(worst);
+        printf("Skipping %s and what comes after it, worth %d points, to "
+               "finish in time\n",
+               nodes[worst].name, worst_points);
+        for (size_t i = 0; i < count; ++i)
+            if (set & (1u << i))
+                nodes[i].state = E_ACTION_SKIPPED;
+    }
+}
+
+bool Action_Graph::run(uint32_t deadline, uint32_t period) {
+    uint32_t all = count == 32 ? 0xffffffff : (1u << count) - 1;
+    done_mask = 0;
+    for (size_t i = 0; i < count; ++i)
+        nodes[i].state = E_ACTION_WAITING;
+
+    uint32_t start = pros::millis();
+    uint32_t now = start;
+    while (finished_mask() != all) {
+        uint32_t elapsed = now - start;
+        if (elapsed >= deadline) {
+            for (size_t i = 0; i < count; ++i) {
+                action_node_t &node = nodes[i];
+                if (node.state == E_ACTION_RUNNING) {
+                    node.state = E_ACTION_CUT;
+                    node.end_time = elapsed;
+                    if (node.stop)
+                        node.stop();
+                }
+            }
+            printf("Action graph reached its deadline\n");
+            return false;
+        }
+
+        plan(elapsed, deadline);
+
+        bool running = false;
+        for (size_t i = 0; i < count; ++i) {
+            action_node_t &node = nodes[i];
+            // Each action is started and checked in the same period, so one
+            // that finishes straight away lets the actions after it in the
+            // table start in the same period too
+            if (node.state == E_ACTION_WAITING &&
+                (node.deps & done_mask) == node.deps &&
+                (!node.condition || node.condition())) {
+                node.state = E_ACTION_RUNNING;
+                node.start_time = elapsed;
+                Trace::mark(i);
+                if (node.start)
+                    node.start();
+            }
+            if (node.state == E_ACTION_RUNNING &&
+                elapsed - node.start_time >= node.min_time &&
+                (!node.done || node.done())) {
+                node.state = E_ACTION_DONE;
+                node.end_time = elapsed;
+                done_mask |= 1u << i;
+            }
+            if (node.state == E_ACTION_RUNNING)
+                running = true;
+        }
+
+        if (!running && finished_mask() != all) {
+            // Without anything running, an action whose dependencies aren't
+            // all done can never start
+            bool can_start = false;
+            for (size_t i = 0; i < count; ++i)
+                if (nodes[i].state == E_ACTION_WAITING &&
+                    (nodes[i].deps & done_mask) == nodes[i].deps)
+                    can_start = true;
+            if (!can_start) {
+                printf("Action graph has a dependency cycle\n");
+                return false;
+            }
+        }
+
+        if (finished_mask() != all)
+            pros::c::task_delay_until(&now, period);
+    }
+    return done_mask == all;
+}
+
+const action_node_t &Action_Graph::get(int node) { return nodes[node]; }
+
+size_t Action_Graph::size() { return count; }
+
+void Action_Graph::clear() {
+    count = 0;
+    done_mask = 0;
+}
+
+void Action_Graph::print() {
+    for (size_t i = 0; i < count; ++i) {
+        const action_node_t &node = nodes[i];
+        printf("%u %s: ", (unsigned)i, node.name);
+        switch (node.state) {
+        case E_ACTION_DONE:
+            printf("%lu to %lu ms\n", (unsigned long)node.start_time,
+                   (unsigned long)node.end_time);
+            break;
+        case E_ACTION_RUNNING:
+            printf("started at %lu ms, didn't finish\n",
+                   (unsigned long)node.start_time);
+            break;
+        case E_ACTION_CUT:
+            printf("%lu ms, cut short at %lu ms\n",
+                   (unsigned long)node.start_time,
+                   (unsigned long)node.end_time);
+            break;
+        case E_ACTION_SKIPPED:
+            printf("skipped\n");
+            break;
+        default:
+            printf("didn't start\n");
+            break;
+        }
+    }
+}
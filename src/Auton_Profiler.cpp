@@ -0,0 +1,149 @@
+#include "Auton_Profiler.hpp"
+#include "Trace.hpp"
+#include "pros/misc.h"
+
+#include <cstring>
+
+Auton_Profiler::Auton_Profiler(Drivetrain &drive) : drive(drive) {}
+
+void Auton_Profiler::start() {
+    count = 0;
+    running = false;
+    routine_start = pros::millis();
+    last_end = routine_start;
+}
+
+void Auton_Profiler::step(const char *label) {
+    if (count == AUTON_PROFILER_MAX_STEPS && running)
+        return;
+    end();
+    if (count == AUTON_PROFILER_MAX_STEPS)
+        return;
+
+    uint32_t now = pros::millis();
+    auton_step_t &s = steps[count++];
+    s = {};
+    s.label = label;
+    s.start = now - routine_start;
+    s.gap = now - last_end;
+    s.baseline = -1;
+
+    step_start = now;
+    moving_start = drive.get_moving_time();
+    running = true;
+    Trace::mark(count - 1);
+}
+
+void Auton_Profiler::end() {
+    if (!running)
+        return;
+    running = false;
+
+    uint32_t now = pros::millis();
+    auton_step_t &s = steps[count - 1];
+    s.total = now - step_start;
+    s.moving = (drive.get_moving_time() - moving_start) / 1000;
+    // The moving time is only updated each PID iteration, so it can run a
+    // little past the end of the step
+    if (s.moving > s.total)
+        s.moving = s.total;
+    s.blocked = s.total - s.moving;
+    last_end = now;
+}
+
+void Auton_Profiler::clear() {
+    count = 0;
+    running = false;
+}
+
+size_t Auton_Profiler::size() { return count; }
+
+const auton_step_t &Auton_Profiler::get(size_t index) { return steps[index]; }
+
+void Auton_Profiler::compare_baseline() {
+    if (!pros::c::usd_is_installed())
+        return;
+    FILE *file = fopen(BASELINE_PATH, "r");
+    if (!file)
+        return;
+
+    char line[160];
+    // Skips the header
+    fgets(line, sizeof(line), file);
+    for (size_t i = 0; i < count && fgets(line, sizeof(line), file); ++i) {
+        unsigned index;
+        char label[64];
+        unsigned long start, total;
+        if (sscanf(line, "%u,%63[^,],%lu,%lu", &index, label, &start,
+                   &total) != 4 ||
+            index != i || strcmp(label, steps[i].label) != 0)
+            break;
+
+        auton_step_t &s = steps[i];
+        s.baseline = total;
+        s.regressed = s.total > total * (1 + REGRESSION_FRACTION) &&
+                      s.total > total + REGRESSION_TIME;
+    }
+    fclose(file);
+}
+
+void Auton_Profiler::write_csv(FILE *file) {
+    fprintf(file, "step,label,start_ms,total_ms,moving_ms,blocked_ms,gap_ms,"
+                  "cumulative_ms,baseline_ms,regressed\n");
+    for (size_t i = 0; i < count; ++i) {
+        const auton_step_t &s = steps[i];
+        fprintf(file, "%u,%s,%lu,%lu,%lu,%lu,%lu,%lu,", (unsigned)i, s.label,
+                (unsigned long)s.start, (unsigned long)s.total,
+                (unsigned long)s.moving, (unsigned long)s.blocked,
+                (unsigned long)s.gap, (unsigned long)(s.start + s.total));
+        if (s.baseline >= 0)
+            fprintf(file, "%ld,%d\n", (long)s.baseline, s.regressed);
+        else
+            fprintf(file, ",\n");
+    }
+}
+
+size_t Auton_Profiler::report() {
+    end();
+    compare_baseline();
+    write_csv(stdout);
+
+    size_t regressions = 0;
+    uint32_t moving = 0, blocked = 0, gap = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const auton_step_t &s = steps[i];
+        moving += s.moving;
+        blocked += s.blocked;
+        gap += s.gap;
+        if (s.regressed) {
+            printf("Step %u (%s) took %lu ms, %ld ms in the baseline\n",
+                   (unsigned)i, s.label, (unsigned long)s.total,
+                   (long)s.baseline);
+            ++regressions;
+        }
+    }
+    printf("%u steps: %lu ms moving, %lu ms blocked, %lu ms idle between "
+           "steps\n",
+           (unsigned)count, (unsigned long)moving, (unsigned long)blocked,
+           (unsigned long)gap);
+
+    if (!pros::c::usd_is_installed())
+        return regressions;
+    char path[64];
+    for (int n = 0; n < 1000; ++n) {
+        snprintf(path, sizeof(path), "/usd/steps_%d.csv", n);
+        FILE *existing = fopen(path, "r");
+        if (existing) {
+            fclose(existing);
+            continue;
+        }
+
+        FILE *file = fopen(path, "w");
+        if (file) {
+            write_csv(file);
+            fclose(file);
+        }
+        break;
+    }
+    return regressions;
+}
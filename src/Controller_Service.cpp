@@ -0,0 +1,77 @@
+#include "Controller_Service.hpp"
+
+Controller_Service::Controller_Service(pros::controller_id_e_t controller)
+    : Subsystem("controller", "Controller Service Task",
+                CONTROLLER_SERVICE_PERIOD, TASK_PRIORITY_DEFAULT + 1),
+      controller(controller) {}
+
+uint32_t Controller_Service::tick(uint32_t now) {
+    uint16_t prev_held = reading.held;
+
+    ++reading.seq;
+    reading.time = now;
+    reading.connected = pros::c::controller_is_connected(controller) == 1;
+
+    // A disconnected controller returns PROS_ERR rather than 0, so its
+    // readings are left at 0 instead
+    for (int axis = pros::E_CONTROLLER_ANALOG_LEFT_X;
+         axis <= pros::E_CONTROLLER_ANALOG_RIGHT_Y; ++axis) {
+        int32_t value = pros::c::controller_get_analog(
+            controller, (pros::controller_analog_e_t)axis);
+        reading.analog[axis] =
+            reading.connected && value != PROS_ERR ? value : 0;
+    }
+
+    reading.held = 0;
+    for (int button = CONTROLLER_FIRST_BUTTON; button <= CONTROLLER_LAST_BUTTON;
+         ++button) {
+        if (reading.connected &&
+            pros::c::controller_get_digital(
+                controller, (pros::controller_digital_e_t)button) == 1)
+            reading.held |= 1 << (button - CONTROLLER_FIRST_BUTTON);
+    }
+    reading.pressed = reading.held & ~prev_held;
+    reading.released = prev_held & ~reading.held;
+    for (int i = 0; i < CONTROLLER_BUTTONS; ++i) {
+        if (reading.pressed & (1 << i))
+            ++reading.presses[i];
+        if (reading.released & (1 << i))
+            ++reading.releases[i];
+    }
+
+    latest.write(reading);
+    return CONTROLLER_SERVICE_PERIOD;
+}
+
+controller_snapshot_t Controller_Service::get() { return latest.read(); }
+
+controller_snapshot_t
+Controller_Service::wait_next(const controller_snapshot_t &last) {
+    controller_snapshot_t snapshot;
+    while (true) {
+        latest.read(snapshot);
+        if (snapshot.seq != last.seq && snapshot.seq != 0)
+            break;
+        pros::delay(1);
+    }
+
+    // Against the first snapshot, the snapshot's own edges are used, rather
+    // than every press since the program started
+    if (last.seq == 0)
+        return snapshot;
+    snapshot.pressed = 0;
+    snapshot.released = 0;
+    for (int i = 0; i < CONTROLLER_BUTTONS; ++i) {
+        if (snapshot.presses[i] != last.presses[i])
+            snapshot.pressed |= 1 << i;
+        if (snapshot.releases[i] != last.releases[i])
+            snapshot.released |= 1 << i;
+    }
+    return snapshot;
+}
+
+void Controller_Service::snapshot(subsystem_snapshot_t &snap) {
+    snap.state = latest.read().connected;
+}
+
+void Controller_Service::safe_stop() {}
@@ -0,0 +1,85 @@
+#include "Coroutine_Runner.hpp"
+#include "Trace.hpp"
+
+#include <cstdio>
+
+bool Coroutine_Runner::valid(int id) {
+    return id >= 0 && (size_t)id < count;
+}
+
+int Coroutine_Runner::spawn(const char *name, coroutine_fn_t fn) {
+    if (count >= COROUTINE_MAX)
+        return -1;
+    coroutines[count] = {};
+    coroutines[count].name = name;
+    coroutines[count].fn = fn;
+    return count++;
+}
+
+void Coroutine_Runner::on_cutoff(int id, coroutine_stop_t stop) {
+    if (valid(id))
+        coroutines[id].stop = stop;
+}
+
+bool Coroutine_Runner::tick(uint32_t elapsed) {
+    bool all_done = true;
+    for (size_t i = 0; i < count; ++i) {
+        coroutine_t &co = coroutines[i];
+        if (co.done)
+            continue;
+        if (co.context.line == 0)
+            Trace::mark(i);
+        if (co.fn(co.context)) {
+            co.done = true;
+            co.end_time = elapsed;
+        } else
+            all_done = false;
+    }
+    return all_done;
+}
+
+bool Coroutine_Runner::run(uint32_t timeout, uint32_t period) {
+    uint32_t start = pros::millis();
+    uint32_t now = start;
+    while (!tick(now - start)) {
+        if (now - start >= timeout) {
+            printf("Coroutines timed out\n");
+            for (size_t i = 0; i < count; ++i)
+                if (!coroutines[i].done && coroutines[i].stop)
+                    coroutines[i].stop();
+            return false;
+        }
+        pros::c::task_delay_until(&now, period);
+    }
+    return true;
+}
+
+bool Coroutine_Runner::is_done(int id) {
+    return !valid(id) || coroutines[id].done;
+}
+
+void Coroutine_Runner::cancel(int id) {
+    if (valid(id) && !coroutines[id].done) {
+        coroutines[id].done = true;
+        coroutines[id].cancelled = true;
+    }
+}
+
+size_t Coroutine_Runner::size() { return count; }
+
+const coroutine_t &Coroutine_Runner::get(int id) { return coroutines[id]; }
+
+void Coroutine_Runner::clear() { count = 0; }
+
+void Coroutine_Runner::print() {
+    for (size_t i = 0; i < count; ++i) {
+        const coroutine_t &co = coroutines[i];
+        if (co.cancelled)
+            printf("%u %s: cancelled\n", (unsigned)i, co.name);
+        else if (co.done)
+            printf("%u %s: finished at %lu ms\n", (unsigned)i, co.name,
+                   (unsigned long)co.end_time);
+        else
+            printf("%u %s: didn't finish\n", (unsigned)i, co.name);
+    }
+}
@@ -6,19 +6,13 @@ Drivetrain::Drivetrain(std::initializer_list<int> left_ports,
                        std::initializer_list<int> right_ports,
                        std::initializer_list<bool> left_revs,
                        std::initializer_list<bool> right_revs)
-    : left_motors(left_ports, left_revs),
+    : Subsystem("drive_pid", "Drivetrain PID Task", 2),
+      left_motors(left_ports, left_revs),
       right_motors(right_ports, right_revs) {
     left_motors.set_encoder_units(pros::E_MOTOR_ENCODER_DEGREES);
     right_motors.set_encoder_units(pros::E_MOTOR_ENCODER_DEGREES);
 }
 
-void Drivetrain::trampoline(void *param) {
-    if (param) {
-        Drivetrain *that = static_cast<Drivetrain *>(param);
-        that->pid_task_fn();
-    }
-}
-
 double Drivetrain::convert_inches_to_degrees(double inches) {
     /**
      * Formula Explanation:
@@ -62,90 +56,242 @@ void Drivetrain::add_adi_encoders(uint8_t left_encdr_top_port,
         right_encdr_top_port, right_encdr_bot_port, right_encdr_rev);
 }
 
-void Drivetrain::pid_task_fn() {
-    double left_integral = 0;
-    double left_prev_error = 0;
-    double left_error = 0;
+uint32_t Drivetrain::tick(uint32_t now) {
+    // Counts the time since the last iteration if the drivetrain was
+    // following a command during it
+    uint32_t now_us = pros::c::micros();
+    if (command_seq != 0 &&
+        (command.mode == E_DRIVE_MODE_VELOCITY || !is_settled))
+        moving_time += now_us - last_tick;
+    last_tick = now_us;
 
-    double right_integral = 0;
-    double right_prev_error = 0;
-    double right_error = 0;
+    double left_pos, right_pos;
+    if (using_encdrs) {
+        left_pos = pros::c::adi_encoder_get(left_encdr);
+        right_pos = pros::c::adi_encoder_get(right_encdr);
+    } else {
+        left_pos = left_motors.get_avg_position();
+        right_pos = right_motors.get_avg_position();
+    }
+    double left_vel = left_motors.get_avg_velocity();
+    double right_vel = right_motors.get_avg_velocity();
+
+    // Pick up a new command, if one has been sent
+    bool new_command = false;
+    bool was_velocity = command.mode == E_DRIVE_MODE_VELOCITY;
+    if (commands.get_seq() != command_seq) {
+        command_seq = commands.read(command);
+        new_command = true;
+        // The motion this replaces, if it hadn't settled, and any sent since
+        // that this task never picked up are finished, so that nothing waits
+        // on them forever. Each write moves the seq on by 2.
+        settled_seq = command_seq - 2;
+    }
 
-    int count = 0;
+    if (command.mode == E_DRIVE_MODE_VELOCITY) {
+        if (new_command && !was_velocity) {
+            // Start from the current speed, so that switching modes doesn't
+            // jerk the robot
+            left_vel_state = {left_vel, 0, 0, 0};
+            right_vel_state = {right_vel, 0, 0, 0};
+            vel_last_time = now;
+        }
+        double dt = (now - vel_last_time) / 1000.0;
+        vel_last_time = now;
+
+        int left_voltage = velocity_step(left_vel_state, command.left_vel,
+                                         left_vel, left_ff, dt);
+        int right_voltage = velocity_step(right_vel_state, command.right_vel,
+                                          right_vel, right_ff, dt);
+        output_voltage(left_voltage, right_voltage, now);
+        record_sample(left_pos, right_pos, left_vel, right_vel, left_voltage,
+                      right_voltage, false);
+        return 2;
+    }
+
+    if (new_command) {
+        left_start = left_pos;
+        right_start = right_pos;
+    }
 
-    while (true) {
-        if (using_encdrs) {
-            left_error = left_targ - pros::c::adi_encoder_get(left_encdr);
-            right_error = right_targ - pros::c::adi_encoder_get(right_encdr);
-        } else {
-            left_error = left_targ - left_motors.get_avg_position();
-            right_error = right_targ - right_motors.get_avg_position();
+    double left_error = left_start + command.left_targ - left_pos;
+    double right_error = right_start + command.right_targ - right_pos;
+
+    left_integral += left_error;
+    right_integral += right_error;
+
+    if (new_command) {
+        left_integral = 0;
+        left_prev_error = 0;
+        left_error = 0;
+
+        right_integral = 0;
+        right_prev_error = 0;
+        right_error = 0;
+
+        is_settled = false;
+        exit_reason = E_SETTLE_NONE;
+        settle_detector.reset(command.settle, now);
+        remaining = fmax(fabs(command.left_targ), fabs(command.right_targ));
+        started_seq = command_seq;
+        Trace::record(E_TRACE_MOTION_START, command_seq);
+        metrics.begin(command.type, command.amount,
+                      fmax(fabs(command.left_targ), fabs(command.right_targ)),
+                      now);
+    } else if (!is_settled) {
+        // Progress is measured along each side's direction of travel, so that
+        // turns and backwards motions count as positive
+        int left_dir = (command.left_targ > 0) - (command.left_targ < 0);
+        int right_dir = (command.right_targ > 0) - (command.right_targ < 0);
+        double progress = ((left_pos - left_start) * left_dir +
+                           (right_pos - right_start) * right_dir) /
+                          2;
+        // The motor encoders are only read, and so only compared, when
+        // there are no tracking wheels
+        double slip = using_encdrs
+                          ? 0
+                          : fmax(left_motors.get_position_disagreement(),
+                                 right_motors.get_position_disagreement());
+        metrics.update(progress,
+                       left_motors.get_total_current_draw() +
+                           right_motors.get_total_current_draw(),
+                       slip, now);
+
+        // The motion is judged by whichever side is furthest from being done
+        double error = fmax(fabs(left_error), fabs(right_error));
+        remaining = error;
+        settle_exit_e_t reason = settle_detector.update(
+            error, fmax(fabs(left_vel), fabs(right_vel)), now);
+        if (reason != E_SETTLE_NONE) {
+            metrics.end(error, reason, now);
+            exit_reason = reason;
+            is_settled = true;
+            settled_seq = command_seq;
+            remaining = 0;
+            Trace::record(E_TRACE_MOTION_END, reason);
         }
+    }
 
-        left_integral += left_error;
-        right_integral += right_error;
+    int left_voltage, right_voltage;
 
-        if (reset_pid_vars) {
-            left_integral = 0;
-            left_prev_error = 0;
-            left_error = 0;
+    if (is_settled) {
+        left_voltage = 0;
+        right_voltage = 0;
+        output_brake();
+        record_sample(left_pos, right_pos, left_vel, right_vel, 0, 0, true);
+        return 5;
+    } else {
+        left_voltage = left_error * command.kP +
+                       left_integral * command.kI +
+                       (left_error - left_prev_error) * command.kD;
+        right_voltage = right_error * command.kP +
+                        right_integral * command.kI +
+                        (right_error - right_prev_error) * command.kD;
+    }
 
-            right_integral = 0;
-            right_prev_error = 0;
-            right_error = 0;
+    output_voltage(left_voltage, right_voltage, now);
+    record_sample(left_pos, right_pos, left_vel, right_vel, left_voltage,
+                  right_voltage, false);
 
-            is_settled = false;
-            reset_pid_vars = false;
-        } else if (fabs(left_error) < settled_threshold &&
-                   fabs(right_error) < settled_threshold) {
-            is_settled = true;
-        } else
-            is_settled = false;
+#ifdef D_DEBUG
+    printf("Left Error: %.2lf\nRight Error: %.2lf\nSettled: %d\n",
+           left_error, right_error, is_settled);
+    print_telemetry(E_MOTOR_GROUP_TELEM_PRINT_VOLTAGE,
+                    E_MOTOR_GROUP_TELEM_PRINT_VOLTAGE);
+#endif
+    left_prev_error = left_error;
+    right_prev_error = right_error;
+    return 2;
+}
 
-        int left_voltage, right_voltage;
+int Drivetrain::velocity_step(drive_velocity_state_t &state, double target,
+                              double measured, const drive_feedforward_t &ff,
+                              double dt) {
+    // Move the setpoint toward the target no faster than max_accel
+    double change = target - state.setpoint;
+    if (max_accel > 0 && fabs(change) > max_accel * dt)
+        change = copysign(max_accel * dt, change);
+    state.setpoint += change;
+    state.accel = dt > 0 ? change / dt : 0;
+
+    double error = state.setpoint - measured;
+    int sign = (state.setpoint > 0) - (state.setpoint < 0);
+    double voltage = ff.kS * sign + ff.kV * state.setpoint +
+                     ff.kA * state.accel + vel_kP * error +
+                     vel_kI * state.integral +
+                     vel_kD * (error - state.prev_error);
+    state.prev_error = error;
+
+    // Only integrate while the output isn't saturated, so that pushing
+    // against another robot doesn't wind the integral up
+    if (fabs(voltage) < 12000)
+        state.integral += error;
+
+    // Clamped by output_voltage
+    return voltage;
+}
 
-        if (left_error == left_prev_error && right_error == right_prev_error) {
-            ++count;
-        } else
-            count = 0;
+int Drivetrain::read_axis(const controller_snapshot_t &snapshot,
+                          pros::controller_analog_e_t axis) {
+    return axis_curves[axis].apply(snapshot.get_analog(axis));
+}
 
-        if (count > 5) {
-            is_settled = true;
-            count = 0;
-        }
+void Drivetrain::output_voltage(int &left_voltage, int &right_voltage,
+                                uint32_t now) {
+    // The PID and velocity controllers, as well as arcade drive, can ask for
+    // more than the motors can give
+    if (abs(left_voltage) > 12000)
+        left_voltage = copysign(12000, left_voltage);
+    if (abs(right_voltage) > 12000)
+        right_voltage = copysign(12000, right_voltage);
+
+    left_voltage = left_slew.step(left_voltage, now);
+    right_voltage = right_slew.step(right_voltage, now);
+    left_motors.move_voltage(left_voltage);
+    right_motors.move_voltage(right_voltage);
+}
 
-        if (is_settled) {
-            left_voltage = 0;
-            right_voltage = 0;
-            left_motors.brake();
-            right_motors.brake();
-            pros::delay(5);
-
-            continue;
-        } else {
-            left_voltage = left_error * kP + left_integral * kI +
-                           (left_error - left_prev_error) * kD;
-            right_voltage = right_error * kP + right_integral * kI +
-                            (right_error - right_prev_error) * kD;
-        }
+void Drivetrain::output_brake() {
+    left_slew.reset();
+    right_slew.reset();
+    left_motors.brake();
+    right_motors.brake();
+}
 
-        if (abs(left_voltage) > 12000)
-            left_voltage = copysign(12000, left_voltage);
-        if (abs(right_voltage) > 12000)
-            right_voltage = copysign(12000, right_voltage);
-        left_motors.move_voltage(left_voltage);
-        right_motors.move_voltage(right_voltage);
+void Drivetrain::record_sample(double left_pos, double right_pos,
+                               double left_vel, double right_vel,
+                               int left_voltage, int right_voltage,
+                               bool braking) {
+#ifdef D_RECORD
+    printf("D,%lu,%.4f,%.4f,%.4f,%.4f,%ld,%d,%d,%d\n",
+           (unsigned long)pros::millis(), left_pos, right_pos, left_vel,
+           right_vel, (long)pros::c::battery_get_voltage(), left_voltage,
+           right_voltage, braking);
+#endif
+}
 
-#ifdef D_DEBUG
-        printf("Left Error: %.2lf\nRight Error: %.2lf\nSettled: %d\n",
-               left_error, right_error, is_settled.load());
-        print_telemetry(E_MOTOR_GROUP_TELEM_PRINT_VOLTAGE,
-                        E_MOTOR_GROUP_TELEM_PRINT_VOLTAGE);
+void Drivetrain::record_motion(const char *type, double amount,
+                               const settle_params_t &params) {
+#ifdef D_RECORD
+    printf("C,%lu,%s,%.4f,", (unsigned long)pros::millis(), type, amount);
+    print_settle_params(params);
+    printf("\n");
 #endif
-        left_prev_error = left_error;
-        right_prev_error = right_error;
-        pros::delay(2);
-    }
+}
+
+void Drivetrain::record_velocity(double left_rpm, double right_rpm) {
+#ifdef D_RECORD
+    printf("V,%lu,%.4f,%.4f\n", (unsigned long)pros::millis(), left_rpm,
+           right_rpm);
+#endif
+}
+
+void Drivetrain::print_settle_params(const settle_params_t &params) {
+    printf("%.4f,%lu,%.4f,%lu,%.4f,%.4f,%lu,%lu", params.small_error,
+           (unsigned long)params.small_time, params.large_error,
+           (unsigned long)params.large_time, params.velocity_band,
+           params.stall_velocity, (unsigned long)params.stall_time,
+           (unsigned long)params.timeout);
 }
 
 void Drivetrain::set_pid_consts(double Pconst, double Iconst, double Dconst) {
@@ -155,25 +301,45 @@ void Drivetrain::set_pid_consts(double Pconst, double Iconst, double Dconst) {
 }
 
 void Drivetrain::move_straight(double inches) {
+    move_straight(inches, default_settle);
+}
+
+void Drivetrain::move_straight(double inches, const settle_params_t &params) {
     double temp = convert_inches_to_degrees(inches);
 
-    reset_pid_state(temp, temp);
+    record_motion("straight", inches, params);
+    send_position("straight", inches, temp, temp, params);
 }
 
-void Drivetrain::turn_angle(double angle) {
+void Drivetrain::turn_angle(double angle) { turn_angle(angle, default_settle); }
+
+void Drivetrain::turn_angle(double angle, const settle_params_t &params) {
 
     // Convert the angle to turn into degrees for the wheels to rotate
     // This consists of 2 parts. First, we turn the angle into the number of
     // inches each side needs to move. Then, we turn that into degrees
     double temp = convert_inches_to_degrees(arc_len(angle, track_distance));
 
-    reset_pid_state(temp, -temp);
+    record_motion("turn", angle, params);
+    send_position("turn", angle, temp, -temp, params);
 }
 
-void Drivetrain::init_pid_task() {
-    pid_task =
-        pros::c::task_create(trampoline, this, TASK_PRIORITY_DEFAULT,
-                             TASK_STACK_DEPTH_DEFAULT, "Drivetrain PID Task");
+void Drivetrain::init_task() {
+#ifdef D_RECORD
+    // The configuration needed to replay the log on a computer. The gear
+    // ratio is often a repeating fraction, and four places of it are enough
+    // to move the targets by a few mV of output.
+    printf("H,drive,%.6f,%.6f,%.6f,%.4f,%.4f,%.4f,%d,", track_distance * 2,
+           tracking_wheel_radius, tracking_wheel_gear_ratio, kP, kI, kD,
+           using_encdrs);
+    print_settle_params(default_settle);
+    printf(",%.1f,%.1f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,"
+           "%.4f\n",
+           left_slew.get_accel_rate(), left_slew.get_decel_rate(), vel_kP,
+           vel_kI, vel_kD, left_ff.kS, left_ff.kV, left_ff.kA, right_ff.kS,
+           right_ff.kV, right_ff.kA, max_velocity, max_accel);
+#endif
+    Subsystem::init_task();
 }
 
 void Drivetrain::set_velo(int left_velo, int right_velo) {
@@ -181,25 +347,103 @@ void Drivetrain::set_velo(int left_velo, int right_velo) {
     right_motors.move_velocity(right_velo);
 }
 
-void Drivetrain::pause_pid_task() { pros::c::task_suspend(pid_task); }
+void Drivetrain::pause_pid_task() {
+    paused = true;
+    suspend_task();
+}
 
-void Drivetrain::resume_pid_task() { pros::c::task_resume(pid_task); }
+void Drivetrain::resume_pid_task() {
+    paused = false;
+    resume_task();
+}
 
 void Drivetrain::end_pid_task() {
-    pros::c::task_delete(pid_task);
+    delete_task();
     left_motors.move(0);
     right_motors.move(0);
 }
 
 void Drivetrain::wait_until_settled() {
-    pros::delay(200);
-    while (!is_settled) {
+    // Velocity control never settles, so there is nothing to wait for
+    if (sent.mode != E_DRIVE_MODE_POSITION)
+        return;
+
+    // Waiting for the seq of the last command, rather than a settled flag,
+    // means the previous motion's result can't be mistaken for this one's
+    uint32_t seq = commands.get_seq();
+    Trace::record(E_TRACE_WAIT_START, seq);
+    while (!is_finished(seq)) {
         pros::delay(2);
     }
     pros::delay(200);
+    Trace::record(E_TRACE_WAIT_END, seq);
 }
 void Drivetrain::set_settled_threshold(double threshold) {
-    settled_threshold = threshold;
+    default_settle.small_error = threshold;
+}
+
+void Drivetrain::set_settle_params(const settle_params_t &params) {
+    default_settle = params;
+}
+
+settle_exit_e_t Drivetrain::get_exit_reason() { return exit_reason; }
+
+uint32_t Drivetrain::get_moving_time() { return moving_time; }
+
+bool Drivetrain::is_finished(uint32_t seq) {
+    // Compared as a difference, so that the seq wrapping around doesn't
+    // matter
+    return (int32_t)(settled_seq - seq) >= 0;
+}
+
+bool Drivetrain::is_motion_done() { return is_finished(commands.get_seq()); }
+
+void Drivetrain::stop_motion() {
+    // A motion of no length starts from where the robot is when the PID task
+    // picks it up, and is recorded like any other
+    if (!is_motion_done())
+        move_straight(0);
+}
+
+double Drivetrain::get_distance_remaining() {
+    uint32_t seq = commands.get_seq();
+    if (is_finished(seq))
+        return 0;
+    // Until the PID task picks the motion up, all of it is left
+    double degrees = started_seq == seq
+                         ? remaining.load()
+                         : fmax(fabs(sent.left_targ), fabs(sent.right_targ));
+    // The inverse of convert_inches_to_degrees
+    return degrees * tracking_wheel_gear_ratio * 3.1415 / 180 *
+           tracking_wheel_radius;
+}
+
+Motion_Metrics &Drivetrain::get_metrics() { return metrics; }
+
+Motor_Group &Drivetrain::get_left_motors() { return left_motors; }
+
+Motor_Group &Drivetrain::get_right_motors() { return right_motors; }
+
+void Drivetrain::snapshot(subsystem_snapshot_t &snap) {
+    snap.state = exit_reason;
+    snap.target = remaining;
+    snap.velocity =
+        (left_motors.get_avg_velocity() + right_motors.get_avg_velocity()) / 2;
+    snap.current = left_motors.get_total_current_draw() +
+                   right_motors.get_total_current_draw();
+}
+
+void Drivetrain::safe_stop() {
+    pause_pid_task();
+    left_motors.move(0);
+    right_motors.move(0);
+}
+
+void Drivetrain::enable(subsystem_mode_e_t mode) {
+    if (mode == E_SUBSYSTEM_AUTONOMOUS)
+        resume_pid_task();
+    else
+        pause_pid_task();
 }
 
 void Drivetrain::set_drivetrain_dimensions(double tw, double twr,
@@ -214,78 +458,163 @@ void Drivetrain::set_voltage_limit(int limit) {
     right_motors.set_voltage_limits(limit);
 }
 
-void Drivetrain::tank_driver(pros::controller_id_e_t controller,
+void Drivetrain::velocity_driver(const controller_snapshot_t &snapshot,
+                                 pros::controller_digital_e_t rev_btn) {
+    int left, right;
+
+    if (snapshot.is_pressed(rev_btn))
+        rev_control = !rev_control;
+
+    if (rev_control) {
+        right = -read_axis(snapshot, pros::E_CONTROLLER_ANALOG_LEFT_Y);
+        left = -read_axis(snapshot, pros::E_CONTROLLER_ANALOG_RIGHT_Y);
+    } else {
+        left = read_axis(snapshot, pros::E_CONTROLLER_ANALOG_LEFT_Y);
+        right = read_axis(snapshot, pros::E_CONTROLLER_ANALOG_RIGHT_Y);
+    }
+
+    // The curves give mV, so full stick is INPUT_CURVE_MAX_OUTPUT
+    set_velocity_targets(left * max_velocity / INPUT_CURVE_MAX_OUTPUT,
+                         right * max_velocity / INPUT_CURVE_MAX_OUTPUT);
+}
+
+void Drivetrain::set_velocity_targets(double left_rpm, double right_rpm) {
+    // The driver functions call this every loop, so only changes are sent
+    if (sent.mode == E_DRIVE_MODE_VELOCITY && sent.left_vel == left_rpm &&
+        sent.right_vel == right_rpm && !paused)
+        return;
+
+    drive_command_t new_command = {};
+    new_command.mode = E_DRIVE_MODE_VELOCITY;
+    new_command.left_vel = left_rpm;
+    new_command.right_vel = right_rpm;
+    record_velocity(left_rpm, right_rpm);
+    send_command(new_command);
+}
+
+void Drivetrain::set_velocity_consts(const drive_feedforward_t &left_ff,
+                                     const drive_feedforward_t &right_ff,
+                                     double kP, double kI, double kD,
+                                     double max_velocity, double max_accel) {
+    this->left_ff = left_ff;
+    this->right_ff = right_ff;
+    vel_kP = kP;
+    vel_kI = kI;
+    vel_kD = kD;
+    this->max_velocity = max_velocity;
+    this->max_accel = max_accel;
+}
+
+void Drivetrain::set_input_curve(pros::controller_analog_e_t axis,
+                                 const Input_Curve &curve) {
+    axis_curves[axis] = curve;
+}
+
+void Drivetrain::set_slew_rates(double accel, double decel) {
+    left_slew.set_rates(accel, decel);
+    right_slew.set_rates(accel, decel);
+}
+
+bool Drivetrain::characterize(Sysid &sysid, const char *path,
+                              double max_inches) {
+    bool was_paused = paused;
+    suspend_task();
+    sysid.set_travel_limit(convert_inches_to_degrees(max_inches));
+
+    Motor_Group *groups[] = {&left_motors, &right_motors};
+    const char *names[] = {"drive_left", "drive_right"};
+    const sysid_test_e_t tests[] = {
+        E_SYSID_QUASISTATIC_FWD, E_SYSID_QUASISTATIC_REV, E_SYSID_DYNAMIC_FWD,
+        E_SYSID_DYNAMIC_REV};
+
+    bool saved = true;
+    for (sysid_test_e_t test : tests) {
+        sysid.run_test(test, groups, names, 2);
+        // Saving after each test keeps the buffer from filling up, and gives
+        // the robot time to come to a stop before the next test
+        saved &= sysid.save(path);
+        pros::delay(1000);
+    }
+
+    sysid.set_travel_limit(0);
+
+    // The tests bypass the output stage, and leave the motors braked
+    left_slew.reset();
+    right_slew.reset();
+    if (!was_paused)
+        resume_task();
+    return saved;
+}
+
+void Drivetrain::tank_driver(const controller_snapshot_t &snapshot,
                              pros::controller_digital_e_t rev_btn) {
 
-    if (pros::c::controller_get_digital_new_press(controller, rev_btn))
+    int left_voltage, right_voltage;
+
+    if (snapshot.is_pressed(rev_btn))
         rev_control = !rev_control;
 
     if (rev_control) {
-        right_motors.move(-pros::c::controller_get_analog(
-            controller, pros::E_CONTROLLER_ANALOG_LEFT_Y));
-        left_motors.move(-pros::c::controller_get_analog(
-            controller, pros::E_CONTROLLER_ANALOG_RIGHT_Y));
+        right_voltage =
+            -read_axis(snapshot, pros::E_CONTROLLER_ANALOG_LEFT_Y);
+        left_voltage =
+            -read_axis(snapshot, pros::E_CONTROLLER_ANALOG_RIGHT_Y);
     } else {
-        left_motors.move(pros::c::controller_get_analog(
-            controller, pros::E_CONTROLLER_ANALOG_LEFT_Y));
-        right_motors.move(pros::c::controller_get_analog(
-            controller, pros::E_CONTROLLER_ANALOG_RIGHT_Y));
+        left_voltage = read_axis(snapshot, pros::E_CONTROLLER_ANALOG_LEFT_Y);
+        right_voltage =
+            read_axis(snapshot, pros::E_CONTROLLER_ANALOG_RIGHT_Y);
     }
+    output_voltage(left_voltage, right_voltage, pros::millis());
 }
 
-void Drivetrain::tank_driver_poly(pros::controller_id_e_t controller,
+void Drivetrain::tank_driver_poly(const controller_snapshot_t &snapshot,
                                   double pow,
                                   pros::controller_digital_e_t rev_btn) {
 
     int left, right;
 
-    if (pros::c::controller_get_digital_new_press(controller, rev_btn))
+    if (snapshot.is_pressed(rev_btn))
         rev_control = !rev_control;
 
     if (rev_control) {
-        right = -pros::c::controller_get_analog(
-            controller, pros::E_CONTROLLER_ANALOG_LEFT_Y);
-        left = -pros::c::controller_get_analog(
-            controller, pros::E_CONTROLLER_ANALOG_RIGHT_Y);
+        right = -snapshot.get_analog(pros::E_CONTROLLER_ANALOG_LEFT_Y);
+        left = -snapshot.get_analog(pros::E_CONTROLLER_ANALOG_RIGHT_Y);
     } else {
-        left = pros::c::controller_get_analog(controller,
-                                              pros::E_CONTROLLER_ANALOG_LEFT_Y);
-        right = pros::c::controller_get_analog(
-            controller, pros::E_CONTROLLER_ANALOG_RIGHT_Y);
+        left = snapshot.get_analog(pros::E_CONTROLLER_ANALOG_LEFT_Y);
+        right = snapshot.get_analog(pros::E_CONTROLLER_ANALOG_RIGHT_Y);
     }
-    // We subtract 1 from pow since we multiply by the initial value - thus
-    // restoring the original range
-    left_motors.move(left * std::pow((std::abs(left) / 127.0), pow - 1));
-    right_motors.move(right * std::pow((std::abs(right) / 127.0), pow - 1));
+
+    if (pow != poly_curve_power) {
+        poly_curve = Input_Curve::poly(pow);
+        poly_curve_power = pow;
+    }
+    int left_voltage = poly_curve.apply(left);
+    int right_voltage = poly_curve.apply(right);
+    output_voltage(left_voltage, right_voltage, pros::millis());
 }
 
-void Drivetrain::arcade_driver(pros::controller_id_e_t controller,
+void Drivetrain::arcade_driver(const controller_snapshot_t &snapshot,
                                pros::controller_digital_e_t rev_btn,
                                bool use_right) {
     int power;
     int turn;
     if (use_right) {
-        power = pros::c::controller_get_analog(
-            controller, pros::E_CONTROLLER_ANALOG_RIGHT_Y);
-        turn = pros::c::controller_get_analog(
-            controller, pros::E_CONTROLLER_ANALOG_RIGHT_X);
+        power = read_axis(snapshot, pros::E_CONTROLLER_ANALOG_RIGHT_Y);
+        turn = read_axis(snapshot, pros::E_CONTROLLER_ANALOG_RIGHT_X);
     } else {
-        power = pros::c::controller_get_analog(
-            controller, pros::E_CONTROLLER_ANALOG_LEFT_Y);
-        turn = pros::c::controller_get_analog(controller,
-                                              pros::E_CONTROLLER_ANALOG_LEFT_X);
+        power = read_axis(snapshot, pros::E_CONTROLLER_ANALOG_LEFT_Y);
+        turn = read_axis(snapshot, pros::E_CONTROLLER_ANALOG_LEFT_X);
     }
 
-    if (pros::c::controller_get_digital_new_press(controller, rev_btn))
+    if (snapshot.is_pressed(rev_btn))
         rev_control = !rev_control;
 
-    if (rev_control) {
-        left_motors.move(-power + turn);
-        right_motors.move(-power - turn);
-    } else {
-        left_motors.move(power + turn);
-        right_motors.move(power - turn);
-    }
+    if (rev_control)
+        power = -power;
+
+    int left_voltage = power + turn;
+    int right_voltage = power - turn;
+    output_voltage(left_voltage, right_voltage, pros::millis());
 }
 
 void Drivetrain::print_telemetry(uint8_t left_vals, uint8_t right_vals) {
@@ -302,23 +631,29 @@ void Drivetrain::print_telemetry(uint8_t left_vals, uint8_t right_vals) {
     printf("\n");
 }
 
-void Drivetrain::reset_pid_state(double new_left_targ, double new_right_targ) {
-    pros::c::task_suspend(pid_task);
-
-    reset_pid_vars = true;
-
-    // Reset the encoder positions
-    if (using_encdrs) {
-        pros::c::adi_encoder_reset(left_encdr);
-        pros::c::adi_encoder_reset(right_encdr);
-    } else {
-        left_motors.reset_positions();
-        right_motors.reset_positions();
-    }
-
-    // Update targets
-    left_targ = new_left_targ;
-    right_targ = new_right_targ;
+void Drivetrain::send_command(const drive_command_t &new_command) {
+    // The Seqlock only takes one writer at a time
+    while (send_lock.test_and_set(std::memory_order_acquire))
+        pros::delay(1);
+    commands.write(new_command);
+    sent = new_command;
+    send_lock.clear(std::memory_order_release);
+    if (paused)
+        resume_pid_task();
+}
 
-    pros::c::task_resume(pid_task);
+void Drivetrain::send_position(const char *type, double amount,
+                               double left_targ, double right_targ,
+                               const settle_params_t &params) {
+    drive_command_t new_command = {};
+    new_command.mode = E_DRIVE_MODE_POSITION;
+    new_command.left_targ = left_targ;
+    new_command.right_targ = right_targ;
+    new_command.kP = kP;
+    new_command.kI = kI;
+    new_command.kD = kD;
+    new_command.settle = params;
+    new_command.type = type;
+    new_command.amount = amount;
+    send_command(new_command);
 }
\ No newline at end of file
@@ -2,9 +2,13 @@
 #include <cmath>
 #include <cstdio>
 
+// How often the controller runs, in ms
+#define FLYWHEEL_PERIOD 2
+
 Flywheel::Flywheel(std::initializer_list<int> ports,
                    std::initializer_list<bool> reverses)
-    : motors(ports, reverses) {
+    : Subsystem("flywheel", "Flywheel PID Task", FLYWHEEL_PERIOD),
+      motors(ports, reverses) {
     motors.set_encoder_units(pros::E_MOTOR_ENCODER_DEGREES);
     /**
      * The motor uses a 3D-printed replacement for the gear cartridge to
@@ -18,66 +22,72 @@ Flywheel::Flywheel(std::initializer_list<int> ports,
     motors.set_brake_mode(pros::E_MOTOR_BRAKE_COAST);
 }
 
-void Flywheel::task_fn() {
-    const int TIME_DELAY = 2;
-
-    double error = 0;
-    double prev_error = 0;
-    int voltage = 0;
+uint32_t Flywheel::tick(uint32_t now) {
+    int get_velo = velocity; // read the atomic once, so that every term
+                             // uses the same target
+    double measured = motors.get_avg_velocity();
+    measured_velo = measured;
 
-    while (true) {
-        error = velocity - motors.get_avg_velocity();
+    double error = get_velo - measured;
 
-        int get_velo = velocity; // have to extract value of velocity, as
-                                 // std::signbit doesn't accept atomic variables
+    // kS opposes friction, so it takes the sign of the target velocity.
+    // std::signbit can't be used here, as it is true for negative values.
+    int sign = (get_velo > 0) - (get_velo < 0);
 
-        double derivative = (error - prev_error) / TIME_DELAY;
+    double derivative = (error - prev_error) / FLYWHEEL_PERIOD;
 
-        voltage = kS * std::signbit(get_velo) + kV * velocity +
-                  kD * derivative + kP * error;
+    int voltage = kS * sign + kV * get_velo + kD * derivative + kP * error;
 
-        if (fabs(voltage) > 12000)
-            voltage = copysign(12000, voltage);
+    if (fabs(voltage) > 12000)
+        voltage = copysign(12000, voltage);
 #ifdef F_DEBUG
-        printf("Flywheel error: %.2lf\n", error);
-        print_telemetry(E_MOTOR_GROUP_TELEM_PRINT_VOLTAGE |
-                        E_MOTOR_GROUP_TELEM_PRINT_CURRENT |
-                        E_MOTOR_GROUP_TELEM_PRINT_TEMPERATURE |
-                        E_MOTOR_GROUP_TELEM_PRINT_VELOCITY);
+    printf("Flywheel error: %.2lf\n", error);
+    print_telemetry(E_MOTOR_GROUP_TELEM_PRINT_VOLTAGE |
+                    E_MOTOR_GROUP_TELEM_PRINT_CURRENT |
+                    E_MOTOR_GROUP_TELEM_PRINT_TEMPERATURE |
+                    E_MOTOR_GROUP_TELEM_PRINT_VELOCITY);
 #endif
-        motors.move_voltage(voltage);
-        pros::delay(TIME_DELAY);
-
-        prev_error = error;
-    }
-}
-
-void Flywheel::trampoline(void *param) {
-    if (param) {
-        Flywheel *that = static_cast<Flywheel *>(param);
-        that->task_fn();
-    }
+    motors.move_voltage(voltage);
+#ifdef F_RECORD
+    // One line of the replay log, see sim/README.md
+    printf("F,%lu,%.4f,%d,%ld,%d\n", (unsigned long)now, measured, get_velo,
+           (long)pros::c::battery_get_voltage(), voltage);
+#endif
+    prev_error = error;
+    return FLYWHEEL_PERIOD;
 }
 
 void Flywheel::init_task() {
-    task = pros::c::task_create(trampoline, this, TASK_PRIORITY_DEFAULT,
-                                TASK_STACK_DEPTH_DEFAULT, "Flywheel PID Task");
+#ifdef F_RECORD
+    printf("H,flywheel,%.4f,%.4f,%.4f,%.4f\n", kS, kV, kP, kD);
+#endif
+    Subsystem::init_task();
 }
 
 void Flywheel::pause_task() {
-    pros::c::task_suspend(task);
+    paused = true;
+    suspend_task();
     stop();
 }
 
-void Flywheel::resume_task() { pros::c::task_resume(task); }
+void Flywheel::resume_task() {
+    paused = false;
+    Subsystem::resume_task();
+}
 
 void Flywheel::end_task() {
     pause_task();
-    pros::c::task_delete(task);
+    delete_task();
 }
 
 void Flywheel::set_target_velo(int velo) { velocity = velo; }
 
+bool Flywheel::is_at_speed(double tolerance) {
+    return std::fabs(measured_velo - velocity) <= tolerance;
+}
+
+double Flywheel::get_measured_velo() { return measured_velo; }
+
 void Flywheel::set_consts(double kS, double kV, double kP, double kD) {
     this->kS = kS;
     this->kV = kV;
@@ -89,22 +99,20 @@ void Flywheel::set_speed_fast() { set_target_velo(FLYWHEEL_FAST_TARG); }
 
 void Flywheel::set_speed_slow() { set_target_velo(FLYWHEEL_SLOW_TARG); }
 
-void Flywheel::driver(pros::controller_id_e_t controller,
+void Flywheel::driver(const controller_snapshot_t &snapshot,
                       pros::controller_digital_e_t pwr_button,
                       pros::controller_digital_e_t spd_button) {
-    static bool running = false;
-    static bool slow = false;
-    if (pros::c::controller_get_digital_new_press(controller, pwr_button)) {
-        running = !running; // Toggle flywheel status
-        if (running)
+    if (snapshot.is_pressed(pwr_button)) {
+        driver_running = !driver_running; // Toggle flywheel status
+        if (driver_running)
             resume_task();
         else
             pause_task();
     }
 
-    if (pros::c::controller_get_digital_new_press(controller, spd_button)) {
-        slow = !slow; // Toggle flywheel status
-        if (slow) {
+    if (snapshot.is_pressed(spd_button)) {
+        driver_slow = !driver_slow; // Toggle flywheel status
+        if (driver_slow) {
             set_speed_slow();
         } else {
             set_speed_fast();
@@ -120,7 +128,39 @@ void Flywheel::set_voltage(int32_t voltage) { motors.move_voltage(voltage); }
 
 void Flywheel::stop() { motors.brake(); }
 
+bool Flywheel::characterize(Sysid &sysid, const char *path) {
+    bool was_paused = paused;
+    pause_task();
+
+    Motor_Group *groups[] = {&motors};
+    const char *names[] = {"flywheel"};
+
+    bool saved = true;
+    for (sysid_test_e_t test : {E_SYSID_QUASISTATIC_FWD, E_SYSID_DYNAMIC_FWD}) {
+        sysid.run_test(test, groups, names, 1);
+        saved &= sysid.save(path);
+        // The flywheel coasts, so give it time to spin down completely
+        pros::delay(5000);
+    }
+    if (!was_paused)
+        resume_task();
+    return saved;
+}
+
 void Flywheel::print_telemetry(uint8_t vals_to_print) {
     // printf("Flywheel Telemetry\n");
     motors.print_telemetry(vals_to_print);
 }
+
+Motor_Group &Flywheel::get_motors() { return motors; }
+
+void Flywheel::snapshot(subsystem_snapshot_t &snap) {
+    snap.state = !paused;
+    snap.target = velocity;
+    snap.velocity = measured_velo;
+    snap.current = motors.get_total_current_draw();
+}
+
+void Flywheel::safe_stop() { pause_task(); }
+
+void Flywheel::enable(subsystem_mode_e_t mode) { resume_task(); }
@@ -0,0 +1,228 @@
+#include "Health_Monitor.hpp"
+#include "api.h"
+
+#include <cmath>
+#include <cstdio>
+
+// Returns the name of a single condition, for the log
+static const char *condition_name(motor_health_e_t condition) {
+    switch (condition) {
+    case E_MOTOR_HEALTH_WARM:
+        return "warm";
+    case E_MOTOR_HEALTH_HOT:
+        return "hot";
+    case E_MOTOR_HEALTH_STALLED:
+        return "stalled";
+    case E_MOTOR_HEALTH_OUTLIER:
+        return "outlier";
+    case E_MOTOR_HEALTH_DISCONNECTED:
+        return "disconnected";
+    case E_MOTOR_HEALTH_DISAGREE:
+        return "disagree";
+    default:
+        return "ok";
+    }
+}
+
+// Returns whether a condition has held for the given time, starting the
+// timer if it has only just started
+static bool held_for(bool active, uint32_t &start, uint32_t now,
+                     uint32_t time) {
+    if (!active) {
+        start = 0;
+        return false;
+    }
+    if (start == 0)
+        start = now;
+    return now - start >= time;
+}
+
+Health_Monitor::Health_Monitor()
+    : Subsystem("health", "Health Monitor Task", HEALTH_MONITOR_PERIOD,
+                TASK_PRIORITY_DEFAULT - 1) {}
+
+bool Health_Monitor::add_group(const char *name, Motor_Group *motors) {
+    if (group_count >= HEALTH_MONITOR_MAX_GROUPS)
+        return false;
+    groups[group_count] = {};
+    groups[group_count].name = name;
+    groups[group_count].motors = motors;
+    ++group_count;
+    return true;
+}
+
+uint32_t Health_Monitor::tick(uint32_t now) {
+    for (size_t i = 0; i < group_count; ++i)
+        check(groups[i], now);
+    return HEALTH_MONITOR_PERIOD;
+}
+
+void Health_Monitor::check(health_group_t &group, uint32_t now) {
+    size_t count = group.motors->size();
+    if (count > MOTOR_GROUP_MAX_MOTORS)
+        count = MOTOR_GROUP_MAX_MOTORS;
+
+    double velocities[MOTOR_GROUP_MAX_MOTORS];
+    bool connected[MOTOR_GROUP_MAX_MOTORS];
+    double sorted[MOTOR_GROUP_MAX_MOTORS];
+    size_t connected_count = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        motor_health_t &health = group.health[i];
+        int port = group.motors->get_port(i);
+
+        double temperature = pros::c::motor_get_temperature(port);
+        double velocity = pros::c::motor_get_actual_velocity(port);
+        int32_t voltage = pros::c::motor_get_voltage(port);
+        connected[i] = temperature != PROS_ERR_F && velocity != PROS_ERR_F &&
+                       voltage != PROS_ERR;
+        set_condition(group, i, E_MOTOR_HEALTH_DISCONNECTED, !connected[i],
+                      now);
+        if (!connected[i])
+            continue;
+
+        velocities[i] = velocity;
+        sorted[connected_count++] = velocity;
+
+        bool hot = pros::c::motor_is_over_temp(port) == 1 ||
+                   temperature >= HOT_TEMP ||
+                   ((health.conditions & E_MOTOR_HEALTH_HOT) &&
+                    temperature > HOT_TEMP - TEMP_HYSTERESIS);
+        bool warm = temperature >= WARM_TEMP ||
+                    ((health.conditions & E_MOTOR_HEALTH_WARM) &&
+                     temperature > WARM_TEMP - TEMP_HYSTERESIS);
+        set_condition(group, i, E_MOTOR_HEALTH_HOT, hot, now);
+        set_condition(group, i, E_MOTOR_HEALTH_WARM, warm && !hot, now);
+
+        // The voltage read back has already been derated, so the threshold
+        // is too, or derating a stalled motor would clear its stall
+        int stall_voltage =
+            STALL_VOLTAGE * (100 - group.motors->get_motor_derate(i)) / 100;
+        bool stalling = std::abs(voltage) >= stall_voltage &&
+                        std::fabs(velocity) < STALL_VELOCITY;
+        set_condition(group, i, E_MOTOR_HEALTH_STALLED,
+                      held_for(stalling, health.stall_start, now, STALL_TIME),
+                      now);
+    }
+
+    if (connected_count >= 3) {
+        // The median of three or more is unaffected by one bad motor
+        for (size_t i = 1; i < connected_count; ++i)
+            for (size_t j = i; j > 0 && sorted[j - 1] > sorted[j]; --j) {
+                double tmp = sorted[j - 1];
+                sorted[j - 1] = sorted[j];
+                sorted[j] = tmp;
+            }
+        double median = connected_count % 2
+                            ? sorted[connected_count / 2]
+                            : (sorted[connected_count / 2 - 1] +
+                               sorted[connected_count / 2]) /
+                                  2;
+        double threshold = std::fmax(OUTLIER_VELOCITY,
+                                     OUTLIER_FRACTION * std::fabs(median));
+
+        for (size_t i = 0; i < count; ++i) {
+            bool far = connected[i] &&
+                       std::fabs(velocities[i] - median) > threshold;
+            set_condition(group, i, E_MOTOR_HEALTH_OUTLIER,
+                          held_for(far, group.health[i].outlier_start, now,
+                                   OUTLIER_TIME),
+                          now);
+        }
+    } else if (count == 2 && connected_count == 2) {
+        double mean = (velocities[0] + velocities[1]) / 2;
+        double threshold =
+            std::fmax(OUTLIER_VELOCITY, OUTLIER_FRACTION * std::fabs(mean));
+        bool far = std::fabs(velocities[0] - velocities[1]) > threshold;
+        bool disagree =
+            held_for(far, group.health[0].outlier_start, now, OUTLIER_TIME);
+        set_condition(group, 0, E_MOTOR_HEALTH_DISAGREE, disagree, now);
+        set_condition(group, 1, E_MOTOR_HEALTH_DISAGREE, disagree, now);
+    } else {
+        // Too few motors to compare, e.g. after a disconnect
+        for (size_t i = 0; i < count; ++i) {
+            group.health[i].outlier_start = 0;
+            set_condition(group, i, E_MOTOR_HEALTH_OUTLIER, false, now);
+            set_condition(group, i, E_MOTOR_HEALTH_DISAGREE, false, now);
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        apply(group, i);
+}
+
+void Health_Monitor::set_condition(health_group_t &group, size_t index,
+                                   motor_health_e_t condition, bool active,
+                                   uint32_t now) {
+    uint8_t &conditions = group.health[index].conditions;
+    if (((conditions & condition) != 0) == active)
+        return;
+
+    if (active)
+        conditions |= condition;
+    else
+        conditions &= ~condition;
+
+    printf("M,%lu,%s,%s,%d,%s\n", (unsigned long)now,
+           active ? "raise" : "clear", group.name,
+           group.motors->get_port(index), condition_name(condition));
+    if (active && rumble)
+        pros::c::controller_rumble(pros::E_CONTROLLER_MASTER, "-");
+}
+
+void Health_Monitor::apply(health_group_t &group, size_t index) {
+    uint8_t conditions = group.health[index].conditions;
+
+    int derate = 0;
+    if (conditions & E_MOTOR_HEALTH_DISCONNECTED)
+        derate = 100;
+    if ((conditions & E_MOTOR_HEALTH_WARM) && derate < WARM_DERATE)
+        derate = WARM_DERATE;
+    if ((conditions & E_MOTOR_HEALTH_HOT) && derate < HOT_DERATE)
+        derate = HOT_DERATE;
+    if ((conditions & E_MOTOR_HEALTH_STALLED) && derate < STALL_DERATE)
+        derate = STALL_DERATE;
+
+    group.motors->set_motor_derate(index, derate);
+    group.motors->set_motor_ignored(
+        index,
+        conditions & (E_MOTOR_HEALTH_OUTLIER | E_MOTOR_HEALTH_DISCONNECTED));
+}
+
+void Health_Monitor::set_rumble(bool rumble) { this->rumble = rumble; }
+
+uint8_t Health_Monitor::get_conditions(size_t group, size_t index) {
+    if (group >= group_count || index >= MOTOR_GROUP_MAX_MOTORS)
+        return E_MOTOR_HEALTH_OK;
+    return groups[group].health[index].conditions;
+}
+
+void Health_Monitor::snapshot(subsystem_snapshot_t &snap) {
+    for (size_t g = 0; g < group_count; ++g)
+        for (size_t i = 0; i < MOTOR_GROUP_MAX_MOTORS; ++i)
+            snap.state |= groups[g].health[i].conditions;
+}
+
+void Health_Monitor::safe_stop() {}
+
+void Health_Monitor::print_status() {
+    for (size_t g = 0; g < group_count; ++g) {
+        health_group_t &group = groups[g];
+        size_t count = group.motors->size();
+        if (count > MOTOR_GROUP_MAX_MOTORS)
+            count = MOTOR_GROUP_MAX_MOTORS;
+
+        for (size_t i = 0; i < count; ++i) {
+            int port = group.motors->get_port(i);
+            printf("%s port %d: %.0f C, derate %d%%%s", group.name, port,
+                   pros::c::motor_get_temperature(port),
+                   group.motors->get_motor_derate(i),
+                   group.motors->is_motor_ignored(i) ? ", ignored" : "");
+            for (uint8_t bit = E_MOTOR_HEALTH_WARM;
+                 bit <= E_MOTOR_HEALTH_DISAGREE; bit <<= 1)
+                if (group.health[i].conditions & bit)
+                    printf(", %s", condition_name((motor_health_e_t)bit));
+            printf("\n");
+        }
+    }
+}
@@ -1,11 +1,22 @@
 #include "Indexer.hpp"
+#include "Trace.hpp"
 
-#define INDEXER_VELO 200
-#define INDEXER_ROTATION 720
+#include <cmath>
+#include <cstdio>
+
+// How often the state machine runs, in ms
+#define INDEXER_PERIOD 10
+
+// How close the gear must be to the end of its turn for the shot to count as
+// fired, in degrees, and how slowly it must be turning to count as at rest, in
+// RPM
+#define INDEXER_POSITION_TOLERANCE 15
+#define INDEXER_REST_VELOCITY 5
 
 Indexer::Indexer(std::initializer_list<int> ports,
                  std::initializer_list<bool> revs)
-    : motors(ports, revs) {
+    : Subsystem("indexer", "Indexer Task", INDEXER_PERIOD),
+      motors(ports, revs) {
     motors.set_encoder_units(pros::E_MOTOR_ENCODER_DEGREES);
     motors.set_gearing(pros::E_MOTOR_GEAR_GREEN);
 }
@@ -14,19 +25,151 @@ void Indexer::set_rotation(int degrees_to_rotate) {
     this->degrees_to_rotate = degrees_to_rotate;
 }
 
-void Indexer::punch_disk() {
+uint32_t Indexer::tick(uint32_t now) {
+    if (cancelled.exchange(false)) {
+        // A shot already firing is let finish, and the rest dropped after it
+        if (state == E_INDEXER_FIRING || state == E_INDEXER_RETURNING)
+            shots_left = 1;
+        else
+            shots_left = 0;
+    }
+
+    switch (state) {
+    case E_INDEXER_IDLE:
+        if (shots_left <= 0)
+            break;
+        burst_shots = 0;
+        wait_start = now;
+        state = E_INDEXER_READY;
+        [[fallthrough]];
+    case E_INDEXER_READY:
+        if (shots_left <= 0)
+            state = E_INDEXER_IDLE; // Cancelled
+        else if (gate_open(now))
+            start_shot(now);
+        break;
+    case E_INDEXER_FIRING:
+        if (motors.get_avg_position() >=
+            degrees_to_rotate - INDEXER_POSITION_TOLERANCE)
+            state = E_INDEXER_RETURNING;
+        else if (now - shot_start >= INDEXER_PUNCH_TIMEOUT)
+            end_shot(now, true);
+        break;
+    case E_INDEXER_RETURNING:
+        if (fabs(motors.get_avg_velocity()) < INDEXER_REST_VELOCITY)
+            end_shot(now);
+        else if (now - shot_start >= INDEXER_PUNCH_TIMEOUT)
+            end_shot(now, true);
+        break;
+    }
+    return INDEXER_PERIOD;
+}
+
+bool Indexer::gate_open(uint32_t now) {
+    if (burst_shots > 0 && now - last_start < gate.min_interval)
+        return false;
+    if (!gate.ready || gate.ready())
+        return true;
+    return gate.max_wait && now - wait_start >= gate.max_wait;
+}
+
+void Indexer::start_shot(uint32_t now) {
+    if (burst_shots == 0) {
+        burst_start = now;
+        min_interval = 0;
+        max_interval = 0;
+    } else {
+        uint32_t interval = now - last_start;
+        last_interval = interval;
+        if (burst_shots == 1 || interval < min_interval)
+            min_interval = interval;
+        if (interval > max_interval)
+            max_interval = interval;
+    }
+    last_start = now;
+    shot_start = now;
+
+    Trace::record(E_TRACE_PUNCH_START);
     motors.reset_positions();
-    motors.move_relative(INDEXER_ROTATION, INDEXER_VELO);
-    pros::delay(2250);
+    motors.move_relative(degrees_to_rotate, INDEXER_VELO);
+    state = E_INDEXER_FIRING;
+}
+
+void Indexer::end_shot(uint32_t now, bool timed_out) {
+    Trace::record(E_TRACE_PUNCH_END, timed_out);
+    ++burst_shots;
+    if (--shots_left > 0) {
+        wait_start = now;
+        state = E_INDEXER_READY;
+        return;
+    }
+
+    shots_left = 0;
+    state = E_INDEXER_IDLE;
+    if (burst_shots > 1)
+        printf("Indexer fired %d shots in %lu ms, fire-to-fire %lu ms avg, "
+               "%lu min, %lu max\n",
+               burst_shots, (unsigned long)(now - burst_start),
+               (unsigned long)((last_start - burst_start) /
+                               (burst_shots - 1)),
+               (unsigned long)min_interval, (unsigned long)max_interval);
+}
+
+void Indexer::set_gate(const indexer_gate_t &gate) { this->gate = gate; }
+
+void Indexer::fire(int shots) {
+    if (shots > 0) {
+        cancelled = false;
+        shots_left += shots;
+    }
+}
+
+void Indexer::cancel() { cancelled = true; }
+
+bool Indexer::is_done() { return shots_left <= 0; }
+
+void Indexer::wait_until_done() {
+    while (!is_done())
+        pros::delay(INDEXER_PERIOD);
+}
+
+void Indexer::punch_disk() {
+    fire(1);
+    wait_until_done();
 }
 
-void Indexer::driver(pros::controller_id_e_t controller,
+void Indexer::start_punch() { fire(1); }
+
+bool Indexer::is_punch_done() { return is_done(); }
+
+indexer_state_e_t Indexer::get_state() { return state; }
+
+uint32_t Indexer::get_last_interval() { return last_interval; }
+
+void Indexer::driver(const controller_snapshot_t &snapshot,
                      pros::controller_digital_e_t fire_btn,
                      pros::controller_digital_e_t pullback_btn) {
-    if (pros::c::controller_get_digital(controller, fire_btn))
+    if (!is_done())
+        return;
+    if (snapshot.is_held(fire_btn))
         motors.move_velocity(INDEXER_VELO);
-    else if (pros::c::controller_get_digital(controller, pullback_btn))
+    else if (snapshot.is_held(pullback_btn))
         motors.move_velocity(-INDEXER_VELO);
     else
         motors.move(0);
-}
\ No newline at end of file
+}
+
+Motor_Group &Indexer::get_motors() { return motors; }
+
+void Indexer::snapshot(subsystem_snapshot_t &snap) {
+    snap.state = state;
+    snap.target = shots_left;
+    snap.velocity = motors.get_avg_velocity();
+    snap.current = motors.get_total_current_draw();
+}
+
+void Indexer::safe_stop() {
+    shots_left = 0;
+    state = E_INDEXER_IDLE;
+    motors.move(0);
+}
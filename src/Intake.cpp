@@ -3,39 +3,178 @@
  */
 
 #include "Intake.hpp"
+#include "Trace.hpp"
+
+#include <cmath>
+#include <cstdio>
 #include <initializer_list>
 
+// How often the task runs, in ms
+#define INTAKE_PERIOD 10
+
+// The directions asked for by turn_degree while it moves and once it has got
+// there, in which the task leaves the motors alone
+#define INTAKE_MOVE 2
+#define INTAKE_HOLD 3
+
+// How long turn_degree waits for the task to let go of the motors, in ms
+#define INTAKE_HANDOFF_TIMEOUT (INTAKE_PERIOD * 5)
+
 Intake::Intake(std::initializer_list<int> ports,
                std::initializer_list<bool> reverses)
-    : motors(ports, reverses) {
+    : Subsystem("intake", "Intake Task", INTAKE_PERIOD),
+      motors(ports, reverses) {
     motors.set_encoder_units(pros::E_MOTOR_ENCODER_DEGREES);
 }
 
-void Intake::driver(pros::controller_id_e_t controller,
+void Intake::driver(const controller_snapshot_t &snapshot,
                     pros::controller_digital_e_t in_button,
                     pros::controller_digital_e_t out_button) {
-    if (pros::c::controller_get_digital(controller, in_button))
+    if (snapshot.is_held(in_button))
         in();
-    else if (pros::c::controller_get_digital(controller, out_button))
+    else if (snapshot.is_held(out_button))
         out();
     else
         stop();
 }
 
-void Intake::in() { motors.move(127); }
+uint32_t Intake::tick(uint32_t now) {
+    int dir = direction;
+    if (dir != applied)
+        apply(dir, now);
+    else
+        watch_jam(now);
+    return INTAKE_PERIOD;
+}
 
-void Intake::out() { motors.move(-127); }
+void Intake::apply(int dir, uint32_t now) {
+    applied = dir;
+    attempts = 0;
+    stall_start = 0;
+    run_start = now;
+    switch (dir) {
+    case 1:
+        motors.move(127);
+        state = E_INTAKE_IN;
+        break;
+    case -1:
+        motors.move(-127);
+        state = E_INTAKE_OUT;
+        break;
+    case INTAKE_MOVE:
+        state = E_INTAKE_MOVING;
+        break;
+    case INTAKE_HOLD:
+        // The motors are left holding the position move_relative reached
+        state = E_INTAKE_HOLDING;
+        break;
+    default:
+        motors.move_velocity(0);
+        state = E_INTAKE_STOPPED;
+        break;
+    }
+}
+
+void Intake::watch_jam(uint32_t now) {
+    if (state == E_INTAKE_CLEARING) {
+        if (now - clear_start >= reverse_time) {
+            motors.move(127);
+            run_start = now;
+            stall_start = 0;
+            state = E_INTAKE_IN;
+        }
+        return;
+    }
+    if (state != E_INTAKE_IN || now - run_start < JAM_SETTLE)
+        return;
+
+    bool stalling = fabs(motors.get_avg_velocity()) < JAM_VELOCITY &&
+                    motors.get_total_current_draw() > JAM_CURRENT;
+    if (!stalling) {
+        stall_start = 0;
+        if (attempts > 0 && now - run_start >= JAM_RESET)
+            attempts = 0;
+        return;
+    }
+    if (stall_start == 0)
+        stall_start = now;
+    if (now - stall_start < JAM_TIME)
+        return;
+
+    ++jams;
+    ++attempts;
+    Trace::record(E_TRACE_JAM, attempts);
+    if (attempts > max_attempts) {
+        printf("Intake jammed, gave up after %d attempts\n", max_attempts);
+        motors.move_velocity(0);
+        state = E_INTAKE_JAMMED;
+        return;
+    }
+    printf("Intake jammed, reversing (attempt %d of %d)\n", attempts,
+           max_attempts);
+    motors.move(-127);
+    clear_start = now;
+    state = E_INTAKE_CLEARING;
+}
+
+void Intake::set_jam_handling(uint32_t reverse_time, int attempts) {
+    this->reverse_time = reverse_time;
+    max_attempts = attempts;
+}
 
-void Intake::stop() { motors.move_velocity(0); }
+void Intake::in() { direction = 1; }
 
-void Intake::turn_degree(double degrees) {
+void Intake::out() { direction = -1; }
+
+void Intake::stop() { direction = 0; }
+
+bool Intake::turn_degree(double degrees, uint32_t timeout) {
+    // Keeps the task from driving the motors, and waits for it to let go of
+    // them
+    uint32_t start = pros::millis();
+    direction = INTAKE_MOVE;
+    while (state != E_INTAKE_MOVING &&
+           pros::millis() - start < INTAKE_HANDOFF_TIMEOUT)
+        pros::delay(INTAKE_PERIOD);
+
+    start = pros::millis();
     motors.reset_positions();
     motors.move_relative(degrees, 200);
-    while (!(fabs(motors.get_avg_position()) >= fabs(degrees)))
+    bool reached = true;
+    while (!(fabs(motors.get_avg_position()) >= fabs(degrees))) {
+        if (pros::millis() - start >= timeout) {
+            printf("Intake turn timed out\n");
+            reached = false;
+            break;
+        }
         pros::delay(2);
+    }
+    direction = reached ? INTAKE_HOLD : 0;
+    return reached;
 }
 
 void Intake::print_telemetry(uint8_t vals_to_print) {
     printf("Intake Telemetry\n");
     motors.print_telemetry(vals_to_print);
-}
\ No newline at end of file
+}
+
+Motor_Group &Intake::get_motors() { return motors; }
+
+int Intake::get_jam_current_limit() {
+    int count = motors.size();
+    return count ? (JAM_CURRENT + JAM_CURRENT_MARGIN + count - 1) / count
+                 : JAM_CURRENT + JAM_CURRENT_MARGIN;
+}
+
+intake_state_e_t Intake::get_state() { return state; }
+
+uint32_t Intake::get_jams() { return jams; }
+
+void Intake::snapshot(subsystem_snapshot_t &snap) {
+    snap.state = state;
+    snap.target = direction;
+    snap.velocity = motors.get_avg_velocity();
+    snap.current = motors.get_total_current_draw();
+}
+
+void Intake::safe_stop() { stop(); }
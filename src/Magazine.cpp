@@ -0,0 +1,236 @@
+#include "Magazine.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+// How often the signals are checked, in ms
+#define MAGAZINE_PERIOD 10
+
+// How fast the intake must turn to count as running, in RPM, and how long it
+// runs before its current is watched, so that spinning up isn't taken for a
+// disk, in ms
+#define MAGAZINE_INTAKE_MIN_VELOCITY 20
+#define MAGAZINE_INTAKE_SETTLE 250
+
+// How far the intake's current must rise above its running level for a disk,
+// in mA, and for how long at least, in ms
+#define MAGAZINE_INTAKE_SPIKE 400
+#define MAGAZINE_SPIKE_TIME 60
+
+// How much the flywheel must dip for a shot to count as fired, in RPM, and
+// how long after the indexer has finished the dip is watched for, in ms
+#define MAGAZINE_DIP 40
+#define MAGAZINE_DIP_WINDOW 200
+
+// How many distance readings in a row must agree before the count follows
+// them
+#define MAGAZINE_DISTANCE_READS 5
+
+// The optical sensor stops seeing a disk this far below the threshold
+#define MAGAZINE_PROXIMITY_HYSTERESIS 20
+
+static const char *const event_names[] = {"disk in", "disk out", "fired",
+                                          "dry fire", "full"};
+
+Magazine::Magazine(Intake &intake, Indexer &indexer, Flywheel &flywheel)
+    : Subsystem("magazine", "Magazine Task", MAGAZINE_PERIOD), intake(intake),
+      indexer(indexer), flywheel(flywheel) {}
+
+void Magazine::set_distance_sensor(uint8_t port, double empty_distance,
+                                   double disk_height) {
+    distance_port = port;
+    this->empty_distance = empty_distance;
+    this->disk_height = disk_height;
+}
+
+void Magazine::set_optical_sensor(uint8_t port, int32_t threshold) {
+    optical_port = port;
+    proximity_threshold = threshold;
+    pros::c::optical_set_led_pwm(optical_port, 100);
+}
+
+uint32_t Magazine::tick(uint32_t now) {
+    update_intake(now);
+    if (distance_port)
+        update_distance(now);
+    update_shot(now);
+    return MAGAZINE_PERIOD;
+}
+
+void Magazine::update_intake(uint32_t now) {
+    Motor_Group &motors = intake.get_motors();
+    double velocity = motors.get_avg_velocity();
+    int dir = velocity > MAGAZINE_INTAKE_MIN_VELOCITY    ? 1
+              : velocity < -MAGAZINE_INTAKE_MIN_VELOCITY ? -1
+                                                         : 0;
+    // The disk moved back and forth while a jam is freed stays where it is
+    intake_state_e_t intake_state = intake.get_state();
+    if (intake_state == E_INTAKE_CLEARING || intake_state == E_INTAKE_JAMMED)
+        dir = 0;
+
+    if (optical_port) {
+        int32_t proximity = pros::c::optical_get_proximity(optical_port);
+        if (!disk_seen && proximity >= proximity_threshold) {
+            disk_seen = true;
+            if (dir != 0)
+                disk_moved(dir > 0 ? E_MAGAZINE_DISK_IN : E_MAGAZINE_DISK_OUT,
+                           now);
+        } else if (disk_seen && proximity < proximity_threshold -
+                                                MAGAZINE_PROXIMITY_HYSTERESIS)
+            disk_seen = false;
+        return;
+    }
+
+    double current = motors.get_total_current_draw();
+    if (dir != intake_dir) {
+        intake_dir = dir;
+        run_start = now;
+        in_spike = false;
+    }
+    if (dir == 0 || now - run_start < MAGAZINE_INTAKE_SETTLE) {
+        baseline = current;
+        return;
+    }
+
+    if (!in_spike) {
+        if (current > baseline + MAGAZINE_INTAKE_SPIKE) {
+            in_spike = true;
+            spike_start = now;
+        } else
+            baseline += (current - baseline) * 0.05;
+    } else if (current < baseline + MAGAZINE_INTAKE_SPIKE / 2) {
+        in_spike = false;
+        if (now - spike_start >= MAGAZINE_SPIKE_TIME)
+            disk_moved(dir > 0 ? E_MAGAZINE_DISK_IN : E_MAGAZINE_DISK_OUT,
+                       now);
+    }
+}
+
+void Magazine::update_distance(uint32_t now) {
+    int32_t distance = pros::c::distance_get(distance_port);
+    if (distance == PROS_ERR || disk_height <= 0)
+        return;
+    int reading = lround((empty_distance - distance) / disk_height);
+    reading = reading < 0                   ? 0
+              : reading > MAGAZINE_CAPACITY ? MAGAZINE_CAPACITY
+                                            : reading;
+
+    if (reading != distance_count) {
+        distance_count = reading;
+        distance_reads = 1;
+        return;
+    }
+    if (++distance_reads != MAGAZINE_DISTANCE_READS)
+        return;
+
+    // The stack has settled at a new height
+    int old = count;
+    count = reading;
+    if (old == MAGAZINE_UNKNOWN || old == reading)
+        return;
+    raise(reading > old ? E_MAGAZINE_DISK_IN : E_MAGAZINE_DISK_OUT, now);
+    if (reading == MAGAZINE_CAPACITY)
+        raise(E_MAGAZINE_FULL, now);
+}
+
+void Magazine::update_shot(uint32_t now) {
+    indexer_state_e_t state = indexer.get_state();
+    bool firing = state == E_INDEXER_FIRING || state == E_INDEXER_RETURNING;
+    double speed = fabs(flywheel.get_measured_velo());
+
+    // In a burst the next shot can start before the last one's watch ends
+    if (in_shot && shot_end != 0 && state == E_INDEXER_FIRING)
+        end_shot(now);
+
+    if (!in_shot) {
+        if (state != E_INDEXER_FIRING)
+            return;
+        in_shot = true;
+        shot_speed = speed;
+        shot_low = speed;
+        shot_at_speed = flywheel.is_at_speed() && speed > MAGAZINE_DIP;
+        shot_end = 0;
+        return;
+    }
+
+    if (speed < shot_low)
+        shot_low = speed;
+    if (firing)
+        return;
+    if (shot_end == 0)
+        shot_end = now + MAGAZINE_DIP_WINDOW;
+    if ((int32_t)(now - shot_end) >= 0)
+        end_shot(now);
+}
+
+void Magazine::end_shot(uint32_t now) {
+    // Without the flywheel at speed there is nothing to go on, so the shot is
+    // taken to have fired a disk
+    bool dipped = !shot_at_speed || shot_speed - shot_low >= MAGAZINE_DIP;
+    if (!distance_port) {
+        int old = count;
+        if (!dipped)
+            count = 0;
+        else if (old > 0)
+            count = old - 1;
+    }
+    raise(dipped ? E_MAGAZINE_FIRED : E_MAGAZINE_DRY_FIRE, now);
+    in_shot = false;
+}
+
+void Magazine::disk_moved(magazine_event_e_t type, uint32_t now) {
+    // The distance sensor has the final say on the count
+    if (!distance_port) {
+        int old = count;
+        if (old != MAGAZINE_UNKNOWN) {
+            int disks = old + (type == E_MAGAZINE_DISK_IN ? 1 : -1);
+            count = disks < 0                   ? 0
+                    : disks > MAGAZINE_CAPACITY ? MAGAZINE_CAPACITY
+                                                : disks;
+        }
+    }
+    raise(type, now);
+    if (type == E_MAGAZINE_DISK_IN && count == MAGAZINE_CAPACITY)
+        raise(E_MAGAZINE_FULL, now);
+}
+
+void Magazine::raise(magazine_event_e_t type, uint32_t now) {
+    uint32_t seq = event_seq;
+    events[seq % MAGAZINE_EVENTS] = {now, type, count};
+    event_seq = seq + 1;
+    printf("Magazine: %s, %d loaded\n", event_name(type), (int)count);
+}
+
+int Magazine::get_count() { return count; }
+
+void Magazine::set_count(int disks) {
+    count = disks < MAGAZINE_UNKNOWN    ? MAGAZINE_UNKNOWN
+            : disks > MAGAZINE_CAPACITY ? MAGAZINE_CAPACITY
+                                        : disks;
+}
+
+bool Magazine::is_full() { return count == MAGAZINE_CAPACITY; }
+
+bool Magazine::is_counting_shot() { return in_shot; }
+
+bool Magazine::next_event(uint32_t &seq, magazine_event_t &event) {
+    uint32_t latest = event_seq;
+    if (seq == latest)
+        return false;
+    if (latest - seq > MAGAZINE_EVENTS)
+        seq = latest - MAGAZINE_EVENTS;
+    event = events[seq % MAGAZINE_EVENTS];
+    ++seq;
+    return true;
+}
+
+const char *Magazine::event_name(magazine_event_e_t type) {
+    return type <= E_MAGAZINE_FULL ? event_names[type] : "unknown";
+}
+
+void Magazine::snapshot(subsystem_snapshot_t &snap) {
+    snap.state = count;
+    snap.target = in_shot;
+}
+
+void Magazine::safe_stop() {}
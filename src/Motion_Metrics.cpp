@@ -0,0 +1,118 @@
+#include "Motion_Metrics.hpp"
+#include "pros/misc.h"
+#include <cmath>
+
+void Motion_Metrics::begin(const char *type, double amount, double target,
+                           uint32_t now) {
+    // The motion being replaced ends wherever it had got to
+    if (active)
+        end(current.target - progress, E_SETTLE_SUPERSEDED, now);
+
+    current.type = type;
+    current.amount = amount;
+    current.target = fabs(target);
+    current.start_time = now;
+    current.rise_time = 0;
+    current.settle_time = 0;
+    current.overshoot = 0;
+    current.steady_state_error = 0;
+    current.peak_current = 0;
+    current.peak_slip = 0;
+    current.exit_reason = E_SETTLE_NONE;
+    progress = 0;
+    active = true;
+    risen = false;
+}
+
+void Motion_Metrics::update(double progress, int current_draw, double slip,
+                            uint32_t now) {
+    if (!active)
+        return;
+    this->progress = progress;
+
+    if (!risen &&
+        progress >= current.target * MOTION_METRICS_RISE_FRACTION) {
+        current.rise_time = now - current.start_time;
+        risen = true;
+    }
+    if (progress - current.target > current.overshoot)
+        current.overshoot = progress - current.target;
+    if (current_draw > current.peak_current)
+        current.peak_current = current_draw;
+    if (slip > current.peak_slip)
+        current.peak_slip = slip;
+}
+
+void Motion_Metrics::end(double error, settle_exit_e_t reason, uint32_t now) {
+    if (!active)
+        return;
+    active = false;
+
+    // The table is full, so the motion is dropped rather than overwriting an
+    // earlier one
+    size_t index = count;
+    if (index >= MOTION_METRICS_CAPACITY)
+        return;
+
+    current.settle_time = now - current.start_time;
+    current.steady_state_error = fabs(error);
+    current.exit_reason = reason;
+
+    records[index] = current;
+    count = index + 1;
+}
+
+void Motion_Metrics::cut(uint32_t now) {
+    if (active)
+        end(current.target - progress, E_SETTLE_CUT, now);
+}
+
+size_t Motion_Metrics::size() { return count; }
+
+const motion_record_t &Motion_Metrics::get(size_t index) {
+    return records[index];
+}
+
+void Motion_Metrics::clear() { count = 0; }
+
+void Motion_Metrics::write_csv(FILE *file) {
+    fprintf(file, "motion,type,amount,target,start_ms,rise_ms,settle_ms,"
+                  "overshoot,steady_state_error,peak_current_ma,peak_slip,"
+                  "exit_reason\n");
+
+    size_t n = count;
+    for (size_t i = 0; i < n; ++i) {
+        const motion_record_t &r = records[i];
+        fprintf(file, "%u,%s,%.2f,%.1f,%lu,%lu,%lu,%.2f,%.2f,%d,%.2f,%s\n",
+                (unsigned)i, r.type, r.amount, r.target,
+                (unsigned long)r.start_time, (unsigned long)r.rise_time,
+                (unsigned long)r.settle_time, r.overshoot,
+                r.steady_state_error, r.peak_current, r.peak_slip,
+                Settle_Detector::exit_reason_name(r.exit_reason));
+    }
+}
+
+void Motion_Metrics::print() { write_csv(stdout); }
+
+bool Motion_Metrics::save(const char *prefix) {
+    if (!pros::c::usd_is_installed())
+        return false;
+
+    char path[64];
+    for (int n = 0; n < 1000; ++n) {
+        snprintf(path, sizeof(path), "%s_%d.csv", prefix, n);
+        FILE *existing = fopen(path, "r");
+        if (existing) {
+            fclose(existing);
+            continue;
+        }
+
+        FILE *file = fopen(path, "w");
+        if (!file)
+            return false;
+        write_csv(file);
+        fclose(file);
+        return true;
+    }
+    return false;
+}
@@ -1,5 +1,7 @@
 #include "Motor_Group.hpp"
 #include "pros/motors.h"
+#include <cmath>
+#include <cstdio>
 #include <vector>
 
 /* The Constructors for Motor_Group*/
@@ -44,38 +46,81 @@ Motor_Group::Motor_Group(std::initializer_list<int> ports,
 
 /* Movement Functions */
 void Motor_Group::brake(void) {
+    set_command_dir(0);
     for (int p : motor_ports)
         pros::c::motor_brake(p);
 }
 
 void Motor_Group::move(int voltage) {
-    for (int p : motor_ports)
-        pros::c::motor_move(p, voltage);
+    set_command_dir(voltage);
+    for (size_t i = 0; i < motor_ports.size(); ++i)
+        if (is_commanded(i))
+            pros::c::motor_move(motor_ports[i], derated(i, voltage));
 }
 
 void Motor_Group::move_absolute(double position, int velocity) {
-    for (int p : motor_ports)
-        pros::c::motor_move_absolute(p, position, velocity);
+    for (size_t i = 0; i < motor_ports.size(); ++i)
+        if (is_commanded(i))
+            pros::c::motor_move_absolute(motor_ports[i], position,
+                                         derated(i, velocity));
 }
 
 void Motor_Group::move_relative(double position, int velocity) {
-    for (int p : motor_ports)
-        pros::c::motor_move_relative(p, position, velocity);
+    set_command_dir(position);
+    for (size_t i = 0; i < motor_ports.size(); ++i)
+        if (is_commanded(i))
+            pros::c::motor_move_relative(motor_ports[i], position,
+                                         derated(i, velocity));
 }
 
 void Motor_Group::move_velocity(int velocity) {
-    for (int p : motor_ports)
-        pros::c::motor_move_velocity(p, velocity);
+    set_command_dir(velocity);
+    for (size_t i = 0; i < motor_ports.size(); ++i)
+        if (is_commanded(i))
+            pros::c::motor_move_velocity(motor_ports[i], derated(i, velocity));
 }
 
 void Motor_Group::move_voltage(int voltage) {
-    for (int p : motor_ports)
-        pros::c::motor_move_voltage(p, voltage);
+    set_command_dir(voltage);
+    for (size_t i = 0; i < motor_ports.size(); ++i)
+        if (is_commanded(i))
+            pros::c::motor_move_voltage(motor_ports[i], derated(i, voltage));
 }
 
 void Motor_Group::modify_profiled_velocity(int velocity) {
-    for (int p : motor_ports)
-        pros::c::motor_modify_profiled_velocity(p, velocity);
+    for (size_t i = 0; i < motor_ports.size(); ++i)
+        if (is_commanded(i))
+            pros::c::motor_modify_profiled_velocity(motor_ports[i],
+                                                        derated(i, velocity));
+}
+
+void Motor_Group::set_command_dir(double command) {
+    command_dir.store((command > 0) - (command < 0), std::memory_order_relaxed);
+}
+
+/* Derating */
+
+double Motor_Group::derated(size_t index, double command) {
+    if (index >= MOTOR_GROUP_MAX_MOTORS)
+        return command;
+    return command * (100 - derates[index].load(std::memory_order_relaxed)) /
+           100;
+}
+
+bool Motor_Group::is_averaged(size_t index) {
+    if (index >= MOTOR_GROUP_MAX_MOTORS)
+        return true;
+    uint32_t mask = ignored.load(std::memory_order_relaxed);
+    // With every motor ignored there would be nothing to average
+    uint32_t all = (1u << motor_ports.size()) - 1;
+    return !(mask & (1u << index)) || mask == all;
+}
+
+bool Motor_Group::is_commanded(size_t index) {
+    // A motor derated by 100% is skipped entirely, rather than sent 0, so
+    // that a position command doesn't leave it holding against the others
+    return index >= MOTOR_GROUP_MAX_MOTORS ||
+           derates[index].load(std::memory_order_relaxed) < 100;
 }
 
 /* Telemetry Functions */
@@ -108,18 +153,226 @@ std::vector<bool> Motor_Group::are_reversed(void) {
     return reversed;
 }
 
-double Motor_Group::get_avg_position(void) {
+/* Aggregation */
+
+// Insertion sort, as there are only a handful of motors
+static void sort_readings(double *values, size_t count) {
+    for (size_t i = 1; i < count; ++i)
+        for (size_t j = i; j > 0 && values[j - 1] > values[j]; --j) {
+            double tmp = values[j - 1];
+            values[j - 1] = values[j];
+            values[j] = tmp;
+        }
+}
+
+double Motor_Group::aggregate(double *values, double *weights, size_t count) {
+    // Pack the finite readings to the front
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (std::isfinite(values[i])) {
+            values[n] = values[i];
+            weights[n] = weights[i];
+            ++n;
+        }
+    }
+    if (n == 0)
+        return 0;
+
+    motor_group_aggregate_e_t mode =
+        aggregation.load(std::memory_order_relaxed);
+
+    // Jumps have already been taken out of the readings
+    if (mode == E_MOTOR_GROUP_AGGREGATE_REJECT_JUMPS)
+        mode = E_MOTOR_GROUP_AGGREGATE_MEAN;
+
+    if (mode == E_MOTOR_GROUP_AGGREGATE_WEIGHTED) {
+        double sum = 0, total_weight = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += values[i] * weights[i];
+            total_weight += weights[i];
+        }
+        // Every motor is fully derated, so weigh them equally instead
+        if (total_weight > 0)
+            return sum / total_weight;
+        mode = E_MOTOR_GROUP_AGGREGATE_MEAN;
+    }
+
+    if (mode != E_MOTOR_GROUP_AGGREGATE_MEAN)
+        sort_readings(values, n);
+
+    size_t first = 0, last = n;
+    if (mode == E_MOTOR_GROUP_AGGREGATE_MEDIAN) {
+        if (n % 2)
+            return values[n / 2];
+        first = n / 2 - 1;
+        last = n / 2 + 1;
+    } else if (mode == E_MOTOR_GROUP_AGGREGATE_TRIMMED_MEAN && n >= 3) {
+        first = 1;
+        last = n - 1;
+    }
+
     double sum = 0;
-    for (int p : motor_ports)
-        sum += pros::c::motor_get_position(p);
-    return sum / motor_ports.size();
+    for (size_t i = first; i < last; ++i)
+        sum += values[i];
+    return sum / (last - first);
+}
+
+double Motor_Group::read_aggregate(double (*read)(uint8_t), double *values) {
+    size_t count = motor_ports.size();
+    if (count > MOTOR_GROUP_MAX_MOTORS)
+        count = MOTOR_GROUP_MAX_MOTORS;
+
+    double sorted[MOTOR_GROUP_MAX_MOTORS];
+    double weights[MOTOR_GROUP_MAX_MOTORS];
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = is_averaged(i) ? read(motor_ports[i]) : NAN;
+        sorted[i] = values[i];
+        weights[i] = 100 - get_motor_derate(i);
+    }
+    return aggregate(sorted, weights, count);
+}
+
+// motor_get_voltage returns an integer, and PROS_ERR rather than PROS_ERR_F
+static double read_voltage(uint8_t port) {
+    int32_t voltage = pros::c::motor_get_voltage(port);
+    return voltage == PROS_ERR ? NAN : voltage;
+}
+
+double Motor_Group::read_positions_rejecting_jumps(double *values) {
+    size_t count = motor_ports.size();
+    if (count > MOTOR_GROUP_MAX_MOTORS)
+        count = MOTOR_GROUP_MAX_MOTORS;
+
+    if (positions_reset.exchange(false, std::memory_order_relaxed)) {
+        for (size_t i = 0; i < count; ++i) {
+            last_positions[i] = NAN;
+            jump_offsets[i] = 0;
+        }
+    }
+
+    // How far each motor moved since the last call, NAN if it can't be told
+    double moved[MOTOR_GROUP_MAX_MOTORS];
+    size_t compared = 0;
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = is_averaged(i) ? pros::c::motor_get_position(motor_ports[i])
+                                   : NAN;
+        moved[i] = values[i] - last_positions[i];
+        if (std::isfinite(values[i]))
+            last_positions[i] = values[i];
+        if (std::isfinite(moved[i]))
+            ++compared;
+    }
+
+    if (compared >= 2) {
+        // The others' movement, which a motor that jumped takes on instead:
+        // the partner's for two motors, otherwise the median
+        double sorted[MOTOR_GROUP_MAX_MOTORS];
+        size_t n = 0;
+        for (size_t i = 0; i < count; ++i)
+            if (std::isfinite(moved[i]))
+                sorted[n++] = moved[i];
+        sort_readings(sorted, n);
+
+        if (n == 2 && fabs(sorted[1] - sorted[0]) > MOTOR_GROUP_JUMP) {
+            int dir = command_dir.load(std::memory_order_relaxed);
+            // The one that moved against the direction last commanded, when
+            // only one did, or otherwise the one that moved further
+            bool low_jumped;
+            if (dir > 0 && sorted[0] < 0 && sorted[1] >= 0)
+                low_jumped = true;
+            else if (dir < 0 && sorted[1] > 0 && sorted[0] <= 0)
+                low_jumped = false;
+            else
+                low_jumped = fabs(sorted[0]) > fabs(sorted[1]);
+            double jumped = low_jumped ? sorted[0] : sorted[1];
+            double expected = low_jumped ? sorted[1] : sorted[0];
+            for (size_t i = 0; i < count; ++i)
+                if (moved[i] == jumped) {
+                    jump_offsets[i] += expected - moved[i];
+                    printf("Motor %d jumped %.0f, ignored\n", motor_ports[i],
+                           moved[i] - expected);
+                    break;
+                }
+        } else if (n > 2) {
+            double median = n % 2 ? sorted[n / 2]
+                                  : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+            for (size_t i = 0; i < count; ++i)
+                if (fabs(moved[i] - median) > MOTOR_GROUP_JUMP) {
+                    jump_offsets[i] += median - moved[i];
+                    printf("Motor %d jumped %.0f, ignored\n", motor_ports[i],
+                           moved[i] - median);
+                }
+        }
+    }
+
+    double corrected[MOTOR_GROUP_MAX_MOTORS];
+    double weights[MOTOR_GROUP_MAX_MOTORS];
+    for (size_t i = 0; i < count; ++i) {
+        corrected[i] = values[i] + jump_offsets[i];
+        weights[i] = 1;
+    }
+    return aggregate(corrected, weights, count);
+}
+
+double Motor_Group::get_avg_position(void) {
+    double values[MOTOR_GROUP_MAX_MOTORS];
+    double result =
+        aggregation.load(std::memory_order_relaxed) ==
+                E_MOTOR_GROUP_AGGREGATE_REJECT_JUMPS
+            ? read_positions_rejecting_jumps(values)
+            : read_aggregate(pros::c::motor_get_position, values);
+
+    size_t count = motor_ports.size();
+    if (count > MOTOR_GROUP_MAX_MOTORS)
+        count = MOTOR_GROUP_MAX_MOTORS;
+    for (size_t i = 0; i < count; ++i)
+        deviations[i].store(std::isfinite(values[i]) ? values[i] - result : NAN,
+                            std::memory_order_relaxed);
+    return result;
 }
 
 double Motor_Group::get_avg_velocity(void) {
-    double sum = 0;
-    for (int p : motor_ports)
-        sum += pros::c::motor_get_actual_velocity(p);
-    return sum / motor_ports.size();
+    double values[MOTOR_GROUP_MAX_MOTORS];
+    return read_aggregate(pros::c::motor_get_actual_velocity, values);
+}
+
+double Motor_Group::get_avg_voltage(void) {
+    double values[MOTOR_GROUP_MAX_MOTORS];
+    return read_aggregate(read_voltage, values);
+}
+
+double Motor_Group::get_position_deviation(size_t index) {
+    if (index >= MOTOR_GROUP_MAX_MOTORS || index >= motor_ports.size())
+        return NAN;
+    return deviations[index].load(std::memory_order_relaxed);
+}
+
+double Motor_Group::get_position_disagreement(void) {
+    double largest = 0;
+    for (size_t i = 0; i < motor_ports.size() && i < MOTOR_GROUP_MAX_MOTORS;
+         ++i) {
+        double deviation = fabs(deviations[i].load(std::memory_order_relaxed));
+        if (deviation > largest)
+            largest = deviation;
+    }
+    return largest;
+}
+
+int Motor_Group::get_total_current_draw(void) {
+    int sum = 0;
+    for (int p : motor_ports) {
+        // A disconnected motor returns PROS_ERR, which would overflow the sum
+        int32_t draw = pros::c::motor_get_current_draw(p);
+        if (draw != PROS_ERR)
+            sum += draw;
+    }
+    return sum;
+}
+
+size_t Motor_Group::size(void) { return motor_ports.size(); }
+
+int Motor_Group::get_port(size_t index) {
+    return index < motor_ports.size() ? motor_ports[index] : PROS_ERR;
 }
 
 std::vector<pros::motor_brake_mode_e_t> Motor_Group::get_brake_modes(void) {
@@ -299,11 +552,48 @@ void Motor_Group::set_voltage_limits(const std::vector<int> limits) {
 void Motor_Group::set_zero_position(double zero_pos) {
     for (int p : motor_ports)
         pros::c::motor_set_zero_position(p, zero_pos);
+    positions_reset = true;
+}
+
+void Motor_Group::set_aggregation(motor_group_aggregate_e_t mode) {
+    aggregation.store(mode, std::memory_order_relaxed);
+}
+
+void Motor_Group::set_motor_derate(size_t index, int percent) {
+    if (index >= MOTOR_GROUP_MAX_MOTORS)
+        return;
+    if (percent < 0)
+        percent = 0;
+    else if (percent > 100)
+        percent = 100;
+    derates[index].store(percent, std::memory_order_relaxed);
+}
+
+int Motor_Group::get_motor_derate(size_t index) {
+    if (index >= MOTOR_GROUP_MAX_MOTORS)
+        return 0;
+    return derates[index].load(std::memory_order_relaxed);
+}
+
+void Motor_Group::set_motor_ignored(size_t index, bool ignored) {
+    if (index >= MOTOR_GROUP_MAX_MOTORS)
+        return;
+    if (ignored)
+        this->ignored.fetch_or(1u << index, std::memory_order_relaxed);
+    else
+        this->ignored.fetch_and(~(1u << index), std::memory_order_relaxed);
+}
+
+bool Motor_Group::is_motor_ignored(size_t index) {
+    if (index >= MOTOR_GROUP_MAX_MOTORS)
+        return false;
+    return ignored.load(std::memory_order_relaxed) & (1u << index);
 }
 
 void Motor_Group::reset_positions(void) {
     for (int p : motor_ports)
         pros::c::motor_tare_position(p);
+    positions_reset = true;
 }
 
 /* Miscellaneous Functions */
@@ -0,0 +1,191 @@
+#include "Power_Manager.hpp"
+#include "api.h"
+
+#include <cstdio>
+
+Power_Manager::Power_Manager()
+    : Subsystem("power", "Power Manager Task", POWER_MANAGER_PERIOD) {}
+
+bool Power_Manager::add_group(const char *name, Motor_Group *motors,
+                              int priority, int min_limit, int max_limit) {
+    if (group_count >= POWER_MANAGER_MAX_GROUPS)
+        return false;
+
+    if (max_limit > POWER_MANAGER_MOTOR_MAX_LIMIT)
+        max_limit = POWER_MANAGER_MOTOR_MAX_LIMIT;
+    if (min_limit > max_limit)
+        min_limit = max_limit;
+
+    power_group_t &group = groups[group_count];
+    group.name = name;
+    group.motors = motors;
+    group.priority = priority;
+    group.min_limit = min_limit;
+    group.max_limit = max_limit;
+    group.limit = max_limit;
+    group.draw = 0;
+    group.throttle_count = 0;
+    group.last_log = 0;
+    motors->set_current_limits(max_limit);
+
+    // Keep the groups sorted by priority, highest first, so update() can hand
+    // out the budget in order. Groups with equal priority stay in the order
+    // they were added.
+    size_t i = group_count++;
+    for (; i > 0 && groups[i - 1].priority < priority; --i) {
+        power_group_t tmp = groups[i - 1];
+        groups[i - 1] = groups[i];
+        groups[i] = tmp;
+    }
+    return true;
+}
+
+void Power_Manager::set_budget(int total_ma) { budget = total_ma; }
+
+uint32_t Power_Manager::tick(uint32_t now) {
+    update();
+    return POWER_MANAGER_PERIOD;
+}
+
+void Power_Manager::update() {
+    int total_draw = 0, total_max = 0, total_min = 0;
+    for (size_t i = 0; i < group_count; ++i) {
+        power_group_t &group = groups[i];
+        group.draw = group.motors->get_total_current_draw();
+        total_draw += group.draw;
+        total_max += group.max_limit * (int)group.motors->size();
+        total_min += group.min_limit * (int)group.motors->size();
+    }
+
+    // Nothing needs limiting while everything fits, or while the motors are
+    // drawing well under the budget, so that a group starting from rest isn't
+    // held to what it was drawing at rest
+    if (total_draw >= ENGAGE_FRACTION * budget)
+        limiting = true;
+    else if (total_draw < RELEASE_FRACTION * budget)
+        limiting = false;
+    if (total_max <= budget || !limiting) {
+        for (size_t i = 0; i < group_count; ++i)
+            apply(groups[i], groups[i].max_limit, total_draw);
+        return;
+    }
+
+    // Every group is guaranteed its minimum, even if that goes over budget
+    int grants[POWER_MANAGER_MAX_GROUPS];
+    int needs[POWER_MANAGER_MAX_GROUPS];
+    int remaining = budget - total_min;
+
+    // Then each gets what it needs, in priority order
+    for (size_t i = 0; i < group_count; ++i) {
+        const power_group_t &group = groups[i];
+        int count = group.motors->size();
+        int ceiling = group.max_limit * count;
+
+        int want = ceiling;
+        if (group.draw < LIMIT_BOUND * group.limit * count)
+            want = group.draw + HEADROOM * count;
+        if (want > ceiling)
+            want = ceiling;
+
+        grants[i] = group.min_limit * count;
+        needs[i] = want > grants[i] ? want - grants[i] : 0;
+    }
+    share(needs, grants, remaining);
+
+    // And whatever is left tops them up, again in priority order
+    for (size_t i = 0; i < group_count; ++i)
+        needs[i] = groups[i].max_limit * (int)groups[i].motors->size() -
+                   grants[i];
+    share(needs, grants, remaining);
+
+    for (size_t i = 0; i < group_count; ++i) {
+        int count = groups[i].motors->size();
+        apply(groups[i], count ? grants[i] / count : groups[i].max_limit,
+              total_draw);
+    }
+}
+
+void Power_Manager::share(const int *needs, int *grants, int &remaining) {
+    size_t start = 0;
+    while (start < group_count) {
+        // Groups with the same priority are next to each other
+        int priority = groups[start].priority;
+        size_t end = start;
+        int tier_need = 0;
+        for (; end < group_count && groups[end].priority == priority; ++end)
+            tier_need += needs[end];
+
+        // If the tier can't all have what it needs, what's left is split in
+        // proportion to need, so neither side of the drive gets starved
+        int given = 0;
+        for (size_t i = start; i < end; ++i) {
+            int extra = needs[i];
+            if (tier_need > remaining)
+                extra = remaining > 0
+                            ? (int)((int64_t)needs[i] * remaining / tier_need)
+                            : 0;
+            grants[i] += extra;
+            given += extra;
+        }
+        remaining -= given;
+        start = end;
+    }
+}
+
+void Power_Manager::apply(power_group_t &group, int limit, int total_draw) {
+    if (limit > group.max_limit)
+        limit = group.max_limit;
+    else if (limit < group.min_limit)
+        limit = group.min_limit;
+
+    int change = limit - group.limit;
+    if (change == 0 ||
+        (limit != group.max_limit && change < MIN_CHANGE &&
+         change > -MIN_CHANGE))
+        return;
+
+    const char *action = "raise";
+    if (limit == group.max_limit)
+        action = "restore";
+    else if (change < 0)
+        action = "throttle";
+
+    bool from_max = group.limit == group.max_limit;
+    if (from_max)
+        ++group.throttle_count;
+
+    group.limit = limit;
+    group.motors->set_current_limits(limit);
+
+    uint32_t now = pros::millis();
+    if (!from_max && limit != group.max_limit &&
+        now - group.last_log < LOG_INTERVAL)
+        return;
+    group.last_log = now;
+    printf("P,%lu,%s,%s,%d,%d,%d\n", (unsigned long)now, action,
+           group.name, limit, group.draw, total_draw);
+}
+
+size_t Power_Manager::size() { return group_count; }
+
+const power_group_t &Power_Manager::get(size_t index) { return groups[index]; }
+
+void Power_Manager::snapshot(subsystem_snapshot_t &snap) {
+    snap.state = limiting;
+    snap.target = budget;
+    for (size_t i = 0; i < group_count; ++i)
+        snap.current += groups[i].draw;
+}
+
+void Power_Manager::safe_stop() {}
+
+void Power_Manager::print_status() {
+    printf("Power budget %d mA\n", budget);
+    for (size_t i = 0; i < group_count; ++i) {
+        const power_group_t &group = groups[i];
+        printf("%s: priority %d, limit %d mA, draw %d mA, throttled %lu "
+               "times\n",
+               group.name, group.priority, group.limit, group.draw,
+               (unsigned long)group.throttle_count);
+    }
+}
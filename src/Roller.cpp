@@ -1,41 +1,195 @@
 #include "Roller.hpp"
 
+#include <cstdio>
+
 Roller::Roller(std::initializer_list<int> ports,
                std::initializer_list<bool> revs, double gear_ratio)
-    : motors(ports, revs), gear_ratio(gear_ratio) {
+    : Subsystem("roller", "Roller Task", ROLLER_COLOR_PERIOD),
+      motors(ports, revs), gear_ratio(gear_ratio) {
     motors.set_brake_mode(pros::E_MOTOR_BRAKE_BRAKE);
     motors.set_encoder_units(pros::E_MOTOR_ENCODER_DEGREES);
 }
 
-void Roller::clockwise() { motors.move(127); }
-void Roller::counterclockwise() { motors.move(-127); }
-void Roller::stop() { motors.move(0); }
+void Roller::clockwise() {
+    cancel_color_spin();
+    motors.move(127);
+}
+void Roller::counterclockwise() {
+    cancel_color_spin();
+    motors.move(-127);
+}
+void Roller::stop() {
+    cancel_color_spin();
+    motors.move(0);
+}
+
+bool Roller::clockwise(double degrees, uint32_t timeout) {
+    start_spin(degrees);
+    return wait_until_spin_done(timeout);
+}
 
-void Roller::clockwise(double degrees) {
+bool Roller::counterclockwise(double degrees, uint32_t timeout) {
+    start_spin(-degrees);
+    return wait_until_spin_done(timeout);
+}
+
+void Roller::start_spin(double degrees) {
+    cancel_color_spin();
     motors.reset_positions();
-    double targ = degrees / gear_ratio;
-    motors.move_relative(targ, 200);
-    while (motors.get_avg_position() < (targ - 5))
+    spin_targ = degrees / gear_ratio;
+    motors.move_relative(spin_targ, 200);
+}
+
+bool Roller::is_spin_done() {
+    if (spin_targ > 0)
+        return motors.get_avg_position() >= spin_targ - 5;
+    return motors.get_avg_position() <= spin_targ + 5;
+}
+
+bool Roller::wait_until_spin_done(uint32_t timeout) {
+    uint32_t start = pros::millis();
+    bool reached = true;
+    while (!is_spin_done()) {
+        // A roller held by the other robot, or already at the wall's limit,
+        // would otherwise hold up the routine for the rest of the period
+        if (pros::millis() - start >= timeout) {
+            printf("Roller spin timed out\n");
+            reached = false;
+            break;
+        }
         pros::delay(2);
+    }
     motors.brake();
+    return reached;
 }
 
-void Roller::counterclockwise(double degrees) {
-    motors.reset_positions();
-    double targ = -degrees / gear_ratio;
-    motors.move_relative(targ, 200);
-    while (motors.get_avg_position() > (targ + 5))
-        pros::delay(2);
+uint32_t Roller::tick(uint32_t) {
+    roller_color_state_e_t state = color_state;
+    if (state != E_ROLLER_COLOR_SPINNING && state != E_ROLLER_COLOR_CONFIRMING)
+        return ROLLER_COLOR_PERIOD;
+    // The spin is timed by the clock, as start_color_spin is, rather than by
+    // the task's scheduled wake time, which can be before the spin started
+    uint32_t now = pros::millis();
+    // Each change of state is only made if the spin hasn't been cancelled in
+    // the meantime, so that the motors aren't taken back from whoever
+    // cancelled it
+    if (now - color_start >= color_timeout)
+        end_color_spin(state, E_ROLLER_COLOR_TIMED_OUT, now);
+    else if (get_color() != color_target)
+        color_state.compare_exchange_strong(state, E_ROLLER_COLOR_SPINNING);
+    else if (state == E_ROLLER_COLOR_SPINNING) {
+        seen_start = now;
+        color_state.compare_exchange_strong(state, E_ROLLER_COLOR_CONFIRMING);
+    } else if (now - seen_start >= CONFIRM_TIME)
+        end_color_spin(state, E_ROLLER_COLOR_DONE, now);
+    return ROLLER_COLOR_PERIOD;
+}
+
+void Roller::end_color_spin(roller_color_state_e_t from,
+                            roller_color_state_e_t to, uint32_t now) {
+    if (!color_state.compare_exchange_strong(from, to))
+        return;
     motors.brake();
+    color_time = now - color_start;
+    if (to == E_ROLLER_COLOR_DONE)
+        printf("Roller turned to %s in %lu ms\n", color_name(color_target),
+               (unsigned long)color_time);
+    else
+        printf("Roller didn't see %s in %lu ms\n", color_name(color_target),
+               (unsigned long)color_time);
+}
+
+void Roller::set_optical_sensor(uint8_t port) { optical_port = port; }
+
+bool Roller::has_color_sensor() { return optical_port != 0; }
+
+void Roller::init_task() {
+    if (optical_port)
+        pros::c::optical_set_led_pwm(optical_port, 100);
+    Subsystem::init_task();
 }
 
-void Roller::driver(pros::controller_id_e_t controller,
+roller_color_e_t Roller::get_color() {
+    if (!optical_port ||
+        pros::c::optical_get_proximity(optical_port) < MIN_PROXIMITY)
+        return E_ROLLER_NONE;
+    double hue = pros::c::optical_get_hue(optical_port);
+    if (hue == PROS_ERR_F)
+        return E_ROLLER_NONE;
+    // Red wraps around 0
+    if (hue >= RED_HUE_LOW || hue <= RED_HUE_HIGH)
+        return E_ROLLER_RED;
+    if (hue >= BLUE_HUE_LOW && hue <= BLUE_HUE_HIGH)
+        return E_ROLLER_BLUE;
+    return E_ROLLER_NONE;
+}
+
+void Roller::start_color_spin(roller_color_e_t target, int velocity,
+                              uint32_t timeout) {
+    color_start = pros::millis();
+    if (!optical_port) {
+        printf("Roller has no optical sensor to turn by color\n");
+        color_time = 0;
+        color_state = E_ROLLER_COLOR_TIMED_OUT;
+        return;
+    }
+    color_target = target;
+    color_timeout = timeout;
+    motors.move_velocity(velocity);
+    color_state = E_ROLLER_COLOR_SPINNING;
+}
+
+void Roller::cancel_color_spin() {
+    roller_color_state_e_t state = color_state;
+    if (state == E_ROLLER_COLOR_SPINNING || state == E_ROLLER_COLOR_CONFIRMING)
+        color_state = E_ROLLER_COLOR_IDLE;
+}
+
+bool Roller::is_color_done() {
+    roller_color_state_e_t state = color_state;
+    return state != E_ROLLER_COLOR_SPINNING &&
+           state != E_ROLLER_COLOR_CONFIRMING;
+}
+
+bool Roller::wait_until_color_done() {
+    while (!is_color_done())
+        pros::delay(ROLLER_COLOR_PERIOD);
+    return color_state == E_ROLLER_COLOR_DONE;
+}
+
+roller_color_state_e_t Roller::get_color_state() { return color_state; }
+
+uint32_t Roller::get_color_time() { return color_time; }
+
+const char *Roller::color_name(roller_color_e_t color) {
+    switch (color) {
+    case E_ROLLER_RED:
+        return "red";
+    case E_ROLLER_BLUE:
+        return "blue";
+    default:
+        return "none";
+    }
+}
+
+void Roller::driver(const controller_snapshot_t &snapshot,
                     pros::controller_digital_e_t cw_btn,
                     pros::controller_digital_e_t ccw_btn) {
-    if (pros::c::controller_get_digital(controller, cw_btn))
+    if (snapshot.is_held(cw_btn))
         clockwise();
-    else if (pros::c::controller_get_digital(controller, ccw_btn))
+    else if (snapshot.is_held(ccw_btn))
         counterclockwise();
-    else
+    else if (is_color_done())
         stop();
-}
\ No newline at end of file
+}
+
+Motor_Group &Roller::get_motors() { return motors; }
+
+void Roller::snapshot(subsystem_snapshot_t &snap) {
+    snap.state = color_state;
+    snap.target = spin_targ;
+    snap.velocity = motors.get_avg_velocity();
+    snap.current = motors.get_total_current_draw();
+}
+
+void Roller::safe_stop() { stop(); }
@@ -0,0 +1,81 @@
+#include "Routine.hpp"
+#include "Trace.hpp"
+#include "api.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const char *const op_names[E_ROUTINE_NUM_OPS] = {
+    "straight", "turn",   "delay",  "flywheel", "wait_flywheel",
+    "punch",    "intake", "roller", "piston"};
+
+bool Routine::load_file(const char *path) {
+    count = 0;
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    char magic[4];
+    uint16_t header[2];
+    bool valid = fread(magic, 1, 4, file) == 4 &&
+                 !memcmp(magic, ROUTINE_MAGIC, 4) &&
+                 fread(header, sizeof(header), 1, file) == 1 &&
+                 header[0] <= ROUTINE_MAX_COMMANDS &&
+                 fread(commands, sizeof(routine_cmd_t), header[0], file) ==
+                     header[0];
+    fclose(file);
+    if (!valid) {
+        printf("%s is not a valid routine\n", path);
+        return false;
+    }
+
+    for (size_t i = 0; i < header[0]; ++i) {
+        const routine_cmd_t &cmd = commands[i];
+        if (cmd.op >= E_ROUTINE_NUM_OPS ||
+            (cmd.op == E_ROUTINE_PISTON &&
+             (cmd.port < 'a' || cmd.port > 'h'))) {
+            printf("%s: command %u is not valid\n", path, (unsigned)i);
+            return false;
+        }
+    }
+    count = header[0];
+    return true;
+}
+
+bool Routine::load(enum auton id) {
+    if (!pros::c::usd_is_installed()) {
+        count = 0;
+        return false;
+    }
+    char path[32];
+    snprintf(path, sizeof(path), "/usd/auton_%d.rtn", (int)id);
+    return load_file(path);
+}
+
+bool Routine::run(const routine_handler_t handlers[E_ROUTINE_NUM_OPS],
+                  uint32_t timeout, routine_start_fn_t on_start) {
+    uint32_t start = pros::millis();
+    for (size_t i = 0; i < count; ++i) {
+        if (pros::millis() - start >= timeout) {
+            printf("Routine timed out before command %u\n", (unsigned)i);
+            return false;
+        }
+        const routine_cmd_t &cmd = commands[i];
+        Trace::mark(i);
+        if (on_start)
+            on_start(i, cmd);
+        if (handlers[cmd.op])
+            handlers[cmd.op](cmd);
+    }
+    return true;
+}
+
+size_t Routine::size() { return count; }
+
+const routine_cmd_t &Routine::get(size_t index) { return commands[index]; }
+
+void Routine::clear() { count = 0; }
+
+const char *Routine::op_name(uint8_t op) {
+    return op < E_ROUTINE_NUM_OPS ? op_names[op] : "unknown";
+}
@@ -0,0 +1,91 @@
+#include "Settle_Detector.hpp"
+#include <cmath>
+
+const settle_params_t Settle_Detector::DEFAULT_PARAMS = {
+    10,  // small_error, degrees
+    100, // small_time, ms
+    30,  // large_error, degrees
+    500, // large_time, ms
+    10,  // velocity_band, RPM
+    2,   // stall_velocity, RPM
+    300, // stall_time, ms
+    5000 // timeout, ms, so that a robot oscillating between the bands can't
+         // hold up a routine forever
+};
+
+Settle_Detector::Settle_Detector(const settle_params_t &params)
+    : params(params) {}
+
+void Settle_Detector::reset(const settle_params_t &params, uint32_t now) {
+    this->params = params;
+    start_time = now;
+    small_since = 0;
+    large_since = 0;
+    stall_since = 0;
+    exit_reason = E_SETTLE_NONE;
+}
+
+bool Settle_Detector::held_for(bool condition, uint32_t &since, uint32_t now,
+                               uint32_t dwell) {
+    if (!condition || !dwell) {
+        since = 0;
+        return false;
+    }
+    // now + 1, so that a condition that starts at time 0 is still tracked
+    if (!since)
+        since = now + 1;
+    return now + 1 - since >= dwell;
+}
+
+settle_exit_e_t Settle_Detector::update(double error, double velocity,
+                                        uint32_t now) {
+    if (exit_reason != E_SETTLE_NONE)
+        return exit_reason;
+
+    error = fabs(error);
+    velocity = fabs(velocity);
+    bool still = velocity < params.velocity_band;
+
+    // Both bands are always tracked, so that the small band wins if both
+    // become true on the same iteration
+    bool small = held_for(error < params.small_error && still, small_since,
+                          now, params.small_time);
+    bool large = held_for(error < params.large_error && still, large_since,
+                          now, params.large_time);
+    bool stalled = held_for(velocity < params.stall_velocity, stall_since, now,
+                            params.stall_time);
+
+    if (small)
+        exit_reason = E_SETTLE_SMALL_ERROR;
+    else if (large)
+        exit_reason = E_SETTLE_LARGE_ERROR;
+    else if (stalled && error >= params.large_error)
+        exit_reason = E_SETTLE_STALLED;
+    else if (params.timeout && now - start_time >= params.timeout)
+        exit_reason = E_SETTLE_TIMEOUT;
+
+    return exit_reason;
+}
+
+settle_exit_e_t Settle_Detector::get_exit_reason() const {
+    return exit_reason;
+}
+
+const char *Settle_Detector::exit_reason_name(settle_exit_e_t reason) {
+    switch (reason) {
+    case E_SETTLE_SMALL_ERROR:
+        return "small error";
+    case E_SETTLE_LARGE_ERROR:
+        return "large error";
+    case E_SETTLE_STALLED:
+        return "stalled";
+    case E_SETTLE_TIMEOUT:
+        return "timeout";
+    case E_SETTLE_SUPERSEDED:
+        return "superseded";
+    case E_SETTLE_CUT:
+        return "cut";
+    default:
+        return "running";
+    }
+}
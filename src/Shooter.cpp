@@ -0,0 +1,131 @@
+#include "Shooter.hpp"
+
+#include <cstdio>
+
+// How often the pipeline runs, in ms
+#define SHOOTER_PERIOD 10
+
+Shooter::Shooter(Intake &intake, Indexer &indexer, Flywheel &flywheel,
+                 Magazine &magazine)
+    : Subsystem("shooter", "Shooter Task", SHOOTER_PERIOD), intake(intake),
+      indexer(indexer), flywheel(flywheel), magazine(magazine) {}
+
+uint32_t Shooter::tick(uint32_t now) {
+    if (cancelled.exchange(false)) {
+        // The disk firing, if any, is let go, and the rest dropped
+        if (state == E_SHOOTER_FIRING)
+            shots_left = 1;
+        else
+            shots_left = 0;
+    }
+
+    switch (state) {
+    case E_SHOOTER_IDLE:
+        if (shots_left <= 0)
+            break;
+        if (!has_disk()) {
+            shots_left = 0;
+            break;
+        }
+        volley_start = now;
+        volley_shots = 0;
+        feed_start = now;
+        intake.in();
+        state = E_SHOOTER_FEEDING;
+        break;
+    case E_SHOOTER_FEEDING:
+        // The count only drops once the magazine has finished counting the
+        // last shot, which it does while the next disk feeds
+        if (shots_left <= 0 || (!magazine.is_counting_shot() && !has_disk())) {
+            end_volley(now);
+            break;
+        }
+        if (now - feed_start < feed_time)
+            break;
+        intake.stop();
+        if (magazine.is_counting_shot())
+            break;
+        if (flywheel.is_at_speed() || now - feed_start >= max_wait) {
+            indexer.fire(1);
+            state = E_SHOOTER_FIRING;
+        }
+        break;
+    case E_SHOOTER_FIRING:
+        if (!indexer.is_done())
+            break;
+        ++volley_shots;
+        --shots_left;
+        if (shots_left <= 0) {
+            end_volley(now);
+            break;
+        }
+        // Seats the next disk while the flywheel recovers
+        feed_start = now;
+        intake.in();
+        state = E_SHOOTER_FEEDING;
+        break;
+    }
+    return SHOOTER_PERIOD;
+}
+
+bool Shooter::has_disk() { return magazine.get_count() != 0; }
+
+void Shooter::end_volley(uint32_t now) {
+    intake.stop();
+    shots_left = 0;
+    state = E_SHOOTER_IDLE;
+    if (volley_shots > 0) {
+        uint32_t elapsed = now - volley_start;
+        printf("Shooter fired %d disks in %lu ms, %.2f disks/s\n",
+               volley_shots, (unsigned long)elapsed,
+               elapsed ? volley_shots * 1000.0 / elapsed : 0.0);
+    }
+}
+
+void Shooter::set_timing(uint32_t feed_time, uint32_t max_wait) {
+    this->feed_time = feed_time;
+    this->max_wait = max_wait;
+}
+
+void Shooter::shoot(int shots) {
+    if (shots > 0) {
+        cancelled = false;
+        shots_left += shots;
+    }
+}
+
+void Shooter::cancel() { cancelled = true; }
+
+bool Shooter::is_done() {
+    return shots_left <= 0 && state == E_SHOOTER_IDLE;
+}
+
+void Shooter::wait_until_done() {
+    while (!is_done())
+        pros::delay(SHOOTER_PERIOD);
+}
+
+shooter_state_e_t Shooter::get_state() { return state; }
+
+void Shooter::driver(const controller_snapshot_t &snapshot,
+                     pros::controller_digital_e_t shoot_btn) {
+    if (snapshot.is_pressed(shoot_btn)) {
+        if (magazine.get_count() == 0)
+            magazine.set_count(MAGAZINE_UNKNOWN);
+        shoot();
+    }
+    else if (!snapshot.is_held(shoot_btn) && !is_done())
+        cancel();
+}
+
+void Shooter::snapshot(subsystem_snapshot_t &snap) {
+    snap.state = state;
+    snap.target = shots_left;
+}
+
+void Shooter::safe_stop() {
+    cancelled = false;
+    shots_left = 0;
+    state = E_SHOOTER_IDLE;
+    intake.stop();
+}
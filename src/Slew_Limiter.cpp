@@ -0,0 +1,41 @@
+#include "Slew_Limiter.hpp"
+#include <cmath>
+
+void Slew_Limiter::set_rates(double accel, double decel) {
+    accel_rate = accel;
+    decel_rate = decel;
+}
+
+int Slew_Limiter::step(int target, uint32_t now) {
+    uint32_t dt = started ? now - last_time : 0;
+    if (dt > MAX_STEP_TIME)
+        dt = MAX_STEP_TIME;
+    last_time = now;
+    started = true;
+
+    double change = target - output;
+
+    // Speeding up if the output is moving away from 0, otherwise slowing down
+    bool accelerating = output == 0 || (change > 0) == (output > 0);
+    double rate = accelerating ? accel_rate : decel_rate;
+    if (rate > 0) {
+        double limit = rate * dt / 1000.0;
+        if (fabs(change) > limit)
+            change = copysign(limit, change);
+    }
+
+    double next = output + change;
+    if (!accelerating && output != 0 && (next > 0) != (output > 0))
+        next = 0;
+    output = next;
+
+    return lround(output);
+}
+
+void Slew_Limiter::reset(int value) { output = value; }
+
+int Slew_Limiter::get_output() const { return lround(output); }
+
+double Slew_Limiter::get_accel_rate() const { return accel_rate; }
+
+double Slew_Limiter::get_decel_rate() const { return decel_rate; }
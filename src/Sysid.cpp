@@ -0,0 +1,130 @@
+#include "Sysid.hpp"
+#include <cmath>
+#include <cstdio>
+
+void Sysid::set_quasistatic(double mv_per_sec, int max_mv) {
+    ramp_rate = mv_per_sec;
+    max_voltage = max_mv;
+}
+
+void Sysid::set_dynamic(int mv, uint32_t ms) {
+    step_voltage = mv;
+    step_duration = ms;
+}
+
+void Sysid::set_travel_limit(double limit) { travel_limit = limit; }
+
+void Sysid::clear() { sample_count = 0; }
+
+bool Sysid::run_test(sysid_test_e_t test, Motor_Group *const groups[],
+                     const char *const names[], size_t count) {
+    if (count > SYSID_MAX_GROUPS)
+        count = SYSID_MAX_GROUPS;
+
+    bool quasistatic =
+        test == E_SYSID_QUASISTATIC_FWD || test == E_SYSID_QUASISTATIC_REV;
+    int direction = 1;
+    if (test == E_SYSID_QUASISTATIC_REV || test == E_SYSID_DYNAMIC_REV)
+        direction = -1;
+
+    // Index of the first sample of this test, used so that acceleration is
+    // never calculated across two different tests
+    size_t first_sample = sample_count;
+    bool buffer_full = false;
+
+    double start_positions[SYSID_MAX_GROUPS];
+    for (size_t i = 0; i < count; ++i)
+        start_positions[i] = groups[i]->get_avg_position();
+
+    uint32_t start = pros::millis();
+    uint32_t now = start;
+    uint32_t elapsed = 0;
+
+    while (true) {
+        double voltage;
+        if (quasistatic) {
+            voltage = ramp_rate * elapsed / 1000.0;
+            if (voltage > max_voltage)
+                break;
+        } else {
+            voltage = step_voltage;
+            if (elapsed > step_duration)
+                break;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+            groups[i]->move_voltage(direction * voltage);
+
+        for (size_t i = 0; i < count; ++i) {
+            if (sample_count >= SYSID_LOG_CAPACITY) {
+                buffer_full = true;
+                break;
+            }
+
+            sample_t &s = samples[sample_count];
+            s.time = elapsed;
+            s.voltage = groups[i]->get_avg_voltage();
+            s.velocity = groups[i]->get_avg_velocity();
+            s.test = test;
+            s.group = names[i];
+
+            // Samples are interleaved by group, so the sample for this group
+            // ACCEL_WINDOW iterations ago is ACCEL_WINDOW * count entries back
+            size_t back = ACCEL_WINDOW * count;
+            if (sample_count - first_sample >= back) {
+                const sample_t &old = samples[sample_count - back];
+                s.accel = (s.velocity - old.velocity) /
+                          ((s.time - old.time) / 1000.0);
+            } else
+                s.accel = 0;
+
+            ++sample_count;
+        }
+        if (buffer_full)
+            break;
+
+        bool too_far = false;
+        for (size_t i = 0; i < count && travel_limit > 0; ++i)
+            if (fabs(groups[i]->get_avg_position() - start_positions[i]) >
+                travel_limit)
+                too_far = true;
+        if (too_far)
+            break;
+
+        pros::c::task_delay_until(&now, TIME_DELAY);
+        elapsed = now - start;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        groups[i]->brake();
+
+    return !buffer_full;
+}
+
+bool Sysid::save(const char *path) {
+    if (!pros::c::usd_is_installed())
+        return false;
+
+    FILE *log = fopen(path, "a");
+    if (!log)
+        return false;
+
+    static const char *test_names[] = {"quasistatic-fwd", "quasistatic-rev",
+                                       "dynamic-fwd", "dynamic-rev"};
+
+    // Only write the header if the file is new
+    fseek(log, 0, SEEK_END);
+    if (ftell(log) == 0)
+        fprintf(log, "test,group,time_ms,voltage_mv,velocity_rpm,"
+                     "accel_rpm_per_s\n");
+
+    for (size_t i = 0; i < sample_count; ++i) {
+        const sample_t &s = samples[i];
+        fprintf(log, "%s,%s,%lu,%.1f,%.3f,%.2f\n", test_names[s.test], s.group,
+                (unsigned long)s.time, s.voltage, s.velocity, s.accel);
+    }
+
+    fclose(log);
+    clear();
+    return true;
+}
@@ -0,0 +1,92 @@
+#include "Task_Stats.hpp"
+#include "Trace.hpp"
+#include "gui.h"
+
+#include <cstdio>
+
+Task_Stats *Task_Stats::first = nullptr;
+
+// Stops two tasks sampling at once, which would split one window in two
+static std::atomic<bool> sampling{false};
+
+Task_Stats::Task_Stats(const char *name, uint32_t period)
+    : name(name), period(period * 1000) {
+    // Every Task_Stats is a global or a member of one, so they are all added
+    // before any task starts
+    next = first;
+    first = this;
+}
+
+void Task_Stats::set_period(uint32_t period) { this->period = period * 1000; }
+
+Task_Stats::Scope::Scope(Task_Stats &stats)
+    : stats(stats), start(pros::c::micros()) {}
+
+Task_Stats::Scope::~Scope() { stop(); }
+
+void Task_Stats::Scope::stop() {
+    if (!running)
+        return;
+    running = false;
+    stats.add(start, pros::c::micros());
+}
+
+void Task_Stats::add(uint32_t start, uint32_t end) {
+    uint32_t elapsed = end - start;
+    busy += elapsed;
+    if (elapsed > max_busy)
+        max_busy = elapsed;
+    if (elapsed > period)
+        ++overruns;
+    ++iterations;
+    Trace::record_at(E_TRACE_TICK, elapsed, start);
+}
+
+void Task_Stats::sample(uint32_t now) {
+    uint32_t total = busy;
+    if (sample_time != 0 && now != sample_time)
+        cpu = 100.0f * (total - sample_busy) / (now - sample_time);
+    sample_busy = total;
+    sample_time = now;
+}
+
+void Task_Stats::sample_all() {
+    if (sampling.exchange(true))
+        return;
+    uint32_t now = pros::c::micros();
+    for (Task_Stats *stats = first; stats; stats = stats->next)
+        stats->sample(now);
+    sampling = false;
+}
+
+void Task_Stats::print_all() {
+    sample_all();
+    unsigned long now = pros::millis();
+    for (Task_Stats *stats = first; stats; stats = stats->next) {
+        uint32_t iterations = stats->iterations;
+        printf("T,%lu,%s,%lu,%.1f,%lu,%lu,%lu\n", now, stats->name,
+               (unsigned long)iterations, stats->cpu.load(),
+               (unsigned long)(iterations ? stats->busy / iterations : 0),
+               (unsigned long)stats->max_busy,
+               (unsigned long)stats->overruns);
+    }
+}
+
+void Task_Stats::format_all(char *buffer, size_t size) {
+    size_t used = snprintf(buffer, size, "%-12s %6s %7s %7s %5s\n", "task",
+                           "cpu", "avg us", "max us", "over");
+    for (Task_Stats *stats = first; stats && used < size;
+         stats = stats->next) {
+        uint32_t iterations = stats->iterations;
+        used += snprintf(
+            buffer + used, size - used, "%-12s %5.1f%% %7lu %7lu %5lu\n",
+            stats->name, stats->cpu.load(),
+            (unsigned long)(iterations ? stats->busy / iterations : 0),
+            (unsigned long)stats->max_busy, (unsigned long)stats->overruns);
+    }
+}
+
+void gui_task_stats_text(char *buffer, size_t size) {
+    Task_Stats::sample_all();
+    Task_Stats::format_all(buffer, size);
+}
@@ -0,0 +1,98 @@
+#include "Trace.hpp"
+#include "api.h"
+
+trace_record_t Trace::records[TRACE_SIZE];
+std::atomic<uint32_t> Trace::next{0};
+std::atomic<uint32_t> Trace::mask{0xffffffff};
+pros::task_t Trace::tasks[TRACE_MAX_TASKS];
+std::atomic<uint8_t> Trace::task_count{0};
+
+uint8_t Trace::task_id() {
+    pros::task_t current = pros::c::task_get_current();
+    uint8_t count = task_count;
+    for (uint8_t i = 0; i < count; ++i)
+        if (tasks[i] == current)
+            return i;
+
+    // Two new tasks may both get here at once, so the slot is claimed before
+    // it is filled. A task that looks before its slot is filled just gets a
+    // second one.
+    uint8_t id = task_count.fetch_add(1);
+    if (id >= TRACE_MAX_TASKS) {
+        task_count = TRACE_MAX_TASKS;
+        return TRACE_MAX_TASKS - 1;
+    }
+    tasks[id] = current;
+    return id;
+}
+
+void Trace::record(trace_event_e_t event, int32_t arg) {
+    record_at(event, arg, pros::c::micros());
+}
+
+void Trace::record_at(trace_event_e_t event, int32_t arg, uint32_t time) {
+    if (!(mask & (1u << event)))
+        return;
+    trace_record_t &r = records[next.fetch_add(1) % TRACE_SIZE];
+    r.time = time;
+    r.task = task_id();
+    r.event = event;
+    r.arg = arg;
+}
+
+void Trace::mark(int32_t arg) { record(E_TRACE_MARK, arg); }
+
+void Trace::delay(uint32_t ms) {
+    record(E_TRACE_DELAY_START, ms);
+    pros::delay(ms);
+    record(E_TRACE_DELAY_END, ms);
+}
+
+void Trace::set_mask(uint32_t mask) { Trace::mask = mask; }
+
+void Trace::clear() { next = 0; }
+
+size_t Trace::size() {
+    uint32_t count = next;
+    return count < TRACE_SIZE ? count : TRACE_SIZE;
+}
+
+void Trace::write(FILE *file) {
+    uint8_t count = task_count;
+    for (uint8_t i = 0; i < count && i < TRACE_MAX_TASKS; ++i)
+        fprintf(file, "N,%u,%s\n", (unsigned)i,
+                pros::c::task_get_name(tasks[i]));
+
+    uint32_t end = next;
+    uint32_t start = end > TRACE_SIZE ? end - TRACE_SIZE : 0;
+    for (uint32_t i = start; i < end; ++i) {
+        const trace_record_t &r = records[i % TRACE_SIZE];
+        fprintf(file, "R,%lu,%u,%u,%ld\n", (unsigned long)r.time,
+                (unsigned)r.task, (unsigned)r.event, (long)r.arg);
+    }
+}
+
+void Trace::print() { write(stdout); }
+
+bool Trace::save(const char *prefix) {
+    if (!pros::c::usd_is_installed())
+        return false;
+
+    char path[64];
+    for (int n = 0; n < 1000; ++n) {
+        snprintf(path, sizeof(path), "%s_%d.txt", prefix, n);
+        FILE *existing = fopen(path, "r");
+        if (existing) {
+            fclose(existing);
+            continue;
+        }
+
+        FILE *file = fopen(path, "w");
+        if (!file)
+            return false;
+        write(file);
+        fclose(file);
+        return true;
+    }
+    return false;
+}
@@ -1,5 +1,483 @@
+#include "Action_Graph.hpp"
+#include "Coroutine_Runner.hpp"
+#include "Routine.hpp"
 #include "main.h"
 
+#include <algorithm>
+
+// The length of the autonomous period, in ms
+#define AUTON_PERIOD 15000
+
+// How long each step of the match routine takes, in ms, from sim/routine_check.
+// Replace them with the step times Auton_Profiler measures on the robot.
+#define BACK_UP_TIME 3150
+#define TURN_TO_ROLLER_TIME 2500
+#define DRIVE_TO_ROLLER_TIME 2500
+#define SPIN_ROLLER_TIME 100
+#define DRIVE_TO_SHOT_TIME 1950
+#define AIM_PRELOADS_TIME 1250
+#define FIRE_PRELOADS_TIME (2 * INDEXER_SHOT_TIME)
+#define TURN_TO_MIDDLE_TIME 2800
+#define GUIDES_OPEN_TIME 5000
+#define BACK_OFF_TIME 2050
+#define LINE_UP_TIME 900
+#define INTAKE_DISKS_TIME 3950
+#define AIM_DISKS_TIME 2450
+#define FIRE_DISKS_TIME (3 * INDEXER_SHOT_TIME)
+
+// When the autonomous period ends, in ms since the program started
+static uint32_t auton_end;
+
+// Returns how long is left of the autonomous period, in ms
+static uint32_t time_left() {
+    int32_t left = (int32_t)(auton_end - pros::millis());
+    return left > 0 ? left : 0;
+}
+
+// Waits until done returns true or the period ends, returning whether it was
+// done
+static bool wait_for(action_check_fn_t done) {
+    while (!done()) {
+        if (!time_left())
+            return false;
+        pros::delay(10);
+    }
+    return true;
+}
+
+// The steps of the match routine, shared by the script, the action graph and
+// the coroutines so that the three stay the same routine. Each starts its
+// step without waiting for it.
+
+// Sets the magazine to the two preloads and spins the flywheel up for them
+static void start_match() {
+    magazine.set_count(2);
+    flywheel.set_target_velo(520);
+}
+
+static void start_back_up() { drive.move_straight(-24); }
+static void start_turn_to_roller() { drive.turn_angle(90); }
+static void start_drive_to_roller() { drive.move_straight(-10); }
+
+// When the roller started spinning, in ms
+static uint32_t roller_started;
+
+// Scores the roller by color if it has an optical sensor, or by turning it a
+// fixed amount
+static void start_roller() {
+    roller_started = pros::millis();
+    if (roller.has_color_sensor())
+        roller.start_color_spin(alliance_color);
+    else
+        roller.start_spin(-120);
+}
+
+// A roller held by the other robot gives up after ROLLER_SPIN_TIMEOUT, as
+// the color spin does on its own
+static bool is_roller_done() {
+    if (roller.has_color_sensor())
+        return roller.is_color_done();
+    return roller.is_spin_done() ||
+           pros::millis() - roller_started >= ROLLER_SPIN_TIMEOUT;
+}
+
+static void start_drive_to_shot() { drive.move_straight(4); }
+static void start_aim_preloads() { drive.turn_angle(12); }
+
+// The shooter waits for the flywheel to spin up before each shot
+static void start_fire_preloads() { shooter.shoot(); }
+
+static void pause_flywheel() { flywheel.pause_task(); }
+static void start_turn_to_middle() { drive.turn_angle(125); }
+
+// When the disk guides were opened, in ms
+static uint32_t guides_opened;
+
+static void open_guides() {
+    pros::c::adi_digital_write('b', true);
+    guides_opened = pros::millis();
+}
+
+static bool is_guides_open_done() {
+    return pros::millis() - guides_opened >= GUIDES_OPEN_TIME;
+}
+
+static void close_guides() { pros::c::adi_digital_write('b', false); }
+static void start_back_off() { drive.move_straight(-5); }
+static void start_line_up() { drive.turn_angle(-8); }
+
+// Runs the intake and spins the flywheel back up for the disks
+static void start_collect() {
+    intake.in();
+    flywheel.resume_task();
+    flywheel.set_target_velo(470);
+}
+
+static void start_intake_disks() { drive.move_straight(-60); }
+static void start_aim_disks() { drive.turn_angle(-80); }
+
+static void start_fire_disks() {
+    // The routine knows it drove through three disks, which is surer than
+    // the magazine's count until its thresholds are tuned
+    magazine.set_count(3);
+    shooter.shoot();
+}
+
+static bool is_motion_done() { return drive.is_motion_done(); }
+static bool is_volley_done() { return shooter.is_done(); }
+
+// Brings the drivetrain and the roller to rest and closes the disk guides,
+// for a routine cut short at the end of the period
+static void stop_driving() {
+    drive.stop_motion();
+    roller.stop();
+    close_guides();
+}
+
+// Stops everything the routine may have left running at the end of the period
+static void cut_off() {
+    stop_driving();
+    shooter.cancel();
+    intake.stop();
+}
+
+/**
+ * Runs the system identification tests on the drivetrain and the flywheel.
+ * The results are appended to /usd/sysid.csv, which is fitted on a computer
+ * by tools/sysid_fit.py to produce sysid_consts.hpp.
+ */
+static void run_characterization() {
+    // The log buffer is too large for the task's stack
+    static Sysid sysid;
+
+    sysid.set_quasistatic(500, 6000);
+    sysid.set_dynamic(7000, 1500);
+    drive.characterize(sysid, "/usd/sysid.csv");
+
+    sysid.set_quasistatic(500, 11000);
+    sysid.set_dynamic(12000, 3000);
+    flywheel.characterize(sysid, "/usd/sysid.csv");
+}
+
+typedef struct match_step_s {
+    const char *label;
+    action_fn_t start;
+    // Returns true once the step has finished, or null if it finishes as soon
+    // as it has started
+    action_check_fn_t done;
+    // How long the step takes, in ms
+    uint32_t estimate;
+} match_step_t;
+
+// The match routine as a list of steps, for run_match_script
+static const match_step_t match_steps[] = {
+    // Move to the roller and score it
+    {"back up", start_back_up, is_motion_done, BACK_UP_TIME},
+    {"turn to roller", start_turn_to_roller, is_motion_done,
+     TURN_TO_ROLLER_TIME},
+    {"drive to roller", start_drive_to_roller, is_motion_done,
+     DRIVE_TO_ROLLER_TIME},
+    {"spin roller", start_roller, is_roller_done, SPIN_ROLLER_TIME},
+
+    // Fire preloads into high goal
+    {"drive to shot", start_drive_to_shot, is_motion_done,
+     DRIVE_TO_SHOT_TIME},
+    {"aim preloads", start_aim_preloads, is_motion_done, AIM_PRELOADS_TIME},
+    {"fire preloads", start_fire_preloads, is_volley_done,
+     FIRE_PRELOADS_TIME},
+    {"flywheel off", pause_flywheel, nullptr, 0},
+
+    // Pick up 3 disks in middle
+    {"turn to middle", start_turn_to_middle, is_motion_done,
+     TURN_TO_MIDDLE_TIME},
+    {"open disk guides", open_guides, is_guides_open_done, GUIDES_OPEN_TIME},
+    {"close disk guides", close_guides, nullptr, 0},
+    {"back off", start_back_off, is_motion_done, BACK_OFF_TIME},
+    {"line up on disks", start_line_up, is_motion_done, LINE_UP_TIME},
+    {"intake and spin up", start_collect, nullptr, 0},
+    {"intake disks", start_intake_disks, is_motion_done, INTAKE_DISKS_TIME},
+
+    // Fire 3 disks
+    {"aim disks", start_aim_disks, is_motion_done, AIM_DISKS_TIME},
+    {"fire disks", start_fire_disks, is_volley_done, FIRE_DISKS_TIME}};
+
+/**
+ * Scores the roller, fires the preloads, then picks up the three disks in the
+ * middle and fires them, one step after another. Each step is timed by the
+ * profiler.
+ *
+ * A step that won't finish in the time left of the autonomous period is
+ * skipped along with the rest of the routine, as each step starts from where
+ * the one before it left the robot. A step still running at the end of the
+ * period is cut short.
+ */
+static void run_match_script() {
+    start_match();
+
+    for (const match_step_t &step : match_steps) {
+        if (time_left() < step.estimate) {
+            printf("Skipping %s and the steps after it\n", step.label);
+            break;
+        }
+        profiler.step(step.label);
+        step.start();
+        if (step.done && !wait_for(step.done)) {
+            printf("%s cut off\n", step.label);
+            cut_off();
+            break;
+        }
+    }
+    profiler.end();
+}
+
+/**
+ * Runs the same routine as run_match_script, as an action graph. The
+ * flywheel spins up while driving, each volley is fired as soon as the robot
+ * is aimed, and the intake runs alongside the drive to the disks.
+ *
+ * Each action has an estimate of its time and points, so that the graph skips
+ * the actions worth the least if the routine won't finish before the end of
+ * the autonomous period. Motions, the roller and volleys still running at the
+ * end of the period are stopped.
+ */
+static void run_match_graph(uint32_t deadline) {
+    static Action_Graph graph;
+    graph.clear();
+
+    // Adds a drivetrain motion that runs after another action
+    auto motion = [](const char *name, action_fn_t start, int after,
+                     uint32_t estimate) {
+        int node = graph.add(name, start, is_motion_done);
+        if (after >= 0)
+            graph.after(node, after);
+        graph.estimate(node, estimate);
+        graph.on_cutoff(node, [] { drive.stop_motion(); });
+        return node;
+    };
+
+    // Move to the roller and score it
+    graph.add("start", start_match);
+    int back_up = motion("back up", start_back_up, -1, BACK_UP_TIME);
+    int turn_roller = motion("turn to roller", start_turn_to_roller, back_up,
+                             TURN_TO_ROLLER_TIME);
+    int to_roller = motion("drive to roller", start_drive_to_roller,
+                           turn_roller, DRIVE_TO_ROLLER_TIME);
+    int spin_roller = graph.add("spin roller", start_roller, is_roller_done);
+    graph.after(spin_roller, to_roller);
+    graph.estimate(spin_roller, SPIN_ROLLER_TIME, 10);
+    graph.on_cutoff(spin_roller, [] { roller.stop(); });
+
+    // Fire preloads into high goal
+    int to_shot = motion("drive to shot", start_drive_to_shot, spin_roller,
+                         DRIVE_TO_SHOT_TIME);
+    int aim = motion("aim preloads", start_aim_preloads, to_shot,
+                     AIM_PRELOADS_TIME);
+    int preloads =
+        graph.add("fire preloads", start_fire_preloads, is_volley_done);
+    graph.after(preloads, aim);
+    graph.estimate(preloads, FIRE_PRELOADS_TIME, 10);
+    graph.on_cutoff(preloads, [] { shooter.cancel(); });
+    int coast = graph.add("flywheel off", pause_flywheel);
+    graph.after(coast, preloads);
+
+    // Pick up 3 disks in middle
+    int turn_middle = motion("turn to middle", start_turn_to_middle, preloads,
+                             TURN_TO_MIDDLE_TIME);
+    int opened = graph.add("open disk guides", open_guides);
+    graph.after(opened, turn_middle);
+    graph.hold(opened, GUIDES_OPEN_TIME);
+    graph.estimate(opened, GUIDES_OPEN_TIME);
+    int closed = graph.add("close disk guides", close_guides);
+    graph.after(closed, opened);
+    int back_off = motion("back off", start_back_off, closed, BACK_OFF_TIME);
+    int line_up =
+        motion("line up on disks", start_line_up, back_off, LINE_UP_TIME);
+    int collect = graph.add("intake and spin up", start_collect);
+    graph.after(collect, line_up);
+    int intake_disks = motion("intake disks", start_intake_disks, line_up,
+                              INTAKE_DISKS_TIME);
+
+    // Fire 3 disks
+    int aim_disks = motion("aim disks", start_aim_disks, intake_disks,
+                           AIM_DISKS_TIME);
+    int intake_off = graph.add("intake off", [] { intake.stop(); });
+    graph.after(intake_off, aim_disks);
+    int disks = graph.add("fire disks", start_fire_disks, is_volley_done);
+    graph.after(disks, aim_disks);
+    graph.after(disks, collect);
+    graph.estimate(disks, FIRE_DISKS_TIME, 15);
+    graph.on_cutoff(disks, [] { shooter.cancel(); });
+
+    graph.run(deadline);
+    graph.print();
+}
+
+// How far the coroutine match routine has got, for the coroutines to wait on
+// each other
+typedef enum match_phase_e {
+    E_PHASE_ROLLER = 0,
+    E_PHASE_PRELOADS,
+    E_PHASE_MIDDLE,
+    E_PHASE_COLLECT,
+    E_PHASE_DISKS,
+    E_PHASE_DONE
+} match_phase_e_t;
+
+static match_phase_e_t match_phase;
+
+// Drives the match routine, handing over to the shooter once aimed
+static bool drive_routine(co_context_t &co) {
+    CO_BEGIN(co);
+    // Move to the roller and score it
+    start_back_up();
+    CO_AWAIT(co, is_motion_done());
+    start_turn_to_roller();
+    CO_AWAIT(co, is_motion_done());
+    start_drive_to_roller();
+    CO_AWAIT(co, is_motion_done());
+    start_roller();
+    CO_AWAIT(co, is_roller_done());
+
+    // Aim the preloads
+    start_drive_to_shot();
+    CO_AWAIT(co, is_motion_done());
+    start_aim_preloads();
+    CO_AWAIT(co, is_motion_done());
+    match_phase = E_PHASE_PRELOADS;
+    CO_AWAIT(co, match_phase == E_PHASE_MIDDLE);
+
+    // Pick up 3 disks in middle
+    start_turn_to_middle();
+    CO_AWAIT(co, is_motion_done());
+    open_guides();
+    CO_DELAY(co, GUIDES_OPEN_TIME);
+    close_guides();
+    start_back_off();
+    CO_AWAIT(co, is_motion_done());
+    start_line_up();
+    CO_AWAIT(co, is_motion_done());
+    match_phase = E_PHASE_COLLECT;
+    start_intake_disks();
+    CO_AWAIT(co, is_motion_done());
+
+    // Aim the disks
+    start_aim_disks();
+    CO_AWAIT(co, is_motion_done());
+    match_phase = E_PHASE_DISKS;
+    CO_END(co);
+}
+
+// Fires each volley once the robot is aimed
+static bool shooter_routine(co_context_t &co) {
+    CO_BEGIN(co);
+    CO_AWAIT(co, match_phase == E_PHASE_PRELOADS);
+    start_fire_preloads();
+    CO_AWAIT(co, is_volley_done());
+    pause_flywheel();
+    match_phase = E_PHASE_MIDDLE;
+
+    CO_AWAIT(co, match_phase == E_PHASE_DISKS);
+    start_fire_disks();
+    CO_AWAIT(co, is_volley_done());
+    match_phase = E_PHASE_DONE;
+    CO_END(co);
+}
+
+// Runs the intake while driving through the disks and until they are aimed
+static bool intake_routine(co_context_t &co) {
+    CO_BEGIN(co);
+    CO_AWAIT(co, match_phase == E_PHASE_COLLECT);
+    start_collect();
+    CO_AWAIT(co, match_phase == E_PHASE_DISKS || magazine.is_full());
+    intake.stop();
+    CO_END(co);
+}
+
+/**
+ * Runs the same routine as run_match_script as three coroutines ticked from
+ * the autonomous task: one drives, one fires each volley once aimed, and one
+ * runs the intake. Whatever is still running at the end of the autonomous
+ * period is stopped.
+ */
+static void run_match_coroutines(uint32_t deadline) {
+    static Coroutine_Runner runner;
+    runner.clear();
+    match_phase = E_PHASE_ROLLER;
+
+    start_match();
+    int driving = runner.spawn("drive", drive_routine);
+    runner.on_cutoff(driving, stop_driving);
+    int shooting = runner.spawn("shooter", shooter_routine);
+    runner.on_cutoff(shooting, [] { shooter.cancel(); });
+    int intaking = runner.spawn("intake", intake_routine);
+    runner.on_cutoff(intaking, [] { intake.stop(); });
+    runner.run(deadline);
+    runner.print();
+}
+
+/**
+ * What each command of a routine loaded from the SD card does, indexed by
+ * routine_op_e_t. Each returns once its command has finished or the
+ * autonomous period has ended.
+ */
+static const routine_handler_t routine_handlers[E_ROUTINE_NUM_OPS] = {
+    // E_ROUTINE_STRAIGHT
+    [](const routine_cmd_t &cmd) {
+        drive.move_straight(cmd.arg);
+        wait_for(is_motion_done);
+    },
+    // E_ROUTINE_TURN
+    [](const routine_cmd_t &cmd) {
+        drive.turn_angle(cmd.arg);
+        wait_for(is_motion_done);
+    },
+    // E_ROUTINE_DELAY
+    [](const routine_cmd_t &cmd) {
+        Trace::delay(std::min((uint32_t)cmd.arg, time_left()));
+    },
+    // E_ROUTINE_FLYWHEEL
+    [](const routine_cmd_t &cmd) {
+        if (cmd.arg > 0) {
+            flywheel.resume_task();
+            flywheel.set_target_velo(cmd.arg);
+        } else
+            flywheel.pause_task();
+    },
+    // E_ROUTINE_WAIT_FLYWHEEL
+    [](const routine_cmd_t &cmd) {
+        uint32_t start = pros::millis();
+        while (!flywheel.is_at_speed() && pros::millis() - start < cmd.arg &&
+               time_left())
+            pros::delay(10);
+    },
+    // E_ROUTINE_PUNCH
+    [](const routine_cmd_t &cmd) {
+        indexer.fire(cmd.arg);
+        wait_for([] { return indexer.is_done(); });
+    },
+    // E_ROUTINE_INTAKE
+    [](const routine_cmd_t &cmd) {
+        if (cmd.arg > 0)
+            intake.in();
+        else if (cmd.arg < 0)
+            intake.out();
+        else
+            intake.stop();
+    },
+    // E_ROUTINE_ROLLER
+    [](const routine_cmd_t &cmd) {
+        uint32_t timeout =
+            std::min((uint32_t)ROLLER_SPIN_TIMEOUT, time_left());
+        if (cmd.arg > 0)
+            roller.clockwise(cmd.arg, timeout);
+        else
+            roller.counterclockwise(-cmd.arg, timeout);
+    },
+    // E_ROUTINE_PISTON
+    [](const routine_cmd_t &cmd) {
+        pros::c::adi_digital_write(cmd.port, cmd.arg != 0);
+    }};
+
 /**
  * Runs the user autonomous code. This function will be started in its own task
  * with the default priority and stack size whenever the robot is enabled via
@@ -12,10 +490,26 @@
  * from where it left off.
  */
 void autonomous() {
-    flywheel.resume_task();
-    drive.resume_pid_task();
+    // Match time is counted from here, so that the routine can finish
+    // scoring before the end of the period
+    auton_end = pros::millis() + AUTON_PERIOD;
+
+    if (auton_id == characterize) {
+        run_characterization();
+        return;
+    }
+
+    // The trace is saved at the end, for tools/trace_chrome.py
+    Trace::clear();
+    profiler.start();
+
+    subsystems.enable(E_SUBSYSTEM_AUTONOMOUS);
 
     drive.set_voltage_limit(6750);
+    // The driver control limits make the PID loop overshoot and oscillate
+    // at the current kP (see sim/drive_model), so motions are left unlimited
+    // until the limits are tuned together with the PID constants
+    drive.set_slew_rates(0, 0);
 
     // Drive PID tuning programs
     // Straight
@@ -67,64 +561,26 @@ void autonomous() {
     drive.wait_until_settled();
     */
 
-    // Move to the roller and score it
-    flywheel.set_target_velo(520);
-
-    drive.move_straight(-24);
-    drive.wait_until_settled();
-    drive.turn_angle(90);
-    drive.wait_until_settled();
-
-    drive.move_straight(-10);
-    drive.wait_until_settled();
-
-    roller.counterclockwise(120);
-
-    // Fire preloads into high goal
-    drive.move_straight(4);
-    drive.wait_until_settled();
-    drive.turn_angle(12);
-    drive.wait_until_settled();
-    pros::delay(1500);
-
-    indexer.punch_disk();
-    pros::delay(1000);
-    indexer.punch_disk();
-    pros::delay(1000);
-    flywheel.pause_task();
-
-    // Pick up 3 disks in middle
-    drive.turn_angle(125);
-    drive.wait_until_settled();
-
-    pros::c::adi_digital_write('b', true);
-
-    pros::delay(5000);
-
-    // Close solenoids for disk guides
-    pros::c::adi_digital_write('b', false);
-
-    drive.move_straight(-5);
-    drive.wait_until_settled();
-
-    drive.turn_angle(-8);
-    drive.wait_until_settled();
-
-    intake.in();
-    flywheel.resume_task();
-    flywheel.set_target_velo(470);
-
-    drive.move_straight(-60);
-    drive.wait_until_settled();
-
-    // Fire 3 disks
-    drive.turn_angle(-80);
-    drive.wait_until_settled();
-    pros::delay(3000);
-    intake.stop();
-    indexer.punch_disk();
-    indexer.punch_disk();
-    indexer.punch_disk();
+    // A routine on the SD card for the selected autonomous takes the place of
+    // the built-in one, so that it can be changed without uploading
+    static Routine routine;
+    if (routine.load(auton_id)) {
+        printf("Running /usd/auton_%d.rtn\n", (int)auton_id);
+        // A command still running at the end of the period returns early,
+        // and the rest are skipped
+        auto time_step = [](size_t, const routine_cmd_t &cmd) {
+            profiler.step(Routine::op_name(cmd.op));
+        };
+        bool finished = routine.run(routine_handlers, time_left(), time_step);
+        profiler.end();
+        if (!finished || !time_left())
+            cut_off();
+    } else if (auton_id == match_graph)
+        run_match_graph(time_left());
+    else if (auton_id == match_coroutines)
+        run_match_coroutines(time_left());
+    else
+        run_match_script();
 
     switch (auton_id) {
     case test:
@@ -145,6 +601,19 @@ void autonomous() {
         break;
     }
 
-    drive.pause_pid_task();
-    flywheel.pause_task();
+    // Everything is left at rest, as if the robot had been disabled
+    subsystems.safe_stop();
+
+    // Keep how well each motion went, for tools/motion_summary.py
+    Motion_Metrics &metrics = drive.get_metrics();
+    metrics.print();
+    metrics.save("/usd/motions");
+    metrics.clear();
+
+    Trace::save("/usd/trace");
+    Trace::clear();
+
+    // Flags the steps that have got slower than in /usd/steps_baseline.csv
+    profiler.report();
+    profiler.clear();
 }
\ No newline at end of file
@@ -4,12 +4,18 @@
 // LVGL objects
 lv_obj_t *pg_main;
 lv_obj_t *pg_auton;
+lv_obj_t *pg_stats;
 lv_obj_t *btn_main_to_auton;
 lv_obj_t *btn_auton_to_main;
+lv_obj_t *btn_main_to_stats;
+lv_obj_t *btn_stats_to_main;
 lv_obj_t *btnm_auton_select;
 lv_obj_t *lbl;
+lv_obj_t *lbl_auton;
+lv_obj_t *lbl_stats;
 lv_obj_t *bg_main;
 lv_obj_t *bg_auton;
+lv_obj_t *bg_stats;
 
 lv_style_t main_style;
 lv_style_t pg_style;
@@ -17,6 +23,10 @@ lv_style_t btn_style;
 lv_style_t btn_pr_style;
 lv_style_t btnm_btn_style;
 lv_style_t btnm_btn_pr_style;
+lv_style_t stats_style;
+
+// The text of the task stats table
+char stats_text[1024];
 
 enum auton auton_id = none;
 
@@ -28,12 +38,26 @@ lv_res_t show_auton_pg(lv_obj_t *btn) {
     lv_obj_set_hidden(bg_auton, false);
     return LV_RES_OK;
 }
+lv_res_t show_stats_pg(lv_obj_t *btn) {
+    lv_obj_set_hidden(bg_main, true);
+    lv_obj_set_hidden(bg_stats, false);
+    return LV_RES_OK;
+}
 lv_res_t show_main_pg(lv_obj_t *btn) {
     lv_obj_set_hidden(bg_main, false);
     lv_obj_set_hidden(bg_auton, true);
+    lv_obj_set_hidden(bg_stats, true);
     return LV_RES_OK;
 }
 
+// Samples the task stats once a second, whether or not they are shown, so
+// that each sample covers the same length of time
+void update_stats(void *param) {
+    gui_task_stats_text(stats_text, sizeof(stats_text));
+    if (!lv_obj_get_hidden(bg_stats))
+        lv_label_set_static_text(lbl_stats, stats_text);
+}
+
 const char *auton_display_map[] = {"Skills - Best",
                                    "Skills - Realistic",
                                    "\n",
@@ -41,28 +65,41 @@ const char *auton_display_map[] = {"Skills - Best",
                                    "Match - Realistic",
                                    "\n",
                                    "Test",
+                                   "Characterize",
                                    "None",
+                                   "\n",
+                                   "Match - Graph",
+                                   "Match - Coroutines",
                                    ""};
 
 lv_res_t auton_select_action(lv_obj_t *btnm, const char *text) {
     if (!strcmp(text, auton_display_map[0])) {
         auton_id = skills_best;
-        lv_label_set_text(lbl, text);
+        lv_label_set_text(lbl_auton, text);
     } else if (!strcmp(text, auton_display_map[1])) {
         auton_id = skills_real;
-        lv_label_set_text(lbl, text);
+        lv_label_set_text(lbl_auton, text);
     } else if (!strcmp(text, auton_display_map[3])) {
         auton_id = match_best;
-        lv_label_set_text(lbl, text);
+        lv_label_set_text(lbl_auton, text);
     } else if (!strcmp(text, auton_display_map[4])) {
         auton_id = match_real;
-        lv_label_set_text(lbl, text);
+        lv_label_set_text(lbl_auton, text);
     } else if (!strcmp(text, auton_display_map[6])) {
         auton_id = test;
-        lv_label_set_text(lbl, text);
+        lv_label_set_text(lbl_auton, text);
+    } else if (!strcmp(text, auton_display_map[7])) {
+        auton_id = characterize;
+        lv_label_set_text(lbl_auton, text);
+    } else if (!strcmp(text, auton_display_map[10])) {
+        auton_id = match_graph;
+        lv_label_set_text(lbl_auton, text);
+    } else if (!strcmp(text, auton_display_map[11])) {
+        auton_id = match_coroutines;
+        lv_label_set_text(lbl_auton, text);
     } else {
         auton_id = none;
-        lv_label_set_text(lbl, text);
+        lv_label_set_text(lbl_auton, text);
     }
     return LV_RES_OK;
 }
@@ -101,6 +138,9 @@ void gui_init() {
     btnm_btn_pr_style.body.border.width = 0;
     btnm_btn_pr_style.body.padding.inner = 5;
 
+    lv_style_copy(&stats_style, &main_style);
+    stats_style.text.font = &pros_font_dejavu_mono_10;
+
     // Generate backgrounds for each menu - these are the parent objects for
     // each menu
     bg_main = lv_img_create(lv_scr_act(), NULL);
@@ -111,6 +151,10 @@ void gui_init() {
     lv_img_set_src(bg_auton, &eagle_screech_brain_screen_dark);
     lv_obj_align(bg_auton, NULL, LV_ALIGN_CENTER, 0, 0);
 
+    bg_stats = lv_img_create(lv_scr_act(), NULL);
+    lv_img_set_src(bg_stats, &eagle_screech_brain_screen_dark);
+    lv_obj_align(bg_stats, NULL, LV_ALIGN_CENTER, 0, 0);
+
     // Each page acts as the parent for all interactable elements, but it is a
     // child to the background so that the image is behind everything else -
     // also, the image doesn't scroll.
@@ -124,7 +168,13 @@ void gui_init() {
     lv_obj_align(pg_auton, NULL, LV_ALIGN_CENTER, 0, 0);
     lv_page_set_style(pg_auton, LV_PAGE_STYLE_BG, &pg_style);
 
+    pg_stats = lv_page_create(bg_stats, NULL);
+    lv_obj_set_size(pg_stats, 480, 240);
+    lv_obj_align(pg_stats, NULL, LV_ALIGN_CENTER, 0, 0);
+    lv_page_set_style(pg_stats, LV_PAGE_STYLE_BG, &pg_style);
+
     lv_obj_set_hidden(bg_auton, true);
+    lv_obj_set_hidden(bg_stats, true);
 
     btn_main_to_auton = lv_btn_create(pg_main, NULL);
     lv_btn_set_action(btn_main_to_auton, LV_BTN_ACTION_CLICK, show_auton_pg);
@@ -136,6 +186,17 @@ void gui_init() {
     lv_obj_align(lbl, NULL, LV_ALIGN_CENTER, 0, 0);
     lv_label_set_text(lbl, "Auton Menu");
 
+    btn_main_to_stats = lv_btn_create(pg_main, NULL);
+    lv_btn_set_action(btn_main_to_stats, LV_BTN_ACTION_CLICK, show_stats_pg);
+    lv_obj_align(btn_main_to_stats, btn_main_to_auton,
+                 LV_ALIGN_OUT_BOTTOM_LEFT, 0, 10);
+    lv_btn_set_style(btn_main_to_stats, LV_BTN_STYLE_REL, &btn_style);
+    lv_btn_set_style(btn_main_to_stats, LV_BTN_STYLE_PR, &btn_pr_style);
+
+    lbl = lv_label_create(btn_main_to_stats, NULL);
+    lv_obj_align(lbl, NULL, LV_ALIGN_CENTER, 0, 0);
+    lv_label_set_text(lbl, "Task Stats");
+
     btn_auton_to_main = lv_btn_create(pg_auton, NULL);
     lv_btn_set_action(btn_auton_to_main, LV_BTN_ACTION_CLICK, show_main_pg);
     lv_obj_align(btn_auton_to_main, NULL, LV_ALIGN_IN_LEFT_MID, 0, 0);
@@ -158,7 +219,24 @@ void gui_init() {
 
     lv_btnm_set_action(btnm_auton_select, auton_select_action);
 
-    lbl = lv_label_create(pg_auton, NULL);
-    lv_obj_align(lbl, NULL, LV_ALIGN_IN_BOTTOM_LEFT, 0, 0);
-    lv_label_set_text(lbl, "None");
+    lbl_auton = lv_label_create(pg_auton, NULL);
+    lv_obj_align(lbl_auton, NULL, LV_ALIGN_IN_BOTTOM_LEFT, 0, 0);
+    lv_label_set_text(lbl_auton, "None");
+
+    btn_stats_to_main = lv_btn_create(pg_stats, NULL);
+    lv_btn_set_action(btn_stats_to_main, LV_BTN_ACTION_CLICK, show_main_pg);
+    lv_obj_align(btn_stats_to_main, NULL, LV_ALIGN_IN_BOTTOM_LEFT, 0, 0);
+    lv_btn_set_style(btn_stats_to_main, LV_BTN_STYLE_REL, &btn_style);
+    lv_btn_set_style(btn_stats_to_main, LV_BTN_STYLE_PR, &btn_pr_style);
+
+    lbl = lv_label_create(btn_stats_to_main, NULL);
+    lv_obj_align(lbl, NULL, LV_ALIGN_CENTER, 0, 0);
+    lv_label_set_text(lbl, "Main Menu");
+
+    lbl_stats = lv_label_create(pg_stats, NULL);
+    lv_obj_set_style(lbl_stats, &stats_style);
+    lv_obj_align(lbl_stats, NULL, LV_ALIGN_IN_TOP_LEFT, 0, 0);
+    lv_label_set_static_text(lbl_stats, "");
+
+    lv_task_create(update_stats, 1000, LV_TASK_PRIO_LOW, NULL);
 }
@@ -1,11 +1,33 @@
 #include "Indexer.hpp"
 #include "main.h"
+#include "sysid_consts.hpp"
 Drivetrain drive({11, 12}, {13, 16}, {true, true}, {false, false});
 // Drivetrain drive({6}, {8}, {true}, {false});
 Intake intake({7}, {false});
 Flywheel flywheel({6}, {true});
 Indexer indexer({19}, {false});
 Roller roller({5}, {true}, 1);
+Magazine magazine(intake, indexer, flywheel);
+Shooter shooter(intake, indexer, flywheel, magazine);
+
+Controller_Service master(pros::E_CONTROLLER_MASTER);
+Power_Manager power;
+Health_Monitor health;
+
+// Every mechanism and every service with a task, so that they can be
+// started, readied, stopped and logged together. The controller comes first,
+// so that its readings are there once driver control starts. The shooter
+// comes before the intake and indexer it drives, so that it has stopped
+// asking them for more by the time they are stopped.
+Subsystems subsystems(master, drive, flywheel, shooter, magazine, intake,
+                      indexer, roller, power, health);
+
+// The color the roller's optical sensor sees once the roller is scored for
+// our alliance. Set before each match.
+roller_color_e_t alliance_color = E_ROLLER_RED;
+
+// Times each step of the autonomous routine
+Auton_Profiler profiler(drive);
 /**
  * Runs initialization code. This occurs as soon as the program is started.
  *
@@ -21,12 +43,58 @@ void initialize() {
     //  drive.add_adi_encoders('e', 'f', false, 'g', 'h', false);
     drive.set_pid_consts(600, 0, 0);
     drive.set_settled_threshold(10);
-    drive.init_pid_task();
-    drive.pause_pid_task();
+    // Each side has two motors, so a reset or skipped encoder can't be
+    // outvoted, and is caught by how far it moves instead
+    drive.get_left_motors().set_aggregation(
+        E_MOTOR_GROUP_AGGREGATE_REJECT_JUMPS);
+    drive.get_right_motors().set_aggregation(
+        E_MOTOR_GROUP_AGGREGATE_REJECT_JUMPS);
+    drive.set_velocity_consts({DRIVE_LEFT_KS, DRIVE_LEFT_KV, DRIVE_LEFT_KA},
+                              {DRIVE_RIGHT_KS, DRIVE_RIGHT_KV, DRIVE_RIGHT_KA},
+                              10, 0, 0, 600, 6000);
+
+    flywheel.set_consts(FLYWHEEL_KS, FLYWHEEL_KV, 2, 0);
+
+    // Each queued shot waits for the flywheel to recover from the last, for
+    // up to a second
+    indexer.set_gate({[] { return flywheel.is_at_speed(); }, 0, 1000});
+    // No optical sensor is fitted to the roller yet, so it is turned a fixed
+    // amount, e.g.
+    // roller.set_optical_sensor(4);
+    // A jammed disk is run out for a quarter of a second, up to three times
+    intake.set_jam_handling(250, 3);
 
-    flywheel.set_consts(1047, 20.0128, 2, 0);
-    flywheel.init_task();
-    flywheel.pause_task();
+    // No sensors are fitted yet, so the magazine counts from the intake's
+    // current and the flywheel's dips, e.g.
+    // magazine.set_distance_sensor(3, 120, 15);
+    // magazine.set_optical_sensor(4, 150);
+
+    // Flywheel recovery between shots matters most, then moving and indexing.
+    // The intake and roller can wait, though the intake is never limited so
+    // far that a jam can't be detected.
+    power.add_group("flywheel", &flywheel.get_motors(), 3, 1500);
+    power.add_group("drive_left", &drive.get_left_motors(), 2);
+    power.add_group("drive_right", &drive.get_right_motors(), 2);
+    power.add_group("indexer", &indexer.get_motors(), 2);
+    power.add_group("intake", &intake.get_motors(), 1,
+                    intake.get_jam_current_limit());
+    power.add_group("roller", &roller.get_motors(), 1);
+    // Leaves some margin below the 20 A the brain can supply to every motor.
+    // Nothing is limited until the motors draw close to this between them.
+    power.set_budget(16000);
+
+    health.add_group("drive_left", &drive.get_left_motors());
+    health.add_group("drive_right", &drive.get_right_motors());
+    health.add_group("flywheel", &flywheel.get_motors());
+    health.add_group("indexer", &indexer.get_motors());
+    health.add_group("intake", &intake.get_motors());
+    health.add_group("roller", &roller.get_motors());
+
+    // Every subsystem starts at rest, until autonomous or driver control
+    // gives it something to do. The groups are added first, as the power
+    // manager and health monitor only take them before their tasks start.
+    subsystems.init_tasks();
+    subsystems.safe_stop();
 
     // beginning expansion
     pros::c::adi_port_set_config('b', pros::E_ADI_DIGITAL_OUT);
@@ -40,8 +108,31 @@ void initialize() {
  * the robot is enabled, this task will exit.
  */
 void disabled() {
-    drive.pause_pid_task();
-    flywheel.pause_task();
+    subsystems.safe_stop();
+
+    // When the field ends autonomous before the routine finishes, the motion
+    // metrics are saved here instead, along with the motion that was cut
+    // short. The drive task has been paused, so it can't race the cut.
+    Motion_Metrics &metrics = drive.get_metrics();
+    metrics.cut(pros::millis());
+    if (metrics.size()) {
+        metrics.print();
+        metrics.save("/usd/motions");
+        metrics.clear();
+    }
+    // and so is the trace, which is too long to print
+    if (Trace::size()) {
+        Trace::save("/usd/trace");
+        Trace::clear();
+    }
+    // and the step table, which matters most for a routine that ran long
+    if (profiler.size()) {
+        profiler.report();
+        profiler.clear();
+    }
+
+    Task_Stats::print_all();
+    subsystems.print_snapshots();
 }
 
 /**
@@ -1,4 +1,16 @@
 #include "main.h"
+#include "sysid_consts.hpp"
+
+// The drive stick curve, built at compile time
+static constexpr Input_Curve drive_curve = Input_Curve::poly(1.3);
+
+// Velocity control needs the drivetrain's feedforward constants, so the
+// open-loop tank driver is used until the drivetrain has been characterized
+static constexpr bool use_velocity_driver =
+    DRIVE_LEFT_KV > 0 && DRIVE_RIGHT_KV > 0;
+
+// Times the driver loop, from each controller reading to the next wait
+static Task_Stats opcontrol_stats("opcontrol", 5);
 
 /**
  * Runs the operator control code. This function will be started in its own task
@@ -14,37 +26,56 @@
  * task, not resume it from where it left off.
  */
 void opcontrol() {
-    drive.pause_pid_task();
-    flywheel.resume_task();
+    subsystems.enable(E_SUBSYSTEM_DRIVER);
 
     flywheel.set_speed_slow();
 
     pros::c::adi_digital_write('b', true);
     drive.set_voltage_limit(12000);
+    // 0 to full power in 250 ms, and back to 0 in 125 ms
+    drive.set_slew_rates(48000, 96000);
+    drive.set_input_curve(pros::E_CONTROLLER_ANALOG_LEFT_Y, drive_curve);
+    drive.set_input_curve(pros::E_CONTROLLER_ANALOG_RIGHT_Y, drive_curve);
 
     bool endgame_primed = false;
+    controller_snapshot_t ctrl = {};
 
     while (true) {
-        drive.tank_driver_poly(pros::E_CONTROLLER_MASTER, 1.3,
-                               pros::E_CONTROLLER_DIGITAL_RIGHT);
-        flywheel.driver(pros::E_CONTROLLER_MASTER, pros::E_CONTROLLER_DIGITAL_A,
+        // Runs once per controller reading, and sees every button pressed
+        // since the last loop even if it fell behind, so that no press is
+        // missed or acted on twice
+        ctrl = master.wait_next(ctrl);
+        Task_Stats::Scope timer(opcontrol_stats);
+
+        if (use_velocity_driver)
+            drive.velocity_driver(ctrl, pros::E_CONTROLLER_DIGITAL_RIGHT);
+        else
+            drive.tank_driver(ctrl, pros::E_CONTROLLER_DIGITAL_RIGHT);
+        flywheel.driver(ctrl, pros::E_CONTROLLER_DIGITAL_A,
                         pros::E_CONTROLLER_DIGITAL_B);
-        indexer.driver(pros::E_CONTROLLER_MASTER, pros::E_CONTROLLER_DIGITAL_L1,
-                       pros::E_CONTROLLER_DIGITAL_L2);
-        intake.driver(pros::E_CONTROLLER_MASTER, pros::E_CONTROLLER_DIGITAL_R1,
-                      pros::E_CONTROLLER_DIGITAL_R2);
-        roller.driver(pros::E_CONTROLLER_MASTER, pros::E_CONTROLLER_DIGITAL_UP,
+        // Holding L1 feeds, waits for the flywheel and fires one disk after
+        // another. The intake and indexer are left to the shooter until it
+        // is done.
+        shooter.driver(ctrl, pros::E_CONTROLLER_DIGITAL_L1);
+        if (shooter.is_done()) {
+            indexer.driver(ctrl, pros::E_CONTROLLER_DIGITAL_LEFT,
+                           pros::E_CONTROLLER_DIGITAL_L2);
+            // Holding a fourth disk is a foul, so intaking stops once the
+            // magazine is full. Expelling still works.
+            if (magazine.is_full() &&
+                ctrl.is_held(pros::E_CONTROLLER_DIGITAL_R1))
+                intake.stop();
+            else
+                intake.driver(ctrl, pros::E_CONTROLLER_DIGITAL_R1,
+                              pros::E_CONTROLLER_DIGITAL_R2);
+        }
+        roller.driver(ctrl, pros::E_CONTROLLER_DIGITAL_UP,
                       pros::E_CONTROLLER_DIGITAL_DOWN);
 
-        if (pros::c::controller_get_digital_new_press(
-                pros::E_CONTROLLER_MASTER, pros::E_CONTROLLER_DIGITAL_X))
+        if (ctrl.is_pressed(pros::E_CONTROLLER_DIGITAL_X))
             endgame_primed = true;
-        if (pros::c::controller_get_digital_new_press(
-                pros::E_CONTROLLER_MASTER, pros::E_CONTROLLER_DIGITAL_Y) &&
-            endgame_primed)
+        if (ctrl.is_pressed(pros::E_CONTROLLER_DIGITAL_Y) && endgame_primed)
             pros::c::adi_digital_write('d', true);
-
-        pros::delay(2);
     }
     flywheel.end_task();
     drive.end_pid_task();
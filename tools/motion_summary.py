@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""
+Summarizes the motion metrics recorded by Drivetrain (see
+include/Motion_Metrics.hpp) across several runs of the same autonomous
+routine.
+
+Each input is either a /usd/motions_<n>.csv file from the SD card or a saved
+terminal capture, which may hold several runs mixed in with other output.
+Every metrics header line starts a new run. Motions are matched between runs
+by their position in the routine, so only runs of the same routine should be
+summarized together.
+
+For each motion, the mean, standard deviation, minimum and maximum of every
+metric are printed, along with how often each exit reason occurred. With
+--baseline, the means are compared against an earlier set of runs, and any
+motion that got worse by more than the threshold, or that ended differently,
+is flagged. The exit status is 1 if anything was flagged.
+
+Usage:
+    python3 tools/motion_summary.py motions_0.csv [more ...]
+        [--baseline old.csv ...] [--threshold percent]
+"""
+
+import argparse
+import math
+import sys
+
+# Every header starts with this. Files from before a column was added have
+# fewer columns, and the metrics they lack are skipped.
+HEADER_START = "motion,type,amount,"
+
+# The metrics summarized for each motion, and their units. Higher is worse
+# for all of them.
+METRICS = [
+    ("rise_ms", "ms"),
+    ("settle_ms", "ms"),
+    ("overshoot", "deg"),
+    ("steady_state_error", "deg"),
+    ("peak_current_ma", "mA"),
+    ("peak_slip", "deg"),
+]
+
+# The exit reason of a motion that ended normally
+GOOD_EXIT = "small error"
+
+
+def load(paths):
+    """Returns every run in the files, as a list of lists of row dicts."""
+    runs = []
+    for path in paths:
+        with open(path) as f:
+            run = None
+            names = []
+            for line in f:
+                line = line.strip()
+                if line.startswith(HEADER_START):
+                    names = line.split(",")
+                    run = []
+                    runs.append(run)
+                    continue
+                fields = line.split(",")
+                if run is None or len(fields) != len(names):
+                    continue
+                try:
+                    row = dict(zip(names, fields))
+                    for name, _ in METRICS:
+                        if name in row:
+                            row[name] = float(row[name])
+                    row["motion"] = int(row["motion"])
+                    row["amount"] = float(row["amount"])
+                except ValueError:
+                    continue
+                run.append(row)
+    return [run for run in runs if run]
+
+
+def summarize(runs):
+    """Groups the motions of every run by their position in the routine."""
+    motions = {}
+    for run in runs:
+        for row in run:
+            key = (row["motion"], row["type"], row["amount"])
+            motions.setdefault(key, []).append(row)
+    return motions
+
+
+def stats(values):
+    n = len(values)
+    mean = sum(values) / n
+    std = math.sqrt(sum((v - mean) ** 2 for v in values) / (n - 1)) \
+        if n > 1 else 0.0
+    return mean, std, min(values), max(values)
+
+
+def exits(rows):
+    counts = {}
+    for row in rows:
+        counts[row["exit_reason"]] = counts.get(row["exit_reason"], 0) + 1
+    return ", ".join("%s x%d" % (reason, n)
+                     for reason, n in sorted(counts.items()))
+
+
+def print_summary(motions, run_count):
+    print("%d run(s), %d motion(s)\n" % (run_count, len(motions)))
+    for key in sorted(motions):
+        rows = motions[key]
+        index, kind, amount = key
+        print("#%d %s %g  (%d sample(s); exits: %s)" %
+              (index, kind, amount, len(rows), exits(rows)))
+        for name, unit in METRICS:
+            if not all(name in row for row in rows):
+                continue
+            mean, std, low, high = stats([row[name] for row in rows])
+            print("    %-20s %10.2f +/- %-8.2f [%.2f, %.2f] %s" %
+                  (name, mean, std, low, high, unit))
+
+
+def compare(motions, baseline, threshold):
+    """Returns a list of regressions against the baseline motions."""
+    flags = []
+    for key in sorted(motions):
+        if key not in baseline:
+            continue
+        index, kind, amount = key
+        label = "#%d %s %g" % (index, kind, amount)
+        rows, old_rows = motions[key], baseline[key]
+
+        for name, unit in METRICS:
+            if not all(name in row for row in rows + old_rows):
+                continue
+            mean = stats([row[name] for row in rows])[0]
+            old_mean, old_std = stats([row[name] for row in old_rows])[:2]
+            # A change smaller than the run-to-run noise isn't a regression
+            allowed = max(abs(old_mean) * threshold / 100, old_std)
+            if mean - old_mean > allowed:
+                flags.append("%s: %s %.2f -> %.2f %s" %
+                             (label, name, old_mean, mean, unit))
+
+        good = sum(row["exit_reason"] == GOOD_EXIT for row in rows)
+        old_good = sum(row["exit_reason"] == GOOD_EXIT for row in old_rows)
+        if good / len(rows) < old_good / len(old_rows):
+            flags.append("%s: exits %s -> %s" %
+                         (label, exits(old_rows), exits(rows)))
+    return flags
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("logs", nargs="+",
+                        help="metrics files or terminal captures")
+    parser.add_argument("--baseline", nargs="+", default=[],
+                        help="earlier runs to compare against")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="how much worse a mean may get before it is "
+                        "flagged, in percent (default: %(default)s)")
+    args = parser.parse_args()
+
+    runs = load(args.logs)
+    if not runs:
+        sys.exit("no motion metrics in " + ", ".join(args.logs))
+    motions = summarize(runs)
+    print_summary(motions, len(runs))
+
+    if not args.baseline:
+        return
+    baseline_runs = load(args.baseline)
+    if not baseline_runs:
+        sys.exit("no motion metrics in " + ", ".join(args.baseline))
+
+    flags = compare(motions, summarize(baseline_runs), args.threshold)
+    print("\n%d regression(s) against %d baseline run(s)" %
+          (len(flags), len(baseline_runs)))
+    for flag in flags:
+        print("    " + flag)
+    if flags:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Compiles an autonomous routine written as text into the binary command list
+read by the robot (see include/Routine.hpp).
+
+Each line is one command, and everything after a # is a comment:
+
+    straight <inches>          drive straight, then wait until settled
+    turn <degrees>             turn on the spot, then wait until settled
+    delay <ms>                 wait
+    flywheel <rpm>             set the flywheel's target, or stop it with 0
+    wait_flywheel <ms>         wait for the flywheel to reach its target, for
+                               at most the given time
+    punch <n>                  fire n disks
+    intake in|out|stop         run the intake
+    roller <degrees>           spin the roller, positive clockwise
+    piston <port> on|off       extend or retract the piston on ADI port a-h
+
+The output is written for the autonomous selection given with --auton, as
+auton_<n>.rtn where n is the selection's value in enum auton (include/gui.h).
+Copy it to the root of the SD card, i.e. /usd/auton_<n>.rtn on the robot,
+and it runs in place of that selection's built-in routine.
+
+Usage:
+    python3 tools/routine_compile.py routine.txt --auton match_real [-o out]
+"""
+
+import argparse
+import struct
+import sys
+
+# The enum auton values, from include/gui.h
+AUTONS = ["none", "skills_best", "skills_real", "match_best", "match_real",
+          "test", "characterize", "match_graph", "match_coroutines"]
+
+# The routine_op_e_t values, from include/Routine.hpp
+OPS = ["straight", "turn", "delay", "flywheel", "wait_flywheel", "punch",
+       "intake", "roller", "piston"]
+
+# ROUTINE_MAGIC and ROUTINE_MAX_COMMANDS, from include/Routine.hpp
+MAGIC = b"RTN1"
+MAX_COMMANDS = 128
+
+INTAKE_ARGS = {"in": 1, "out": -1, "stop": 0}
+PISTON_ARGS = {"on": 1, "off": 0, "1": 1, "0": 0}
+
+
+class RoutineError(Exception):
+    pass
+
+
+def number(word, integer=False, positive=False):
+    try:
+        value = int(word) if integer else float(word)
+    except ValueError:
+        raise RoutineError("%r is not a%s number" %
+                           (word, "n integer" if integer else ""))
+    if positive and value < 0:
+        raise RoutineError("%r must not be negative" % word)
+    return value
+
+
+def parse_line(words):
+    """Returns the (op, port, arg) of one command."""
+    op = words[0]
+    if op not in OPS:
+        raise RoutineError("unknown command %r" % op)
+    args = words[1:]
+    expected = 2 if op == "piston" else 1
+    if len(args) != expected:
+        raise RoutineError("%s takes %d argument%s" %
+                           (op, expected, "s" if expected > 1 else ""))
+
+    port = 0
+    if op in ("straight", "turn", "roller"):
+        arg = number(args[0])
+    elif op in ("delay", "flywheel", "wait_flywheel"):
+        arg = number(args[0], positive=True)
+    elif op == "punch":
+        arg = number(args[0], integer=True, positive=True)
+    elif op == "intake":
+        if args[0] not in INTAKE_ARGS:
+            raise RoutineError("intake takes in, out or stop")
+        arg = INTAKE_ARGS[args[0]]
+    else:
+        letter = args[0].lower()
+        if len(letter) != 1 or not "a" <= letter <= "h":
+            raise RoutineError("%r is not an ADI port a-h" % args[0])
+        if args[1] not in PISTON_ARGS:
+            raise RoutineError("piston takes on or off")
+        port = ord(letter)
+        arg = PISTON_ARGS[args[1]]
+    return OPS.index(op), port, arg
+
+
+def parse(lines):
+    """Returns the commands in the routine. Raises RoutineError with the line
+    number of the first mistake."""
+    commands = []
+    for line_number, line in enumerate(lines, 1):
+        words = line.split("#")[0].split()
+        if not words:
+            continue
+        try:
+            commands.append(parse_line(words))
+        except RoutineError as e:
+            raise RoutineError("line %d: %s" % (line_number, e))
+    if len(commands) > MAX_COMMANDS:
+        raise RoutineError("%d commands, but the robot holds at most %d" %
+                           (len(commands), MAX_COMMANDS))
+    return commands
+
+
+def encode(commands):
+    data = MAGIC + struct.pack("<HH", len(commands), 0)
+    for op, port, arg in commands:
+        data += struct.pack("<BBHf", op, port, 0, arg)
+    return data
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("routine", help="routine written as text")
+    parser.add_argument("--auton", required=True, choices=AUTONS,
+                        help="the autonomous selection the routine replaces")
+    parser.add_argument("-o", "--output",
+                        help="where to write the compiled routine "
+                        "(default: auton_<n>.rtn)")
+    args = parser.parse_args()
+
+    with open(args.routine) as f:
+        try:
+            commands = parse(f)
+        except RoutineError as e:
+            sys.exit("%s: %s" % (args.routine, e))
+
+    output = args.output or "auton_%d.rtn" % AUTONS.index(args.auton)
+    with open(output, "wb") as f:
+        f.write(encode(commands))
+    print("%d commands written to %s" % (len(commands), output))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""
+Fits feedforward constants to the system identification data logged by
+Drivetrain::characterize and Flywheel::characterize (see include/Sysid.hpp).
+
+For each motor group in the log, the model
+
+    V = kS * sgn(v) + kV * v + kA * a
+
+is fitted to every sample by ordinary least squares, where V is the voltage in
+mV, v is the velocity in RPM and a is the acceleration in RPM per second. The
+constants are written to a C header, which is include/sysid_consts.hpp by
+default. Groups that are not in the log keep the values already in the header.
+
+Usage:
+    python3 tools/sysid_fit.py sysid.csv [more.csv ...] [-o header]
+"""
+
+import argparse
+import csv
+import math
+import os
+import re
+import sys
+
+# The prefix used for each group's constants in the generated header
+GROUP_PREFIXES = {
+    "flywheel": "FLYWHEEL",
+    "drive_left": "DRIVE_LEFT",
+    "drive_right": "DRIVE_RIGHT",
+}
+
+DEFAULT_HEADER = os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), "..", "include",
+    "sysid_consts.hpp")
+
+
+def sign(x):
+    return (x > 0) - (x < 0)
+
+
+def solve(a, b):
+    """Solves a * x = b for a small dense matrix by Gaussian elimination."""
+    n = len(b)
+    m = [row[:] + [b[i]] for i, row in enumerate(a)]
+    for col in range(n):
+        pivot = max(range(col, n), key=lambda r: abs(m[r][col]))
+        if abs(m[pivot][col]) < 1e-12:
+            raise ValueError("singular system - not enough varied data")
+        m[col], m[pivot] = m[pivot], m[col]
+        for r in range(n):
+            if r != col:
+                f = m[r][col] / m[col][col]
+                for c in range(col, n + 1):
+                    m[r][c] -= f * m[col][c]
+    return [m[i][n] / m[i][i] for i in range(n)]
+
+
+def fit(samples):
+    """
+    Fits kS, kV and kA to a list of (voltage, velocity, accel) tuples.
+    Returns the constants and the coefficient of determination.
+    """
+    ata = [[0.0] * 3 for _ in range(3)]
+    atb = [0.0] * 3
+    for volt, vel, acc in samples:
+        row = (sign(vel), vel, acc)
+        for i in range(3):
+            atb[i] += row[i] * volt
+            for j in range(3):
+                ata[i][j] += row[i] * row[j]
+    ks, kv, ka = solve(ata, atb)
+
+    mean = sum(s[0] for s in samples) / len(samples)
+    ss_tot = sum((s[0] - mean) ** 2 for s in samples)
+    ss_res = sum((s[0] - (ks * sign(s[1]) + kv * s[1] + ka * s[2])) ** 2
+                 for s in samples)
+    r2 = 1 - ss_res / ss_tot if ss_tot > 0 else 0.0
+    return ks, kv, ka, r2
+
+
+def load(paths, min_velocity):
+    """Reads the logs, grouping usable samples by motor group name."""
+    groups = {}
+    for path in paths:
+        with open(path, newline="") as f:
+            for row in csv.DictReader(f):
+                vel = float(row["velocity_rpm"])
+                # Samples where the mechanism has not broken free of static
+                # friction follow a different model, so they are dropped
+                if abs(vel) < min_velocity:
+                    continue
+                groups.setdefault(row["group"], []).append(
+                    (float(row["voltage_mv"]), vel,
+                     float(row["accel_rpm_per_s"])))
+    return groups
+
+
+def read_header(path):
+    """Returns the #defines already in the header, in order."""
+    defines = {}
+    if os.path.exists(path):
+        with open(path) as f:
+            text = f.read()
+            for match in re.finditer(r"#define[ \t]+(\w+)[ \t]+(\S+)", text):
+                if match.group(1) != "SYSID_CONSTS_HPP":
+                    defines[match.group(1)] = match.group(2)
+    return defines
+
+
+def write_header(path, defines, sources):
+    prefixes = []
+    for name in defines:
+        prefix = name.rsplit("_", 1)[0]
+        if prefix not in prefixes:
+            prefixes.append(prefix)
+
+    with open(path, "w") as f:
+        f.write("/**\n")
+        f.write(" * \\file sysid_consts.hpp\n")
+        f.write(" * Feedforward constants found through system "
+                "identification. This file is\n")
+        f.write(" * generated by tools/sysid_fit.py from the CSV files "
+                "written by\n")
+        f.write(" * Drivetrain::characterize and Flywheel::characterize - "
+                "rerun the tool rather\n")
+        f.write(" * than editing it by hand.\n")
+        f.write(" *\n")
+        f.write(" * Units: kS in mV, kV in mV per RPM, kA in mV per "
+                "(RPM per second)\n")
+        if sources:
+            f.write(" *\n")
+            f.write(" * Fitted from: %s\n" % ", ".join(sources))
+        f.write(" */\n\n")
+        f.write("#ifndef SYSID_CONSTS_HPP\n#define SYSID_CONSTS_HPP\n")
+        for prefix in prefixes:
+            f.write("\n")
+            for name, value in defines.items():
+                if name.rsplit("_", 1)[0] == prefix:
+                    f.write("#define %s %s\n" % (name, value))
+        f.write("\n#endif /* sysid_consts.hpp */\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("logs", nargs="+", help="CSV files from the SD card")
+    parser.add_argument("-o", "--output", default=DEFAULT_HEADER,
+                        help="header to write (default: %(default)s)")
+    parser.add_argument("--min-velocity", type=float, default=5.0,
+                        help="ignore samples slower than this, in RPM")
+    args = parser.parse_args()
+
+    groups = load(args.logs, args.min_velocity)
+    if not groups:
+        sys.exit("no usable samples in " + ", ".join(args.logs))
+
+    defines = read_header(args.output)
+    for name, samples in sorted(groups.items()):
+        prefix = GROUP_PREFIXES.get(name, name.upper())
+        try:
+            ks, kv, ka, r2 = fit(samples)
+        except ValueError as e:
+            print("%s: %s" % (name, e), file=sys.stderr)
+            continue
+        print("%-12s kS=%9.3f kV=%9.4f kA=%9.5f  r^2=%.4f  (%d samples)" %
+              (name, ks, kv, ka, r2, len(samples)))
+        if not all(map(math.isfinite, (ks, kv, ka))):
+            continue
+        defines[prefix + "_KS"] = "%.4g" % ks
+        defines[prefix + "_KV"] = "%.6g" % kv
+        defines[prefix + "_KA"] = "%.6g" % ka
+
+    write_header(args.output, defines,
+                 [os.path.basename(p) for p in args.logs])
+    print("wrote " + os.path.normpath(args.output))
+
+
+if __name__ == "__main__":
+    main()
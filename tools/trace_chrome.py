@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""
+Converts a trace recorded by the robot (see include/Trace.hpp) into the Chrome
+trace format, so that the timeline can be viewed in chrome://tracing or
+ui.perfetto.dev.
+
+The input is either a /usd/trace_<n>.txt file from the SD card or a saved
+terminal capture of Trace::print, which may be mixed in with other output.
+Each task becomes a thread in the viewer. Control loop ticks are shown as
+slices the length of their bodies, motions, waits, delays and punches as
+slices from their start to their end, and marks and intake jams as instants.
+
+Usage:
+    python3 tools/trace_chrome.py trace_0.txt [-o trace.json]
+"""
+
+import argparse
+import json
+import sys
+
+# The trace_event_e_t values, from include/Trace.hpp
+TICK = 0
+MARK = 9
+JAM = 10
+
+# Events that start and end a slice, by the start event's value: the slice's
+# name and the value of the end event
+SLICES = {
+    1: ("motion", 2),
+    3: ("wait_until_settled", 4),
+    5: ("shot", 6),
+    7: ("delay", 8),
+}
+
+# The settle_exit_e_t values, from include/Settle_Detector.hpp
+EXIT_REASONS = ["running", "small error", "large error", "stalled", "timeout"]
+
+
+def load(path):
+    """Returns the task names by id and the records, as (time, task, event,
+    arg) tuples, with the times unwrapped."""
+    names = {}
+    records = []
+    offset = 0
+    prev = None
+    with open(path) as f:
+        for line in f:
+            fields = line.strip().split(",")
+            if fields[0] == "N" and len(fields) >= 3:
+                names[int(fields[1])] = ",".join(fields[2:])
+            elif fields[0] == "R" and len(fields) == 5:
+                time, task, event, arg = (int(x) for x in fields[1:])
+                # The times are a 32 bit count of us, so they wrap every 71
+                # minutes
+                if prev is not None and time + offset < prev - 2**31:
+                    offset += 2**32
+                prev = time + offset
+                records.append((time + offset, task, event, arg))
+    return names, records
+
+
+def convert(names, records):
+    """Returns the Chrome trace events for the records."""
+    events = []
+    for task, name in sorted(names.items()):
+        events.append({"name": "thread_name", "ph": "M", "pid": 1,
+                       "tid": task, "args": {"name": name}})
+
+    ends = {end: (start, name) for start, (name, end) in SLICES.items()}
+    # Slices started in each task, so that an end whose start was overwritten
+    # in the ring is left out rather than closing the wrong slice
+    open_slices = {}
+
+    for time, task, event, arg in records:
+        base = {"pid": 1, "tid": task, "ts": time}
+        if event == TICK:
+            events.append(dict(base, name="tick", ph="X", dur=arg))
+        elif event == MARK:
+            events.append(dict(base, name="mark %d" % arg, ph="i", s="t"))
+        elif event == JAM:
+            events.append(dict(base, name="jam %d" % arg, ph="i", s="t"))
+        elif event in SLICES:
+            name = SLICES[event][0]
+            args = {"arg": arg}
+            if name == "motion":
+                name = "motion %d" % arg
+            open_slices.setdefault((task, event), []).append(name)
+            events.append(dict(base, name=name, ph="B", args=args))
+        elif event in ends:
+            start, _ = ends[event]
+            stack = open_slices.get((task, start))
+            if not stack:
+                continue
+            name = stack.pop()
+            args = {"arg": arg}
+            if name.startswith("motion") and 0 <= arg < len(EXIT_REASONS):
+                args = {"exit_reason": EXIT_REASONS[arg]}
+            elif name == "shot":
+                args = {"timed_out": bool(arg)}
+            events.append(dict(base, name=name, ph="E", args=args))
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("trace", help="trace file or terminal capture")
+    parser.add_argument("-o", "--output", default="trace.json",
+                        help="where to write the Chrome trace "
+                        "(default: %(default)s)")
+    args = parser.parse_args()
+
+    names, records = load(args.trace)
+    if not records:
+        sys.exit("no trace records in " + args.trace)
+
+    with open(args.output, "w") as f:
+        json.dump({"traceEvents": convert(names, records),
+                   "displayTimeUnit": "ms"}, f)
+    print("%d records from %d tasks written to %s" %
+          (len(records), len(names), args.output))
+
+
+if __name__ == "__main__":
+    main()